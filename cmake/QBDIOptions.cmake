@@ -69,6 +69,9 @@ else()
   set(QBDI_TOOLS_VALIDATOR OFF)
 endif()
 
+# Trace reader library (memory-mapped trace decoding, used by PyQBDI)
+option(QBDI_TOOLS_TRACEREADER "Compile the trace reader library" ON)
+
 # PYQBDI (need a python 32bit for 32bit architecture)
 if(QBDI_BITS_64
    AND (QBDI_PLATFORM_WINDOWS
@@ -114,6 +117,11 @@ if(QBDI_TOOLS_VALIDATOR AND NOT QBDI_TOOLS_QBDIPRELOAD)
     FATAL_ERROR "Need QBDI_TOOLS_QBDIPRELOAD to compile QBDI_TOOLS_VALIDATOR")
 endif()
 
+if(QBDI_TOOLS_PYQBDI AND NOT QBDI_TOOLS_TRACEREADER)
+  message(
+    FATAL_ERROR "Need QBDI_TOOLS_TRACEREADER to compile QBDI_TOOLS_PYQBDI")
+endif()
+
 # display resulted options
 message(STATUS "== QBDI Options ==")
 message(STATUS "QBDI_CCACHE:           ${QBDI_CCACHE}")
@@ -143,6 +151,7 @@ if(NOT
   message(STATUS "QBDI_TOOLS_QBDIPRELOAD: ${QBDI_TOOLS_QBDIPRELOAD}")
   message(STATUS "QBDI_TOOLS_VALIDATOR:  ${QBDI_TOOLS_VALIDATOR}")
 endif()
+message(STATUS "QBDI_TOOLS_TRACEREADER: ${QBDI_TOOLS_TRACEREADER}")
 message(STATUS "QBDI_TOOLS_PYQBDI:     ${QBDI_TOOLS_PYQBDI}")
 message(STATUS "QBDI_TOOLS_FRIDAQBDI:  ${QBDI_TOOLS_FRIDAQBDI}")
 
@@ -173,6 +173,12 @@ typedef enum {
   _QBDI_EI(SYSCALL_ENTRY) = 1 << 7,        /*!< Not implemented.*/
   _QBDI_EI(SYSCALL_EXIT) = 1 << 8,         /*!< Not implemented.*/
   _QBDI_EI(SIGNAL) = 1 << 9,               /*!< Not implemented.*/
+  _QBDI_EI(BUDGET_EXHAUSTED) = 1 << 10,    /*!< Triggered when the instruction
+                                            * budget doesn't cover the next
+                                            * sequence. The execution stops
+                                            * unless the budget is increased
+                                            * by the callback.
+                                            */
 } VMEvent;
 
 _QBDI_ENABLE_BITMASK_OPERATORS(VMEvent)
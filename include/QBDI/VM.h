@@ -149,6 +149,36 @@ public:
    */
   QBDI_EXPORT void setOptions(Options options);
 
+  /*! Set the number of instructions that the next runs can execute. The
+   *  budget is checked and decremented at the entry of each sequence: when it
+   *  doesn't cover the next sequence, a BUDGET_EXHAUSTED event is triggered
+   *  and the execution stops, unless the callback increases the budget.
+   *  The whole size of a sequence is charged, even when the execution enters
+   *  it after its first instruction or leaves it before its end. The
+   *  instructions executed by the ExecBroker aren't counted.
+   *
+   * @param[in] budget  The number of instructions. A budget of 0 stops the
+   *                    execution at the next sequence.
+   */
+  QBDI_EXPORT void setInstructionBudget(uint64_t budget);
+
+  /*! Remove the instruction budget. The next runs aren't limited.
+   */
+  QBDI_EXPORT void removeInstructionBudget();
+
+  /*! Check if an instruction budget limits the runs
+   *
+   * @return True if a budget was set and wasn't removed since.
+   */
+  QBDI_EXPORT bool isInstructionBudgetEnabled() const;
+
+  /*! Get the remaining instruction budget
+   *
+   * @return The number of instructions left (0 without budget, see
+   *         isInstructionBudgetEnabled).
+   */
+  QBDI_EXPORT uint64_t getInstructionBudget() const;
+
   /*! Add an address range to the set of instrumented address ranges.
    *
    * @param[in] start  Start address of the range (included).
@@ -533,6 +563,49 @@ public:
                                      InstCbLambda &&cbk,
                                      int priority = PRIORITY_DEFAULT);
 
+  /*! Register a callback for when any address of a set is executed. The set
+   * is held by a single instrumentation, which is faster to translate than
+   * one addCodeAddrCB per address when the set is large.
+   *
+   * @param[in] addresses  Code addresses which will trigger the callback.
+   * @param[in] pos        Relative position of the callback
+   *                       (PREINST / POSTINST).
+   * @param[in] cbk        A function pointer to the callback.
+   * @param[in] data       User defined data passed to the callback.
+   * @param[in] priority   The priority of the callback.
+   *
+   * @return The id of the registered instrumentation (or
+   * VMError::INVALID_EVENTID in case of failure).
+   */
+  QBDI_EXPORT uint32_t addCodeAddrCBSet(const std::vector<rword> &addresses,
+                                        InstPosition pos, InstCallback cbk,
+                                        void *data,
+                                        int priority = PRIORITY_DEFAULT);
+
+  /*! Add an address to a set registered with addCodeAddrCBSet, or replace
+   * the callback of an address of the set. Only the cache of this address is
+   * cleared.
+   *
+   * @param[in] id       The id of the set.
+   * @param[in] address  Code address which will trigger the callback.
+   * @param[in] cbk      A function pointer to the callback.
+   * @param[in] data     User defined data passed to the callback.
+   *
+   * @return True if the id is a valid set.
+   */
+  QBDI_EXPORT bool addCodeAddrCBSetEntry(uint32_t id, rword address,
+                                         InstCallback cbk, void *data);
+
+  /*! Remove an address from a set registered with addCodeAddrCBSet. Only the
+   * cache of this address is cleared.
+   *
+   * @param[in] id       The id of the set.
+   * @param[in] address  Code address to remove.
+   *
+   * @return True if the address was in the set.
+   */
+  QBDI_EXPORT bool removeCodeAddrCBSetEntry(uint32_t id, rword address);
+
   /*! Register a callback for when a specific address range is executed.
    *
    * @param[in] start    Start of the address range which will trigger
@@ -749,6 +822,14 @@ public:
       rword address,
       AnalysisType type = ANALYSIS_INSTRUCTION | ANALYSIS_DISASSEMBLY) const;
 
+  /*! Obtain an identifier of the content of the translation cache. It changes
+   * each time some cached instructions are flushed, and is never shared by two
+   * VMs. The InstAnalysis given by the VM aren't freed while it is unchanged.
+   *
+   * @return The generation of the translation cache.
+   */
+  QBDI_EXPORT uint64_t getCacheGeneration() const;
+
   /*! Add instrumentation rules to log memory access using inline
    * instrumentation and instruction shadows.
    *
@@ -775,6 +856,24 @@ public:
    */
   QBDI_EXPORT std::vector<MemoryAccess> getBBMemoryAccess() const;
 
+  /*! Copy the memory accesses made by the last instructions of the current
+   *  sequence in a caller buffer. The current instruction is the last one of
+   *  them. With OPT_MERGE_MEMORY_ACCESS, the accesses of these instructions
+   *  are merged together like with getBBMemoryAccess.
+   *
+   * @param[in]  instCount  The number of instructions (0 for all the
+   *                        instructions of the sequence).
+   * @param[out] accesses   Will be filled with the accesses, in the order of
+   *                        the execution.
+   * @param[in]  size       The number of elements of accesses.
+   *
+   * @return The number of accesses made by the instructions. Only the first
+   *         size accesses are written if it is greater than size.
+   */
+  QBDI_EXPORT size_t getLastMemoryAccess(uint32_t instCount,
+                                         MemoryAccess *accesses,
+                                         size_t size) const;
+
   /*! Pre-cache a known basic block
    *  This method mustn't be called if the VM already runs.
    *
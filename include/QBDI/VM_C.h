@@ -276,6 +276,20 @@ QBDI_EXPORT bool qbdi_switchStackAndCallA(VMInstanceRef instance, rword *retval,
  */
 QBDI_EXPORT GPRState *qbdi_getGPRState(VMInstanceRef instance);
 
+/*! Read a selection of the general purpose registers of the current state.
+ *
+ * @param[in]  instance  VM instance.
+ * @param[in]  mask      A bitmask of the registers to read (bit i selects the
+ *                       register i of the GPRState).
+ * @param[out] values    Will be filled with the values of the selected
+ *                       registers, in the order of the GPRState. Must have
+ *                       room for one rword per bit set in the mask.
+ *
+ * @return  The number of values written.
+ */
+QBDI_EXPORT size_t qbdi_getGPRs(VMInstanceRef instance, uint64_t mask,
+                                rword *values);
+
 /*! Obtain the current floating point register state.
  *
  * @param[in] instance  VM instance.
@@ -316,6 +330,43 @@ QBDI_EXPORT Options qbdi_getOptions(VMInstanceRef instance);
  */
 QBDI_EXPORT void qbdi_setOptions(VMInstanceRef instance, Options options);
 
+/*! Set the number of instructions that the next runs can execute. The budget
+ *  is checked and decremented at the entry of each sequence: when it doesn't
+ *  cover the next sequence, a QBDI_BUDGET_EXHAUSTED event is triggered and the
+ *  execution stops, unless the callback increases the budget. The whole size
+ *  of a sequence is charged, even when the execution enters it after its first
+ *  instruction or leaves it before its end.
+ *
+ * @param[in] instance  VM instance.
+ * @param[in] budget    The number of instructions. A budget of 0 stops the
+ *                      execution at the next sequence.
+ */
+QBDI_EXPORT void qbdi_setInstructionBudget(VMInstanceRef instance,
+                                           uint64_t budget);
+
+/*! Remove the instruction budget. The next runs aren't limited.
+ *
+ * @param[in] instance  VM instance.
+ */
+QBDI_EXPORT void qbdi_removeInstructionBudget(VMInstanceRef instance);
+
+/*! Check if an instruction budget limits the runs
+ *
+ * @param[in] instance  VM instance.
+ *
+ * @return              True if a budget was set and wasn't removed since.
+ */
+QBDI_EXPORT bool qbdi_isInstructionBudgetEnabled(VMInstanceRef instance);
+
+/*! Get the remaining instruction budget
+ *
+ * @param[in] instance  VM instance.
+ *
+ * @return              The number of instructions left (0 without budget, see
+ *                      qbdi_isInstructionBudgetEnabled).
+ */
+QBDI_EXPORT uint64_t qbdi_getInstructionBudget(VMInstanceRef instance);
+
 /*! Add a custom instrumentation rule to the VM.
  *
  * @param[in] instance   VM instance.
@@ -469,6 +520,53 @@ QBDI_EXPORT uint32_t qbdi_addCodeAddrCB(VMInstanceRef instance, rword address,
                                         InstPosition pos, InstCallback cbk,
                                         void *data, int priority);
 
+/*! Register a callback for when any address of a set is executed. The set is
+ * held by a single instrumentation, which is faster to translate than one
+ * qbdi_addCodeAddrCB per address when the set is large.
+ *
+ * @param[in] instance   VM instance.
+ * @param[in] addresses  Code addresses which will trigger the callback.
+ * @param[in] size       Number of addresses.
+ * @param[in] pos        Relative position of the callback
+ *                       (QBDI_PREINST / QBDI_POSTINST).
+ * @param[in] cbk        A function pointer to the callback.
+ * @param[in] data       User defined data passed to the callback.
+ * @param[in] priority   The priority of the callback.
+ *
+ * @return The id of the registered instrumentation (or QBDI_INVALID_EVENTID
+ * in case of failure).
+ */
+QBDI_EXPORT uint32_t qbdi_addCodeAddrCBSet(VMInstanceRef instance,
+                                           const rword *addresses, size_t size,
+                                           InstPosition pos, InstCallback cbk,
+                                           void *data, int priority);
+
+/*! Add an address to a set registered with qbdi_addCodeAddrCBSet, or replace
+ * the callback of an address of the set.
+ *
+ * @param[in] instance  VM instance.
+ * @param[in] id        The id of the set.
+ * @param[in] address   Code address which will trigger the callback.
+ * @param[in] cbk       A function pointer to the callback.
+ * @param[in] data      User defined data passed to the callback.
+ *
+ * @return True if the id is a valid set.
+ */
+QBDI_EXPORT bool qbdi_addCodeAddrCBSetEntry(VMInstanceRef instance, uint32_t id,
+                                            rword address, InstCallback cbk,
+                                            void *data);
+
+/*! Remove an address from a set registered with qbdi_addCodeAddrCBSet.
+ *
+ * @param[in] instance  VM instance.
+ * @param[in] id        The id of the set.
+ * @param[in] address   Code address to remove.
+ *
+ * @return True if the address was in the set.
+ */
+QBDI_EXPORT bool qbdi_removeCodeAddrCBSetEntry(VMInstanceRef instance,
+                                               uint32_t id, rword address);
+
 /*! Register a callback for when a specific address range is executed.
  *
  * @param[in] instance  VM instance.
@@ -545,6 +643,25 @@ QBDI_EXPORT const InstAnalysis *
 qbdi_getCachedInstAnalysis(const VMInstanceRef instance, rword address,
                            AnalysisType type);
 
+/*! Obtain the analyses of the cached instructions of a range in a single call.
+ * The instructions are walked from the start address. The validity of the
+ * returned pointers is the same as qbdi_getCachedInstAnalysis.
+ *
+ * @param[in]  instance   VM instance.
+ * @param[in]  start      Start of the range.
+ * @param[in]  end        End of the range (not included).
+ * @param[in]  type       Properties to retrieve during analysis.
+ * @param[out] analyses   Will be filled with the analyses of the cached
+ *                        instructions of the range, by increasing address.
+ * @param[in]  size       The number of elements of analyses.
+ *
+ * @return  The number of analyses written. If it is equal to size, the next
+ *          instructions can be read from the end of the last analysis.
+ */
+QBDI_EXPORT size_t qbdi_getCachedInstAnalysisRange(
+    const VMInstanceRef instance, rword start, rword end, AnalysisType type,
+    const InstAnalysis **analyses, size_t size);
+
 /*! Add instrumentation rules to log memory access using inline instrumentation
  and
  *  instruction shadows.
@@ -586,6 +703,27 @@ QBDI_EXPORT MemoryAccess *qbdi_getInstMemoryAccess(VMInstanceRef instance,
 QBDI_EXPORT MemoryAccess *qbdi_getBBMemoryAccess(VMInstanceRef instance,
                                                  size_t *size);
 
+/*! Copy the memory accesses made by the last instructions of the current
+ *  sequence in a caller buffer. Unlike qbdi_getBBMemoryAccess, nothing is
+ *  allocated. The current instruction is the last one of them. With
+ *  OPT_MERGE_MEMORY_ACCESS, the accesses of these instructions are merged
+ *  together like with qbdi_getBBMemoryAccess.
+ *
+ *  @param[in]  instance     VM instance.
+ *  @param[in]  instCount    The number of instructions (0 for all the
+ *                           instructions of the sequence).
+ *  @param[out] accesses     Will be filled with the accesses, in the order of
+ *                           the execution.
+ *  @param[in]  size         The number of elements of accesses.
+ *
+ * @return The number of accesses made by the instructions. Only the first
+ *         size accesses are written if it is greater than size.
+ */
+QBDI_EXPORT size_t qbdi_getLastMemoryAccess(VMInstanceRef instance,
+                                            uint32_t instCount,
+                                            MemoryAccess *accesses,
+                                            size_t size);
+
 /*! Pre-cache a known basic block
  *  This method mustn't be called when the VM runs.
  *
@@ -39,6 +39,19 @@ typedef enum {
                                                 * optimisation when the target
                                                 * execblock doesn't used FPR
                                                 */
+  _QBDI_EI(OPT_ENABLE_REG_LIVENESS) = 1 << 2,  /*!< Use a liveness analysis to
+                                                * let the instrumentation use
+                                                * dead registers without
+                                                * backup. The value of a dead
+                                                * register in the GPRState may
+                                                * be wrong in VMEvent callback
+                                                */
+  _QBDI_EI(OPT_MERGE_MEMORY_ACCESS) = 1 << 3,  /*!< Merge the contiguous
+                                                * accesses of the same type in
+                                                * getBBMemoryAccess. The
+                                                * value of a merged access is
+                                                * unknown
+                                                */
   // architecture specific option between 24 and 31
   _QBDI_EI(OPT_DISABLE_LOCAL_MONITOR) =
       1 << 24, /*!< Disable the local monitor for instruction like strex */
@@ -39,15 +39,35 @@ typedef enum {
                                                 * optimisation when the target
                                                 * execblock doesn't used FPR
                                                 */
+  _QBDI_EI(OPT_ENABLE_REG_LIVENESS) = 1 << 2,  /*!< Use a liveness analysis to
+                                                * let the instrumentation use
+                                                * dead registers without
+                                                * backup. The value of a dead
+                                                * register in the GPRState may
+                                                * be wrong in VMEvent callback
+                                                */
+  _QBDI_EI(OPT_MERGE_MEMORY_ACCESS) = 1 << 3,  /*!< Merge the contiguous
+                                                * accesses of the same type in
+                                                * getBBMemoryAccess. The
+                                                * value of a merged access is
+                                                * unknown
+                                                */
   // architecture specific option between 24 and 31
   _QBDI_EI(OPT_ATT_SYNTAX) = 1 << 24,   /*!< Used the AT&T syntax for
                                          * instruction disassembly
                                          */
   _QBDI_EI(OPT_ENABLE_FS_GS) = 1 << 25, /*!< Enable Backup/Restore of FS/GS
                                          * segment. This option uses the
-                                         * instructions (RD|WR)(FS|GS)BASE that
-                                         * must be supported by the operating
-                                         * system */
+                                         * instructions (RD|WR)(FS|GS)BASE
+                                         * when supported by the operating
+                                         * system, or arch_prctl on Linux */
+  _QBDI_EI(OPT_RECORD_LARGE_MEMORY_VALUE) = 1 << 26, /*!< Record the value
+                                                      * of the memory
+                                                      * accesses up to 64
+                                                      * bytes. The accesses
+                                                      * larger than a rword
+                                                      * are split in rword
+                                                      */
 } Options;
 
 _QBDI_ENABLE_BITMASK_OPERATORS(Options)
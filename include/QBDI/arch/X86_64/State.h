@@ -123,25 +123,69 @@ typedef struct QBDI_ALIGNED(16) {
   char xmm14[16];     /* XMM 14  */
   char xmm15[16];     /* XMM 15  */
   char reserved[6 * 16];
-  char ymm0[16];  /* YMM0[255:128] */
-  char ymm1[16];  /* YMM1[255:128] */
-  char ymm2[16];  /* YMM2[255:128] */
-  char ymm3[16];  /* YMM3[255:128] */
-  char ymm4[16];  /* YMM4[255:128] */
-  char ymm5[16];  /* YMM5[255:128] */
-  char ymm6[16];  /* YMM6[255:128] */
-  char ymm7[16];  /* YMM7[255:128] */
-  char ymm8[16];  /* YMM8[255:128] */
-  char ymm9[16];  /* YMM9[255:128] */
-  char ymm10[16]; /* YMM10[255:128] */
-  char ymm11[16]; /* YMM11[255:128] */
-  char ymm12[16]; /* YMM12[255:128] */
-  char ymm13[16]; /* YMM13[255:128] */
-  char ymm14[16]; /* YMM14[255:128] */
-  char ymm15[16]; /* YMM15[255:128] */
+  uint64_t xstate_bv; /* XSAVE header: components saved in the state */
+  uint64_t xcomp_bv;  /* XSAVE header: compaction mask (unused) */
+  char rsrv4[48];     /* reserved */
+  char ymm0[16];      /* YMM0[255:128] */
+  char ymm1[16];      /* YMM1[255:128] */
+  char ymm2[16];      /* YMM2[255:128] */
+  char ymm3[16];      /* YMM3[255:128] */
+  char ymm4[16];      /* YMM4[255:128] */
+  char ymm5[16];      /* YMM5[255:128] */
+  char ymm6[16];      /* YMM6[255:128] */
+  char ymm7[16];      /* YMM7[255:128] */
+  char ymm8[16];      /* YMM8[255:128] */
+  char ymm9[16];      /* YMM9[255:128] */
+  char ymm10[16];     /* YMM10[255:128] */
+  char ymm11[16];     /* YMM11[255:128] */
+  char ymm12[16];     /* YMM12[255:128] */
+  char ymm13[16];     /* YMM13[255:128] */
+  char ymm14[16];     /* YMM14[255:128] */
+  char ymm15[16];     /* YMM15[255:128] */
+  char rsrv5[256];    /* reserved (MPX state) */
+  uint64_t k0;        /* AVX-512 opmask K0 */
+  uint64_t k1;        /* AVX-512 opmask K1 */
+  uint64_t k2;        /* AVX-512 opmask K2 */
+  uint64_t k3;        /* AVX-512 opmask K3 */
+  uint64_t k4;        /* AVX-512 opmask K4 */
+  uint64_t k5;        /* AVX-512 opmask K5 */
+  uint64_t k6;        /* AVX-512 opmask K6 */
+  uint64_t k7;        /* AVX-512 opmask K7 */
+  char zmm0[32];      /* ZMM0[511:256] */
+  char zmm1[32];      /* ZMM1[511:256] */
+  char zmm2[32];      /* ZMM2[511:256] */
+  char zmm3[32];      /* ZMM3[511:256] */
+  char zmm4[32];      /* ZMM4[511:256] */
+  char zmm5[32];      /* ZMM5[511:256] */
+  char zmm6[32];      /* ZMM6[511:256] */
+  char zmm7[32];      /* ZMM7[511:256] */
+  char zmm8[32];      /* ZMM8[511:256] */
+  char zmm9[32];      /* ZMM9[511:256] */
+  char zmm10[32];     /* ZMM10[511:256] */
+  char zmm11[32];     /* ZMM11[511:256] */
+  char zmm12[32];     /* ZMM12[511:256] */
+  char zmm13[32];     /* ZMM13[511:256] */
+  char zmm14[32];     /* ZMM14[511:256] */
+  char zmm15[32];     /* ZMM15[511:256] */
+  char zmm16[64];     /* ZMM16 */
+  char zmm17[64];     /* ZMM17 */
+  char zmm18[64];     /* ZMM18 */
+  char zmm19[64];     /* ZMM19 */
+  char zmm20[64];     /* ZMM20 */
+  char zmm21[64];     /* ZMM21 */
+  char zmm22[64];     /* ZMM22 */
+  char zmm23[64];     /* ZMM23 */
+  char zmm24[64];     /* ZMM24 */
+  char zmm25[64];     /* ZMM25 */
+  char zmm26[64];     /* ZMM26 */
+  char zmm27[64];     /* ZMM27 */
+  char zmm28[64];     /* ZMM28 */
+  char zmm29[64];     /* ZMM29 */
+  char zmm30[64];     /* ZMM30 */
+  char zmm31[64];     /* ZMM31 */
 } FPRState;
 // SPHINX_X86_64_FPRSTATE_END
-typedef char __compile_check_01__[sizeof(FPRState) == 768 ? 1 : -1];
+typedef char __compile_check_01__[sizeof(FPRState) == 2688 ? 1 : -1];
 
 /*! X86_64 General Purpose Register context.
  */ // SPHINX_X86_64_GPRSTATE_BEGIN
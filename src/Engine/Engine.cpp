@@ -21,9 +21,12 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCInstrDesc.h"
+#include "llvm/MC/MCInstrInfo.h"
 
 #include "Engine/Engine.h"
 #include "Engine/LLVMCPU.h"
+#include "Engine/VM_internal.h"
 
 #include "ExecBlock/Context.h"
 #include "ExecBlock/ExecBlock.h"
@@ -31,8 +34,12 @@
 #include "ExecBroker/ExecBroker.h"
 #include "Patch/InstMetadata.h"
 #include "Patch/InstrRule.h"
+#include "Patch/InstrRules.h"
 #include "Patch/Patch.h"
+#include "Patch/PatchCondition.h"
 #include "Patch/PatchRuleAssembly.h"
+#include "Patch/Register.h"
+#include "Patch/TempManager.h"
 #include "Utility/LogSys.h"
 
 #include "QBDI/Bitmask.h"
@@ -50,9 +57,11 @@ namespace QBDI {
 
 Engine::Engine(const std::string &_cpu, const std::vector<std::string> &_mattrs,
                Options opts, VMInstanceRef vminstance)
-    : vminstance(vminstance), instrRulesCounter(0), vmCallbacksCounter(0),
+    : vminstance(vminstance), instrRulesCounter(0),
+      stopRuleID(VMError::INVALID_EVENTID), stopRuleAddress(0),
+      vmCallbacksCounter(0),
       curCPUMode(CPUMode::DEFAULT), options(opts), eventMask(VMEvent::NO_EVENT),
-      running(false) {
+      running(false), instBudgetEnabled(false), instBudget(0) {
 
   llvmCPUs = std::make_unique<LLVMCPUs>(_cpu, _mattrs, opts);
   blockManager = std::make_unique<ExecBlockManager>(*llvmCPUs, vminstance);
@@ -77,10 +86,12 @@ Engine::~Engine() = default;
 Engine::Engine(const Engine &other)
     : vminstance(nullptr), instrRules(),
       instrRulesCounter(other.instrRulesCounter),
+      stopRuleID(other.stopRuleID), stopRuleAddress(other.stopRuleAddress),
       vmCallbacks(other.vmCallbacks),
       vmCallbacksCounter(other.vmCallbacksCounter),
       curCPUMode(CPUMode::DEFAULT), options(other.options),
-      eventMask(other.eventMask), running(false) {
+      eventMask(other.eventMask), running(false),
+      instBudgetEnabled(other.instBudgetEnabled), instBudget(other.instBudget) {
 
   llvmCPUs = std::make_unique<LLVMCPUs>(
       other.llvmCPUs->getCPU(), other.llvmCPUs->getMattrs(), other.options);
@@ -130,8 +141,12 @@ Engine &Engine::operator=(const Engine &other) {
   }
   vmCallbacks = other.vmCallbacks;
   instrRulesCounter = other.instrRulesCounter;
+  stopRuleID = other.stopRuleID;
+  stopRuleAddress = other.stopRuleAddress;
   vmCallbacksCounter = other.vmCallbacksCounter;
   eventMask = other.eventMask;
+  instBudgetEnabled = other.instBudgetEnabled;
+  instBudget = other.instBudget;
 
   // copy instrumentation range
   execBroker->setInstrumentedRange(other.execBroker->getInstrumentedRange());
@@ -321,20 +336,92 @@ std::vector<Patch> Engine::patch(rword start) {
   return basicBlock;
 }
 
-void Engine::instrument(std::vector<Patch> &basicBlock, size_t patchEnd) {
-  const LLVMCPU &llvmcpu = llvmCPUs->getCPU(curCPUMode);
-  QBDI_DEBUG(
-      "Instrumenting sequence [0x{:x}, 0x{:x}] in basic block [0x{:x}, 0x{:x}]",
-      basicBlock.front().metadata.address,
-      basicBlock[patchEnd - 1].metadata.address,
-      basicBlock.front().metadata.address, basicBlock.back().metadata.address);
+static bool isLivenessBarrier(const Patch &patch, const InstrRuleList &rules,
+                              const LLVMCPU &llvmcpu) {
+  // A callback may read or write any register of the GPRState, or change
+  // the next address. The instructions with side effects (syscall, ...)
+  // may also use registers that aren't declared.
+  const llvm::MCInstrDesc &desc =
+      llvmcpu.getMCII().get(patch.metadata.inst.getOpcode());
+  if (desc.hasUnmodeledSideEffects()) {
+    return true;
+  }
+  for (const auto &item : rules) {
+    if (item.second->mayBreakToHost(patch, llvmcpu)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void computeLiveness(std::vector<Patch> &basicBlock, size_t patchEnd,
+                            const InstrRuleList &rules, const LLVMCPU &llvmcpu,
+                            bool computeGPR, bool computeFlags) {
+  const rword allGPR = ~((rword)0);
+
+  // Backward liveness analysis on the sequence. All the registers and the
+  // status flags are live at the end of the sequence, as the next
+  // instructions may be already cached with other instrumentations.
+  rword live = allGPR;
+  bool liveFlags = true;
+  for (size_t i = patchEnd; i > 0; i--) {
+    Patch &patch = basicBlock[i - 1];
+
+    if (isLivenessBarrier(patch, rules, llvmcpu)) {
+      patch.deadGPR = 0;
+      patch.flagsDead = false;
+      live = allGPR;
+      liveFlags = true;
+      continue;
+    }
+
+    if (computeGPR) {
+      rword used = 0;
+      for (unsigned j = 0; j < NUM_GPR; j++) {
+        if ((patch.regUsage[j] & RegisterUsage::RegisterUsed) != 0) {
+          used |= (((rword)1) << j);
+        }
+      }
+      // dead before and after the instruction
+      patch.deadGPR = ~(live | used);
+      live = (live & ~getKilledGPR(patch.metadata.inst, llvmcpu)) | used;
+    }
+
+    if (computeFlags) {
+      bool usedFlags = mayReadFlags(patch.metadata.inst, llvmcpu);
+      // dead before and after the instruction
+      patch.flagsDead = not(liveFlags or usedFlags);
+      liveFlags =
+          usedFlags or
+          (liveFlags and not isFullFlagsWrite(patch.metadata.inst, llvmcpu));
+    }
+  }
+}
+
+void instrumentPatches(std::vector<Patch> &basicBlock, size_t patchEnd,
+                       const InstrRuleList &rules, const LLVMCPU &llvmcpu,
+                       Options options) {
+  bool computeGPR = (options & Options::OPT_ENABLE_REG_LIVENESS) != 0;
+  // the flags liveness is only supported on X86 and X86_64, and only computed
+  // when a rule uses it
+  bool computeFlags = false;
+  if constexpr (is_x86 or is_x86_64) {
+    computeFlags =
+        std::any_of(rules.begin(), rules.end(), [](const auto &item) {
+          return item.second->needFlagsLiveness();
+        });
+  }
+  if (computeGPR or computeFlags) {
+    computeLiveness(basicBlock, patchEnd, rules, llvmcpu, computeGPR,
+                    computeFlags);
+  }
 
   for (size_t i = 0; i < patchEnd; i++) {
     Patch &patch = basicBlock[i];
     QBDI_DUMP_PATCH_DEBUG(patch, "Instrumenting");
 
     // Instrument
-    for (const auto &item : instrRules) {
+    for (const auto &item : rules) {
       const InstrRule *rule = item.second.get();
       if (rule->tryInstrument(patch, llvmcpu)) {
         QBDI_DEBUG("Instrumentation rule {:x} applied", item.first);
@@ -342,6 +429,21 @@ void Engine::instrument(std::vector<Patch> &basicBlock, size_t patchEnd) {
     }
     patch.finalizeInstsPatch();
   }
+
+  if constexpr (is_arm or is_aarch64) {
+    removeRedundantTempSave(basicBlock, patchEnd);
+  }
+}
+
+void Engine::instrument(std::vector<Patch> &basicBlock, size_t patchEnd) {
+  QBDI_DEBUG(
+      "Instrumenting sequence [0x{:x}, 0x{:x}] in basic block [0x{:x}, 0x{:x}]",
+      basicBlock.front().metadata.address,
+      basicBlock[patchEnd - 1].metadata.address,
+      basicBlock.front().metadata.address, basicBlock.back().metadata.address);
+
+  instrumentPatches(basicBlock, patchEnd, instrRules,
+                    llvmCPUs->getCPU(curCPUMode), options);
 }
 
 void Engine::handleNewBasicBlock(rword pc) {
@@ -392,6 +494,8 @@ bool Engine::run(rword start, rword stop) {
     return false;
   }
 
+  setStopAddress(stop);
+
   running = true;
 
   // Execute basic block per basic block
@@ -501,8 +605,31 @@ bool Engine::run(rword start, rword stop) {
       curGPRState = &(curExecBlock->getContext()->gprState);
       curFPRState = &(curExecBlock->getContext()->fprState);
 
-      action = signalEvent(event, currentPC, &currentSequence,
-                           basicBlockBeginAddr, curGPRState, curFPRState);
+      // Every sequence returns to the engine: the budget is decremented by
+      // the size of the whole sequence before it is entered.
+      if (instBudgetEnabled) {
+        uint64_t seqSize = curExecBlock->getSeqEnd(currentSequence.seqID) -
+                           curExecBlock->getSeqStart(currentSequence.seqID) +
+                           1;
+        if (seqSize > instBudget) {
+          QBDI_DEBUG("Instruction budget exhausted at 0x{:x}", currentPC);
+          action = signalEvent(BUDGET_EXHAUSTED, currentPC, &currentSequence,
+                               basicBlockBeginAddr, curGPRState, curFPRState);
+          // Whatever the action of the callbacks, the same sequence would be
+          // checked again
+          if (instBudgetEnabled and seqSize > instBudget) {
+            action = STOP;
+          }
+        }
+        if (action == CONTINUE and instBudgetEnabled) {
+          instBudget -= seqSize;
+        }
+      }
+
+      if (action == CONTINUE) {
+        action = signalEvent(event, currentPC, &currentSequence,
+                             basicBlockBeginAddr, curGPRState, curFPRState);
+      }
 
       if (action == CONTINUE) {
         hasRan = true;
@@ -547,6 +674,18 @@ bool Engine::run(rword start, rword stop) {
   return hasRan;
 }
 
+void Engine::setInstructionBudget(uint64_t budget) {
+  instBudgetEnabled = true;
+  instBudget = budget;
+}
+
+void Engine::removeInstructionBudget() {
+  instBudgetEnabled = false;
+  instBudget = 0;
+}
+
+uint64_t Engine::getInstructionBudget() const { return instBudget; }
+
 uint32_t Engine::addInstrRule(std::unique_ptr<InstrRule> &&rule) {
   uint32_t id = instrRulesCounter++;
   QBDI_REQUIRE_ACTION(id < EVENTID_VM_MASK, return VMError::INVALID_EVENTID);
@@ -567,6 +706,28 @@ uint32_t Engine::addInstrRule(std::unique_ptr<InstrRule> &&rule) {
   return id;
 }
 
+void Engine::setStopAddress(rword stop) {
+  // The stop address is compared with the PC between each sequence. A stop
+  // address inside an instrumented range may also be reached in the middle of
+  // a sequence and needs a STOP callback. Adding or removing this callback
+  // clears the cache at the stop address: the rule is kept between the runs
+  // and only replaced when the stop address changes.
+  bool needRule = execBroker->isInstrumented(stop);
+  if (stopRuleID != VMError::INVALID_EVENTID) {
+    if (needRule and stopRuleAddress == stop) {
+      return;
+    }
+    deleteInstrumentation(stopRuleID);
+    stopRuleID = VMError::INVALID_EVENTID;
+  }
+  if (needRule) {
+    stopRuleID = addInstrRule(InstrRuleBasicCBK::unique(
+        AddressIs::unique(stop), stopCallback, nullptr, InstPosition::PREINST,
+        true, PRIORITY_DEFAULT, RelocTagPreInstStdCBK));
+    stopRuleAddress = stop;
+  }
+}
+
 InstrRule *Engine::getInstrRule(uint32_t id) {
   auto it = std::find_if(
       instrRules.begin(), instrRules.end(),
@@ -580,6 +741,27 @@ InstrRule *Engine::getInstrRule(uint32_t id) {
   }
 }
 
+bool Engine::setInstrRuleAddressCB(uint32_t id, rword address,
+                                   InstCallback cbk, void *data) {
+  InstrRule *rule = getInstrRule(id);
+  if (rule == nullptr or not rule->setAddressCB(address, cbk, data)) {
+    return false;
+  }
+  Range<rword> range = rule->getAddressCBRange(address);
+  this->clearCache(range.start(), range.end());
+  return true;
+}
+
+bool Engine::removeInstrRuleAddressCB(uint32_t id, rword address) {
+  InstrRule *rule = getInstrRule(id);
+  if (rule == nullptr or not rule->removeAddressCB(address)) {
+    return false;
+  }
+  Range<rword> range = rule->getAddressCBRange(address);
+  this->clearCache(range.start(), range.end());
+  return true;
+}
+
 uint32_t Engine::addVMEventCB(VMEvent mask, VMCallback cbk, void *data) {
   uint32_t id = vmCallbacksCounter++;
   QBDI_REQUIRE_ACTION(id < EVENTID_VM_MASK, return VMError::INVALID_EVENTID);
@@ -651,6 +833,10 @@ const InstAnalysis *Engine::getInstAnalysis(rword address,
   return block->getInstAnalysis(instID, type);
 }
 
+uint64_t Engine::getCacheGeneration() const {
+  return blockManager->getCacheGeneration();
+}
+
 bool Engine::deleteInstrumentation(uint32_t id) {
   if (id & EVENTID_VM_MASK) {
     id &= ~EVENTID_VM_MASK;
@@ -665,6 +851,9 @@ bool Engine::deleteInstrumentation(uint32_t id) {
       if (instrRules[i].first == id) {
         this->clearCache(instrRules[i].second->affectedRange());
         instrRules.erase(instrRules.begin() + i);
+        if (id == stopRuleID) {
+          stopRuleID = VMError::INVALID_EVENTID;
+        }
         return true;
       }
     }
@@ -680,6 +869,7 @@ void Engine::deleteAllInstrumentations() {
   instrRules.clear();
   vmCallbacks.clear();
   instrRulesCounter = 0;
+  stopRuleID = VMError::INVALID_EVENTID;
   vmCallbacksCounter = 0;
   eventMask = VMEvent::NO_EVENT;
 }
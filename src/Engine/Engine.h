@@ -33,6 +33,7 @@
 
 namespace QBDI {
 
+class LLVMCPU;
 class LLVMCPUs;
 class ExecBlock;
 class ExecBlockManager;
@@ -42,6 +43,24 @@ class Patch;
 class PatchRuleAssembly;
 struct SeqLoc;
 
+using InstrRuleList =
+    std::vector<std::pair<uint32_t, std::unique_ptr<InstrRule>>>;
+
+/*! Instrument the first patches of a basic block, as the Engine does before
+ * writing them in the cache. On X86 and X86_64, the status flags liveness is
+ * computed when a rule needs it (see InstrRule::needFlagsLiveness).
+ *
+ * @param[in] basicBlock The patches of the basic block.
+ * @param[in] patchEnd   The number of patches to instrument.
+ * @param[in] rules      The instrumentation rules to apply.
+ * @param[in] llvmcpu    The LLVMCPU of the basic block.
+ * @param[in] options    The options of the Engine (OPT_ENABLE_REG_LIVENESS
+ *                       computes the dead registers of the patches).
+ */
+void instrumentPatches(std::vector<Patch> &basicBlock, size_t patchEnd,
+                       const InstrRuleList &rules, const LLVMCPU &llvmcpu,
+                       Options options);
+
 struct CallbackRegistration {
   VMEvent mask;
   VMCallback cbk;
@@ -56,8 +75,10 @@ private:
   std::unique_ptr<ExecBlockManager> blockManager;
   ExecBroker *execBroker;
   std::unique_ptr<PatchRuleAssembly> patchRuleAssembly;
-  std::vector<std::pair<uint32_t, std::unique_ptr<InstrRule>>> instrRules;
+  InstrRuleList instrRules;
   uint32_t instrRulesCounter;
+  uint32_t stopRuleID;
+  rword stopRuleAddress;
   std::vector<std::pair<uint32_t, CallbackRegistration>> vmCallbacks;
   uint32_t vmCallbacksCounter;
   std::unique_ptr<GPRState> gprState;
@@ -69,6 +90,8 @@ private:
   Options options;
   VMEvent eventMask;
   bool running;
+  bool instBudgetEnabled;
+  uint64_t instBudget;
 
   std::vector<Patch> patch(rword start);
 
@@ -77,6 +100,7 @@ private:
 
   void instrument(std::vector<Patch> &basicBlock, size_t patchEnd);
   void handleNewBasicBlock(rword pc);
+  void setStopAddress(rword stop);
 
   VMAction signalEvent(VMEvent kind, rword currentPC, const SeqLoc *seqLoc,
                        rword basicBlockBegin, GPRState *gprState,
@@ -208,6 +232,28 @@ public:
    */
   bool run(rword start, rword stop);
 
+  /*! Set the number of instructions that can be executed by the next runs.
+   * The budget is checked and decremented by the size of the whole sequence
+   * once per sequence.
+   *
+   * @param[in] budget  The number of instructions.
+   */
+  void setInstructionBudget(uint64_t budget);
+
+  /*! Remove the instruction budget.
+   */
+  void removeInstructionBudget();
+
+  /*! Check if an instruction budget limits the runs.
+   */
+  bool isInstructionBudgetEnabled() const { return instBudgetEnabled; }
+
+  /*! Get the remaining instruction budget.
+   *
+   * @return The number of instructions left (0 without budget).
+   */
+  uint64_t getInstructionBudget() const;
+
   /*! Add a custom instrumentation rule to the engine. Requires internal headers
    *
    * @param[in] rule A custom instrumentation rule.
@@ -225,6 +271,29 @@ public:
    */
   InstrRule *getInstrRule(uint32_t id);
 
+  /*! Add or replace the callback of an address in a rule holding a set of
+   * addresses. Only the cache of the instruction is cleared.
+   *
+   * @param[in] id       The id of the rule
+   * @param[in] address  The address of the instruction
+   * @param[in] cbk      The callback to call
+   * @param[in] data     The data pointer to give to the callback
+   *
+   * @return True if the rule exists and holds a set of addresses
+   */
+  bool setInstrRuleAddressCB(uint32_t id, rword address, InstCallback cbk,
+                             void *data);
+
+  /*! Remove the callback of an address in a rule holding a set of
+   * addresses. Only the cache of the instruction is cleared.
+   *
+   * @param[in] id       The id of the rule
+   * @param[in] address  The address of the instruction
+   *
+   * @return True if the address was in the set of the rule
+   */
+  bool removeInstrRuleAddressCB(uint32_t id, rword address);
+
   /*! Register a callback event for a specific VM event.
    *
    * @param[in] mask A mask of VM event type which will trigger the callback.
@@ -289,6 +358,11 @@ public:
    */
   const InstAnalysis *getInstAnalysis(rword address, AnalysisType type) const;
 
+  /*! Identifier of the content of the translation cache. Changed each time
+   * some cached instructions and their InstAnalysis are freed.
+   */
+  uint64_t getCacheGeneration() const;
+
   /*! Clear a specific address range from the translation cache.
    *
    * @param[in] start Start of the address range to clear from the cache.
@@ -370,6 +370,28 @@ void VM::setOptions(Options options) {
   engine->setOptions(options);
 }
 
+// setInstructionBudget
+
+void VM::setInstructionBudget(uint64_t budget) {
+  engine->setInstructionBudget(budget);
+}
+
+// removeInstructionBudget
+
+void VM::removeInstructionBudget() { engine->removeInstructionBudget(); }
+
+// isInstructionBudgetEnabled
+
+bool VM::isInstructionBudgetEnabled() const {
+  return engine->isInstructionBudgetEnabled();
+}
+
+// getInstructionBudget
+
+uint64_t VM::getInstructionBudget() const {
+  return engine->getInstructionBudget();
+}
+
 // addInstrumentedRange
 
 void VM::addInstrumentedRange(rword start, rword end) {
@@ -422,13 +444,7 @@ bool VM::removeInstrumentedModuleFromAddr(rword addr) {
 
 // run
 
-bool VM::run(rword start, rword stop) {
-  uint32_t stopCB =
-      addCodeAddrCB(stop, InstPosition::PREINST, stopCallback, nullptr);
-  bool ret = engine->run(start, stop);
-  deleteInstrumentation(stopCB);
-  return ret;
-}
+bool VM::run(rword start, rword stop) { return engine->run(start, stop); }
 
 // callA
 
@@ -702,6 +718,31 @@ uint32_t VM::addCodeAddrCB(rword address, InstPosition pos, InstCbLambda &&cbk,
   return id;
 }
 
+// addCodeAddrCBSet
+
+uint32_t VM::addCodeAddrCBSet(const std::vector<rword> &addresses,
+                              InstPosition pos, InstCallback cbk, void *data,
+                              int priority) {
+  QBDI_REQUIRE_ACTION(cbk != nullptr, return VMError::INVALID_EVENTID);
+  std::unique_ptr<InstrRule> rule = InstrRuleAddrSet::unique(
+      pos, priority,
+      (pos == PREINST) ? RelocTagPreInstStdCBK : RelocTagPostInstStdCBK);
+  for (rword address : addresses) {
+    rule->setAddressCB(address, cbk, data);
+  }
+  return engine->addInstrRule(std::move(rule));
+}
+
+bool VM::addCodeAddrCBSetEntry(uint32_t id, rword address, InstCallback cbk,
+                               void *data) {
+  QBDI_REQUIRE_ACTION(cbk != nullptr, return false);
+  return engine->setInstrRuleAddressCB(id, address, cbk, data);
+}
+
+bool VM::removeCodeAddrCBSetEntry(uint32_t id, rword address) {
+  return engine->removeInstrRuleAddressCB(id, address);
+}
+
 // addCodeRangeCB
 
 uint32_t VM::addCodeRangeCB(rword start, rword end, InstPosition pos,
@@ -928,6 +969,10 @@ const InstAnalysis *VM::getCachedInstAnalysis(rword address,
   return engine->getInstAnalysis(address, type);
 }
 
+// getCacheGeneration
+
+uint64_t VM::getCacheGeneration() const { return engine->getCacheGeneration(); }
+
 // recordMemoryAccess
 
 bool VM::recordMemoryAccess(MemoryAccessType type) {
@@ -961,28 +1006,91 @@ std::vector<MemoryAccess> VM::getInstMemoryAccess() const {
 
 // getBBMemoryAccess
 
-std::vector<MemoryAccess> VM::getBBMemoryAccess() const {
-  const ExecBlock *curExecBlock = engine->getCurExecBlock();
+// Merge each access with the last access of the same type when they are
+// contiguous. The merged access stays at the position of the first one.
+static void mergeMemoryAccess(std::vector<MemoryAccess> &memAccess) {
+  const MemoryAccessFlags inexactSize =
+      MEMORY_UNKNOWN_SIZE | MEMORY_MINIMUM_SIZE;
+  size_t lastRead = memAccess.size();
+  size_t lastWrite = memAccess.size();
+  size_t out = 0;
+
+  for (size_t i = 0; i < memAccess.size(); i++) {
+    MemoryAccess access = memAccess[i];
+    size_t &last = (access.type == MEMORY_READ) ? lastRead : lastWrite;
+
+    if (last < out and memAccess[last].type == access.type and
+        (access.flags & inexactSize) == 0 and
+        (memAccess[last].flags & inexactSize) == 0 and
+        static_cast<rword>(memAccess[last].size) + access.size <= UINT16_MAX) {
+      MemoryAccess &prev = memAccess[last];
+      if (prev.accessAddress + prev.size == access.accessAddress) {
+        prev.size += access.size;
+        prev.flags |= access.flags | MEMORY_UNKNOWN_VALUE;
+        prev.value = 0;
+        continue;
+      } else if (access.accessAddress + access.size == prev.accessAddress) {
+        prev.accessAddress = access.accessAddress;
+        prev.size += access.size;
+        prev.flags |= access.flags | MEMORY_UNKNOWN_VALUE;
+        prev.value = 0;
+        continue;
+      }
+    }
+    last = out;
+    memAccess[out++] = access;
+  }
+  memAccess.resize(out);
+}
+
+// Append the accesses of the last instCount instructions of the current
+// sequence (0 for all the instructions) to memAccess. The current instruction
+// is one of them, with only its accesses done before it in PREINST.
+static void collectMemoryAccess(const Engine &engine, uint32_t instCount,
+                                std::vector<MemoryAccess> &memAccess) {
+  const ExecBlock *curExecBlock = engine.getCurExecBlock();
   if (curExecBlock == nullptr) {
-    return {};
+    return;
   }
   uint16_t bbID = curExecBlock->getCurrentSeqID();
   uint16_t instID = curExecBlock->getCurrentInstID();
-  std::vector<MemoryAccess> memAccess;
   QBDI_DEBUG(
       "Search MemoryAccess for Basic Block {:x} stopping at Instruction {:x}",
       bbID, instID);
 
-  uint16_t endInstID = curExecBlock->getSeqEnd(bbID);
-  for (uint16_t itInstID = curExecBlock->getSeqStart(bbID);
-       itInstID <= std::min(endInstID, instID); itInstID++) {
-
+  uint16_t startInstID = curExecBlock->getSeqStart(bbID);
+  uint16_t endInstID = std::min(curExecBlock->getSeqEnd(bbID), instID);
+  if (instCount != 0 and
+      static_cast<uint32_t>(endInstID - startInstID) >= instCount) {
+    startInstID = endInstID - instCount + 1;
+  }
+  for (uint16_t itInstID = startInstID; itInstID <= endInstID; itInstID++) {
     analyseMemoryAccess(*curExecBlock, itInstID,
-                        itInstID != instID || !engine->isPreInst(), memAccess);
+                        itInstID != instID || !engine.isPreInst(), memAccess);
+  }
+  if ((engine.getOptions() & Options::OPT_MERGE_MEMORY_ACCESS) != 0) {
+    mergeMemoryAccess(memAccess);
   }
+}
+
+std::vector<MemoryAccess> VM::getBBMemoryAccess() const {
+  std::vector<MemoryAccess> memAccess;
+  collectMemoryAccess(*engine, 0, memAccess);
   return memAccess;
 }
 
+// getLastMemoryAccess
+
+size_t VM::getLastMemoryAccess(uint32_t instCount, MemoryAccess *accesses,
+                               size_t size) const {
+  // reuse the buffer between the calls
+  static thread_local std::vector<MemoryAccess> memAccess;
+  memAccess.clear();
+  collectMemoryAccess(*engine, instCount, memAccess);
+  std::copy_n(memAccess.begin(), std::min(memAccess.size(), size), accesses);
+  return memAccess.size();
+}
+
 // precacheBasicBlock
 
 bool VM::precacheBasicBlock(rword pc) { return engine->precacheBasicBlock(pc); }
@@ -15,6 +15,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -160,6 +161,19 @@ GPRState *qbdi_getGPRState(VMInstanceRef instance) {
   return static_cast<VM *>(instance)->getGPRState();
 }
 
+size_t qbdi_getGPRs(VMInstanceRef instance, uint64_t mask, rword *values) {
+  QBDI_REQUIRE_ACTION(instance, return 0);
+  QBDI_REQUIRE_ACTION(values, return 0);
+  const GPRState *gprState = static_cast<VM *>(instance)->getGPRState();
+  size_t count = 0;
+  for (size_t i = 0; i < sizeof(GPRState) / sizeof(rword) and i < 64; i++) {
+    if ((mask >> i) & 1) {
+      values[count++] = QBDI_GPR_GET(gprState, i);
+    }
+  }
+  return count;
+}
+
 FPRState *qbdi_getFPRState(VMInstanceRef instance) {
   QBDI_REQUIRE_ACTION(instance, return nullptr);
   return static_cast<VM *>(instance)->getFPRState();
@@ -185,6 +199,26 @@ void qbdi_setOptions(VMInstanceRef instance, Options options) {
   static_cast<VM *>(instance)->setOptions(options);
 }
 
+void qbdi_setInstructionBudget(VMInstanceRef instance, uint64_t budget) {
+  QBDI_REQUIRE_ACTION(instance, return );
+  static_cast<VM *>(instance)->setInstructionBudget(budget);
+}
+
+void qbdi_removeInstructionBudget(VMInstanceRef instance) {
+  QBDI_REQUIRE_ACTION(instance, return );
+  static_cast<VM *>(instance)->removeInstructionBudget();
+}
+
+bool qbdi_isInstructionBudgetEnabled(VMInstanceRef instance) {
+  QBDI_REQUIRE_ACTION(instance, return false);
+  return static_cast<VM *>(instance)->isInstructionBudgetEnabled();
+}
+
+uint64_t qbdi_getInstructionBudget(VMInstanceRef instance) {
+  QBDI_REQUIRE_ACTION(instance, return 0);
+  return static_cast<VM *>(instance)->getInstructionBudget();
+}
+
 uint32_t qbdi_addMnemonicCB(VMInstanceRef instance, const char *mnemonic,
                             InstPosition pos, InstCallback cbk, void *data,
                             int priority) {
@@ -207,6 +241,29 @@ uint32_t qbdi_addCodeAddrCB(VMInstanceRef instance, rword address,
                                                     priority);
 }
 
+uint32_t qbdi_addCodeAddrCBSet(VMInstanceRef instance, const rword *addresses,
+                               size_t size, InstPosition pos, InstCallback cbk,
+                               void *data, int priority) {
+  QBDI_REQUIRE_ACTION(instance, return VMError::INVALID_EVENTID);
+  QBDI_REQUIRE_ACTION(addresses or size == 0, return VMError::INVALID_EVENTID);
+  return static_cast<VM *>(instance)->addCodeAddrCBSet(
+      std::vector<rword>(addresses, addresses + size), pos, cbk, data,
+      priority);
+}
+
+bool qbdi_addCodeAddrCBSetEntry(VMInstanceRef instance, uint32_t id,
+                                rword address, InstCallback cbk, void *data) {
+  QBDI_REQUIRE_ACTION(instance, return false);
+  return static_cast<VM *>(instance)->addCodeAddrCBSetEntry(id, address, cbk,
+                                                            data);
+}
+
+bool qbdi_removeCodeAddrCBSetEntry(VMInstanceRef instance, uint32_t id,
+                                   rword address) {
+  QBDI_REQUIRE_ACTION(instance, return false);
+  return static_cast<VM *>(instance)->removeCodeAddrCBSetEntry(id, address);
+}
+
 uint32_t qbdi_addCodeRangeCB(VMInstanceRef instance, rword start, rword end,
                              InstPosition pos, InstCallback cbk, void *data,
                              int priority) {
@@ -266,6 +323,41 @@ const InstAnalysis *qbdi_getCachedInstAnalysis(const VMInstanceRef instance,
                                                                   type);
 }
 
+size_t qbdi_getCachedInstAnalysisRange(const VMInstanceRef instance,
+                                       rword start, rword end,
+                                       AnalysisType type,
+                                       const InstAnalysis **analyses,
+                                       size_t size) {
+  QBDI_REQUIRE_ACTION(instance, return 0);
+  QBDI_REQUIRE_ACTION(analyses or size == 0, return 0);
+#if defined(QBDI_ARCH_X86) || defined(QBDI_ARCH_X86_64)
+  static const rword instAlign = 1;
+#elif defined(QBDI_ARCH_ARM)
+  static const rword instAlign = 2;
+#else
+  static const rword instAlign = 4;
+#endif
+  const VM *vm = static_cast<const VM *>(instance);
+  size_t count = 0;
+  rword address = start;
+  while (address < end and count < size) {
+    const InstAnalysis *analysis = vm->getCachedInstAnalysis(address, type);
+#if defined(QBDI_ARCH_ARM)
+    // Thumb instructions are cached with the bit 0 set
+    if (analysis == nullptr) {
+      analysis = vm->getCachedInstAnalysis(address | 1, type);
+    }
+#endif
+    if (analysis == nullptr) {
+      address += instAlign;
+      continue;
+    }
+    analyses[count++] = analysis;
+    address += analysis->instSize;
+  }
+  return count;
+}
+
 bool qbdi_recordMemoryAccess(VMInstanceRef instance, MemoryAccessType type) {
   QBDI_REQUIRE_ACTION(instance, return false);
   return static_cast<VM *>(instance)->recordMemoryAccess(type);
@@ -311,6 +403,14 @@ MemoryAccess *qbdi_getBBMemoryAccess(VMInstanceRef instance, size_t *size) {
   return ma_arr;
 }
 
+size_t qbdi_getLastMemoryAccess(VMInstanceRef instance, uint32_t instCount,
+                                MemoryAccess *accesses, size_t size) {
+  QBDI_REQUIRE_ACTION(instance, return 0);
+  QBDI_REQUIRE_ACTION(accesses or size == 0, return 0);
+  return static_cast<VM *>(instance)->getLastMemoryAccess(instCount, accesses,
+                                                          size);
+}
+
 bool qbdi_precacheBasicBlock(VMInstanceRef instance, rword pc) {
   QBDI_REQUIRE_ACTION(instance, return false);
   return static_cast<VM *>(instance)->precacheBasicBlock(pc);
@@ -87,7 +87,7 @@ bool ExecBlock::writePatch(std::vector<Patch>::const_iterator seqCurrent,
 
   QBDI_REQUIRE(p.finalize);
 
-  if (getEpilogueOffset() <= MINIMAL_BLOCK_SIZE) {
+  if (getAvailableSize() <= MINIMAL_BLOCK_SIZE) {
     isFull = true;
     return false;
   }
@@ -46,6 +46,9 @@
 
 namespace QBDI {
 
+// Minimal size of the shadows area, after the Context in the dataBlock
+static const size_t MINIMAL_SHADOWS_SIZE = 384 * sizeof(rword);
+
 ExecBlock::ExecBlock(
     const LLVMCPUs &llvmCPUs, VMInstanceRef vminstance,
     const std::vector<std::unique_ptr<RelocatableInst>> *execBlockPrologue,
@@ -67,18 +70,27 @@ ExecBlock::ExecBlock(
   if constexpr (is_ios)
     mflags |= PF::MF_EXEC;
 
-  // Allocate 2 pages block
-  codeBlock = QBDI::allocateMappedMemory(2 * pageSize, nullptr, mflags, ec);
+  // The dataBlock needs enough space for the shadows after the Context
+  uint64_t dataBlockSize = pageSize;
+  while (dataBlockSize < sizeof(Context) + MINIMAL_SHADOWS_SIZE) {
+    dataBlockSize += pageSize;
+  }
+
+  // Allocate the code page and the data pages in one block
+  codeBlock = QBDI::allocateMappedMemory(pageSize + dataBlockSize, nullptr,
+                                         mflags, ec);
   QBDI_REQUIRE_ABORT(codeBlock.base() != nullptr, "allocation fail");
   // Split it in two blocks
   dataBlock = llvm::sys::MemoryBlock(
       reinterpret_cast<void *>(reinterpret_cast<uint64_t>(codeBlock.base()) +
                                pageSize),
-      pageSize);
+      dataBlockSize);
   codeBlock = llvm::sys::MemoryBlock(codeBlock.base(), pageSize);
-  QBDI_DEBUG("codeBlock @ 0x{:x} | dataBlock @ 0x{:x} | pageSize {} bytes",
+  QBDI_DEBUG("codeBlock @ 0x{:x} | dataBlock @ 0x{:x} | pageSize {} bytes | "
+             "dataBlockSize {} bytes",
              reinterpret_cast<rword>(codeBlock.base()),
-             reinterpret_cast<rword>(dataBlock.base()), pageSize);
+             reinterpret_cast<rword>(dataBlock.base()), pageSize,
+             dataBlockSize);
 
   // Other initializations
   context = static_cast<Context *>(dataBlock.base());
@@ -89,6 +101,8 @@ ExecBlock::ExecBlock(
   currentInst = 0;
   codeBlockPosition = 0;
   codeBlockMaxSize = codeBlock.allocatedSize();
+  coldStubPosition = 0;
+  coldJumpPosition = 0;
   pageState = RW;
 
   std::vector<std::unique_ptr<RelocatableInst>> execBlockPrologue_;
@@ -141,29 +155,38 @@ void ExecBlock::show() const {
   rword i;
   uint64_t instSize;
   bool dstatus;
-  llvm::ArrayRef<uint8_t> jitCode(
-      static_cast<const uint8_t *>(codeBlock.base()), codeBlockPosition);
   size_t mode = 0;
   const LLVMCPU *llvmcpu = &llvmCPUs.getCPU((CPUMode)mode);
 
-  fprintf(stderr, "---- JIT CODE ----\n");
-  for (i = 0; i < jitCode.size(); i += instSize) {
-    llvm::MCInst inst;
-    std::string disass;
-
-    dstatus = llvmcpu->getInstruction(inst, instSize, jitCode.slice(i), i);
-    if constexpr (CPUMode::COUNT > 1) {
-      if (CPUMode::COUNT > 1 and not dstatus) { // Try to switch mode
-        mode = (mode + 1) % CPUMode::COUNT;
-        llvmcpu = &llvmCPUs.getCPU((CPUMode)mode);
-        dstatus = llvmcpu->getInstruction(inst, instSize, jitCode.slice(i), i);
+  auto showCode = [&](unsigned start, unsigned end) {
+    llvm::ArrayRef<uint8_t> jitCode(
+        static_cast<const uint8_t *>(codeBlock.base()) + start, end - start);
+    for (i = 0; i < jitCode.size(); i += instSize) {
+      llvm::MCInst inst;
+      std::string disass;
+
+      dstatus = llvmcpu->getInstruction(inst, instSize, jitCode.slice(i), i);
+      if constexpr (CPUMode::COUNT > 1) {
+        if (CPUMode::COUNT > 1 and not dstatus) { // Try to switch mode
+          mode = (mode + 1) % CPUMode::COUNT;
+          llvmcpu = &llvmCPUs.getCPU((CPUMode)mode);
+          dstatus =
+              llvmcpu->getInstruction(inst, instSize, jitCode.slice(i), i);
+        }
       }
+      QBDI_REQUIRE_ACTION(dstatus, break);
+
+      disass = llvmcpu->showInst(
+          inst, reinterpret_cast<rword>(codeBlock.base()) + start + i);
+      fprintf(stderr, "%s\n", disass.c_str());
     }
-    QBDI_REQUIRE_ACTION(dstatus, break);
+  };
 
-    disass =
-        llvmcpu->showInst(inst, reinterpret_cast<rword>(codeBlock.base()) + i);
-    fprintf(stderr, "%s\n", disass.c_str());
+  fprintf(stderr, "---- JIT CODE ----\n");
+  showCode(0, codeBlockPosition);
+  if (codeBlockMaxSize < codeBlock.allocatedSize() - epilogueSize) {
+    fprintf(stderr, "---- COLD STUBS ----\n");
+    showCode(codeBlockMaxSize, codeBlock.allocatedSize() - epilogueSize);
   }
 
   fprintf(stderr, "---- CONTEXT ----\n");
@@ -303,9 +326,28 @@ bool ExecBlock::writeCodeByte(const llvm::ArrayRef<char> &array) {
 bool ExecBlock::applyRelocatedInst(
     const std::vector<std::unique_ptr<RelocatableInst>> &reloc,
     std::vector<TagInfo> *tags, const LLVMCPU &llvmcpu, unsigned limit) {
+  return applyRelocatedInst(reloc.cbegin(), reloc.cend(), tags, llvmcpu, limit);
+}
 
-  for (const RelocatableInst::UniquePtr &inst : reloc) {
-    if (inst->getTag() != RelocatableInstTag::RelocInst) {
+bool ExecBlock::applyRelocatedInst(
+    std::vector<std::unique_ptr<RelocatableInst>>::const_iterator begin,
+    std::vector<std::unique_ptr<RelocatableInst>>::const_iterator end,
+    std::vector<TagInfo> *tags, const LLVMCPU &llvmcpu, unsigned limit) {
+
+  for (auto it = begin; it != end; it++) {
+    const RelocatableInst::UniquePtr &inst = *it;
+    if (inst->getTag() == RelocatableInstTag::RelocTagColdBegin) {
+      auto coldEnd = std::find_if(
+          it, end, [](const RelocatableInst::UniquePtr &r) {
+            return r->getTag() == RelocatableInstTag::RelocTagColdEnd;
+          });
+      QBDI_REQUIRE_ABORT(coldEnd != end, "Internal Error: cold stub not ended");
+      if (not writeColdStub(it + 1, coldEnd, tags, llvmcpu, limit)) {
+        return false;
+      }
+      it = coldEnd;
+      continue;
+    } else if (inst->getTag() != RelocatableInstTag::RelocInst) {
       QBDI_DEBUG("RelocTag 0x{:x}", inst->getTag());
       if (tags != nullptr) {
         tags->push_back(TagInfo{static_cast<uint16_t>(inst->getTag()),
@@ -337,10 +379,47 @@ bool ExecBlock::applyRelocatedInst(
   return true;
 }
 
+bool ExecBlock::writeColdStub(
+    std::vector<std::unique_ptr<RelocatableInst>>::const_iterator begin,
+    std::vector<std::unique_ptr<RelocatableInst>>::const_iterator end,
+    std::vector<TagInfo> *tags, const LLVMCPU &llvmcpu, unsigned limit) {
+
+  unsigned stubSize = 0;
+  for (auto it = begin; it != end; it++) {
+    QBDI_REQUIRE_ABORT((*it)->getTag() != RelocatableInstTag::RelocTagColdBegin,
+                       "Internal Error: nested cold stub");
+    if ((*it)->getTag() == RelocatableInstTag::RelocInst) {
+      stubSize += (*it)->getSize(llvmcpu);
+    }
+  }
+  if (codeBlockMaxSize - codeBlockPosition < stubSize + limit) {
+    QBDI_DEBUG("Not enough space left for a cold stub of {} bytes", stubSize);
+    return false;
+  }
+
+  // The stub is written just before the previous stubs. The hot code resumes
+  // at the current position with the jump to the stub.
+  unsigned hotPosition = codeBlockPosition;
+  coldJumpPosition = hotPosition;
+  coldStubPosition = codeBlockMaxSize - stubSize;
+  codeBlockPosition = coldStubPosition;
+
+  bool res = applyRelocatedInst(begin, end, tags, llvmcpu, 0);
+  QBDI_REQUIRE_ABORT(not res or codeBlockPosition == codeBlockMaxSize,
+                     "Internal Error: wrong cold stub size");
+
+  codeBlockPosition = hotPosition;
+  if (res) {
+    codeBlockMaxSize = coldStubPosition;
+  }
+  return res;
+}
+
 SeqWriteResult
 ExecBlock::writeSequence(std::vector<Patch>::const_iterator seqIt,
                          std::vector<Patch>::const_iterator seqEnd) {
   unsigned startOffset = codeBlockPosition;
+  unsigned startColdOffset = codeBlockMaxSize;
   uint16_t startInstID = getNextInstID();
   uint16_t seqID = getNextSeqID();
   uint8_t executeFlags = 0;
@@ -375,6 +454,7 @@ ExecBlock::writeSequence(std::vector<Patch>::const_iterator seqIt,
   // entierty
   while (seqIt != seqEnd) {
     unsigned rollbackOffset = codeBlockPosition;
+    unsigned rollbackColdOffset = codeBlockMaxSize;
     uint32_t rollbackShadowIdx = shadowIdx;
     size_t rollbackShadowRegistry = shadowRegistry.size();
     size_t rollbackTagRegistry = tagRegistry.size();
@@ -401,6 +481,7 @@ ExecBlock::writeSequence(std::vector<Patch>::const_iterator seqIt,
       // Seek to the last complete patch written and terminate it with a
       // terminator
       codeBlockPosition = rollbackOffset;
+      codeBlockMaxSize = rollbackColdOffset;
       // free shadows and tag allocated by the rollbacked code
       shadowIdx = rollbackShadowIdx;
       shadowRegistry.resize(rollbackShadowRegistry);
@@ -473,7 +554,8 @@ ExecBlock::writeSequence(std::vector<Patch>::const_iterator seqIt,
   seqRegistry.push_back(SeqInfo{startInstID, endInstID, executeFlags, cpuMode,
                                 instRegistry[startInstID].sr});
   // Return write results
-  unsigned bytesWritten = codeBlockPosition - startOffset;
+  unsigned bytesWritten =
+      codeBlockPosition - startOffset + startColdOffset - codeBlockMaxSize;
   QBDI_REQUIRE_ABORT(codeBlockPosition <=
                          codeBlock.allocatedSize() - epilogueSize,
                      "Internal Error, Overflow in Epilogue");
@@ -702,7 +784,7 @@ std::vector<TagInfo> ExecBlock::queryTagByInst(uint16_t instID,
 }
 
 float ExecBlock::occupationRatio() const {
-  return static_cast<float>(codeBlock.allocatedSize() - getEpilogueOffset()) /
+  return static_cast<float>(codeBlock.allocatedSize() - getAvailableSize()) /
          static_cast<float>(codeBlock.allocatedSize());
 }
 
@@ -109,6 +109,8 @@ private:
   llvm::sys::MemoryBlock dataBlock;
   unsigned codeBlockPosition;
   unsigned codeBlockMaxSize;
+  unsigned coldStubPosition;
+  unsigned coldJumpPosition;
   const LLVMCPUs &llvmCPUs;
   Context *context;
   rword *shadows;
@@ -159,6 +161,19 @@ private:
                      std::vector<TagInfo> *tags, const LLVMCPU &llvmcpu,
                      unsigned limit = 0);
 
+  bool applyRelocatedInst(
+      std::vector<std::unique_ptr<RelocatableInst>>::const_iterator begin,
+      std::vector<std::unique_ptr<RelocatableInst>>::const_iterator end,
+      std::vector<TagInfo> *tags, const LLVMCPU &llvmcpu, unsigned limit);
+
+  /*! Write a cold stub at the end of the free space of the code block, before
+   * the previous stubs. The hot code only keeps the jump to the stub.
+   */
+  bool writeColdStub(
+      std::vector<std::unique_ptr<RelocatableInst>>::const_iterator begin,
+      std::vector<std::unique_ptr<RelocatableInst>>::const_iterator end,
+      std::vector<TagInfo> *tags, const LLVMCPU &llvmcpu, unsigned limit);
+
   void finalizeScratchRegisterForPatch();
 
 public:
@@ -255,6 +270,33 @@ public:
    */
   uint32_t getEpilogueSize() const { return epilogueSize; }
 
+  /*! Get the code space left between the current code stream position and the
+   * cold stubs written at the end of the code block.
+   *
+   * @return The remaining code space.
+   */
+  rword getAvailableSize() const {
+    return codeBlockMaxSize - codeBlockPosition;
+  }
+
+  /*! Compute the offset between the current code stream position and the last
+   * cold stub written. Used for jumping to the cold stub.
+   *
+   * @return The computed offset.
+   */
+  rword getColdStubOffset() const {
+    return coldStubPosition - codeBlockPosition;
+  }
+
+  /*! Get the address of the jump to the last cold stub written. Used by the
+   * stub to resume the execution in the hot code.
+   *
+   * @return The address of the jump.
+   */
+  rword getColdJumpPC() const {
+    return reinterpret_cast<rword>(codeBlock.base()) + coldJumpPosition;
+  }
+
   /*! Obtain the value of the PC where the ExecBlock is currently writing
    * instructions.
    *
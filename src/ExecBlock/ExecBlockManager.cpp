@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 #include <algorithm>
+#include <atomic>
 #include <iterator>
 #include <stdlib.h>
 #include <utility>
@@ -45,12 +46,19 @@ inline rword getExecRegionKey(rword address, CPUMode cpumode) {
   return address;
 }
 
+// unique across the ExecBlockManagers of the process
+uint64_t newCacheGeneration() {
+  static std::atomic<uint64_t> generation{0};
+  return ++generation;
+}
+
 } // namespace
 
 ExecBlockManager::ExecBlockManager(const LLVMCPUs &llvmCPUs,
                                    VMInstanceRef vminstance)
-    : total_translated_size(1), total_translation_size(1),
-      vminstance(vminstance), llvmCPUs(llvmCPUs),
+    : total_translated_size(1), total_translation_size(1), needFlush(false),
+      cacheGeneration(newCacheGeneration()), vminstance(vminstance),
+      llvmCPUs(llvmCPUs),
       execBlockPrologue(
           getExecBlockPrologue(llvmCPUs.getCPU(CPUMode::DEFAULT))),
       execBlockEpilogue(
@@ -109,6 +117,9 @@ void ExecBlockManager::printCacheStatistics() const {
   }
   QBDI_DEBUG("\tMean occupation ratio: {}", mean_occupation);
   QBDI_DEBUG("\tRegion overflow count: {}", region_overflow);
+  QBDI_DEBUG("\tExpansion ratio: {} ({} bytes written for {} bytes of code)",
+             getExpansionRatio(), total_translation_size,
+             total_translated_size);
 }
 
 ExecBlock *ExecBlockManager::getProgrammedExecBlock(rword address,
@@ -500,7 +511,7 @@ size_t ExecBlockManager::findRegion(const Range<rword> &codeRange) {
 void ExecBlockManager::updateRegionStat(size_t r, rword translated) {
   regions[r].translated += translated;
   // Remaining code block space
-  regions[r].available = regions[r].blocks[0]->getEpilogueOffset();
+  regions[r].available = regions[r].blocks[0]->getAvailableSize();
   // Space which needs to be reserved for the non translated part of the covered
   // region
   unsigned reserved = static_cast<unsigned>(
@@ -542,6 +553,7 @@ void ExecBlockManager::flushCommit() {
                                  }),
                   regions.end());
     needFlush = false;
+    cacheGeneration = newCacheGeneration();
   }
 }
 
@@ -563,6 +575,7 @@ void ExecBlockManager::clearCache(bool flushNow) {
     total_translated_size = 1;
     total_translation_size = 1;
     needFlush = false;
+    cacheGeneration = newCacheGeneration();
   } else {
     for (auto &r : regions) {
       r.toFlush = true;
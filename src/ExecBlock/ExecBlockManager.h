@@ -76,6 +76,7 @@ private:
   rword total_translated_size;
   rword total_translation_size;
   bool needFlush;
+  uint64_t cacheGeneration;
 
   VMInstanceRef vminstance;
   const LLVMCPUs &llvmCPUs;
@@ -120,6 +121,12 @@ public:
 
   bool isFlushPending() { return needFlush; }
 
+  /*! Identifier of the content of the cache, changed each time some
+   * ExecRegions (and their InstAnalysis) are freed. Never shared by two
+   * ExecBlockManagers.
+   */
+  uint64_t getCacheGeneration() const { return cacheGeneration; }
+
   void flushCommit();
 
   void clearCache(bool flushNow = true);
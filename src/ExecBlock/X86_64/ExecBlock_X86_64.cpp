@@ -17,7 +17,9 @@
  * limitations under the License.
  */
 #include <memory>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <vector>
 
 #include "llvm/Support/Memory.h"
@@ -29,8 +31,15 @@
 #include "ExecBlock/X86_64/Context_X86_64.h"
 #include "Patch/Patch.h"
 #include "Patch/RelocatableInst.h"
+#include "Patch/X86_64/ExecBlockFlags_X86_64.h"
 #include "Utility/LogSys.h"
 
+#if defined(QBDI_ARCH_X86_64) && \
+    (defined(QBDI_PLATFORM_LINUX) || defined(QBDI_PLATFORM_ANDROID))
+#include <asm/prctl.h>
+#include <sys/syscall.h>
+#endif
+
 #if defined(QBDI_PLATFORM_WINDOWS)
 extern "C" void qbdi_runCodeBlock(void *codeBlock, QBDI::rword execflags);
 #else
@@ -42,6 +51,50 @@ static const uint32_t MINIMAL_BLOCK_SIZE = 64;
 
 namespace QBDI {
 
+#if defined(QBDI_ARCH_X86_64)
+// XSAVE and XSAVEOPT don't write the components in their initial
+// configuration: write the initial values in the FPRState.
+static void setXStateInitComponents(FPRState &fprState, uint64_t xstateMask) {
+  uint64_t initMask = xstateMask & ~fprState.xstate_bv;
+
+  if ((initMask & XStateComponent::XSTATE_X87) != 0) {
+    fprState.rfcw = 0x37F;
+    fprState.rfsw = 0;
+    fprState.ftw = 0;
+    fprState.fop = 0;
+    fprState.ip = 0;
+    fprState.cs = 0;
+    fprState.dp = 0;
+    fprState.ds = 0;
+    memset(&fprState.stmm0, 0,
+           offsetof(FPRState, xmm0) - offsetof(FPRState, stmm0));
+  }
+  if ((initMask & XStateComponent::XSTATE_SSE) != 0) {
+    memset(fprState.xmm0, 0,
+           offsetof(FPRState, reserved) - offsetof(FPRState, xmm0));
+  }
+  // getXStateMask only selects the components located as in the FPRState
+  for (const XStateComponentLayout &layout : XSTATE_EXTENDED_LAYOUT) {
+    if ((initMask & (1ULL << layout.index)) != 0) {
+      memset(reinterpret_cast<char *>(&fprState) + layout.offset, 0,
+             layout.size);
+    }
+  }
+}
+
+#if defined(QBDI_PLATFORM_LINUX) || defined(QBDI_PLATFORM_ANDROID)
+// arch_prctl without the libc: errno cannot be used when FS is the guest one.
+static inline void archPrctl(int code, rword addr) {
+  long ret;
+  asm volatile("syscall"
+               : "=a"(ret)
+               : "0"(SYS_arch_prctl), "D"(code), "S"(addr)
+               : "rcx", "r11", "memory");
+  QBDI_REQUIRE_ABORT(ret == 0, "arch_prctl {:x} fail", code);
+}
+#endif
+#endif // QBDI_ARCH_X86_64
+
 void ExecBlock::selectSeq(uint16_t seqID) {
   QBDI_REQUIRE(seqID < seqRegistry.size());
   currentSeq = seqID;
@@ -62,7 +115,42 @@ void ExecBlock::run() {
       makeRX();
     }
   }
+#if defined(QBDI_ARCH_X86_64)
+  Options opts = llvmCPUs.getCPU(CPUMode::DEFAULT).getOptions();
+  uint64_t xstateMask = getXStateMask(opts);
+  if (xstateMask != 0) {
+    // The FPRState may have been changed since the last XSAVE. XRSTOR must load
+    // every component from the FPRState and requires a valid XSAVE header.
+    context->fprState.xstate_bv = xstateMask;
+    context->fprState.xcomp_bv = 0;
+    memset(context->fprState.rsrv4, 0, sizeof(context->fprState.rsrv4));
+  }
+#if defined(QBDI_PLATFORM_LINUX) || defined(QBDI_PLATFORM_ANDROID)
+  bool switchFSGS =
+      (context->hostState.executeFlags & ExecBlockFlags::needFSGS) != 0 and
+      useArchPrctlFSGS(opts);
+  if (switchFSGS) {
+    archPrctl(ARCH_GET_FS, reinterpret_cast<rword>(&context->hostState.fs));
+    archPrctl(ARCH_GET_GS, reinterpret_cast<rword>(&context->hostState.gs));
+    archPrctl(ARCH_SET_GS, context->gprState.gs);
+    archPrctl(ARCH_SET_FS, context->gprState.fs);
+  }
+  qbdi_runCodeBlock(codeBlock.base(), context->hostState.executeFlags);
+  if (switchFSGS) {
+    archPrctl(ARCH_GET_FS, reinterpret_cast<rword>(&context->gprState.fs));
+    archPrctl(ARCH_GET_GS, reinterpret_cast<rword>(&context->gprState.gs));
+    archPrctl(ARCH_SET_FS, context->hostState.fs);
+    archPrctl(ARCH_SET_GS, context->hostState.gs);
+  }
+#else
   qbdi_runCodeBlock(codeBlock.base(), context->hostState.executeFlags);
+#endif
+  if (xstateMask != 0) {
+    setXStateInitComponents(context->fprState, xstateMask);
+  }
+#else
+  qbdi_runCodeBlock(codeBlock.base(), context->hostState.executeFlags);
+#endif
 }
 
 bool ExecBlock::writePatch(std::vector<Patch>::const_iterator seqCurrent,
@@ -72,7 +160,7 @@ bool ExecBlock::writePatch(std::vector<Patch>::const_iterator seqCurrent,
 
   QBDI_REQUIRE(p.finalize);
 
-  if (getEpilogueOffset() <= MINIMAL_BLOCK_SIZE) {
+  if (getAvailableSize() <= MINIMAL_BLOCK_SIZE) {
     isFull = true;
     return false;
   }
@@ -544,12 +544,21 @@ llvm::MCInst movrr(RegLLVM dst, RegLLVM src) {
   return inst;
 }
 
-llvm::MCInst movri(RegLLVM dst, uint16_t v) {
+llvm::MCInst movri(RegLLVM dst, uint16_t v, unsigned shift) {
   llvm::MCInst inst;
   inst.setOpcode(llvm::AArch64::MOVZXi);
   inst.addOperand(llvm::MCOperand::createReg(dst.getValue()));
   inst.addOperand(llvm::MCOperand::createImm(v));
-  inst.addOperand(llvm::MCOperand::createImm(0));
+  inst.addOperand(llvm::MCOperand::createImm(shift));
+  return inst;
+}
+
+llvm::MCInst movnri(RegLLVM dst, uint16_t v, unsigned shift) {
+  llvm::MCInst inst;
+  inst.setOpcode(llvm::AArch64::MOVNXi);
+  inst.addOperand(llvm::MCOperand::createReg(dst.getValue()));
+  inst.addOperand(llvm::MCOperand::createImm(v));
+  inst.addOperand(llvm::MCOperand::createImm(shift));
   return inst;
 }
 
@@ -96,7 +96,8 @@ llvm::MCInst msr(unsigned sysdst, RegLLVM src);
 llvm::MCInst mrs(RegLLVM dst, unsigned syssrc);
 
 llvm::MCInst movrr(RegLLVM dst, RegLLVM src);
-llvm::MCInst movri(RegLLVM dst, uint16_t v);
+llvm::MCInst movri(RegLLVM dst, uint16_t v, unsigned shift = 0);
+llvm::MCInst movnri(RegLLVM dst, uint16_t v, unsigned shift = 0);
 llvm::MCInst orrrs(RegLLVM dst, RegLLVM src1, RegLLVM src2, unsigned lshift);
 
 llvm::MCInst brk(unsigned imm);
@@ -848,4 +848,19 @@ void fixLLVMUsedGPR(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
                     std::array<RegisterUsage, NUM_GPR> &arr,
                     std::map<RegLLVM, RegisterUsage> &m) {}
 
+bool isFullGPRWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
+                    RegLLVM reg) {
+  // a write of a W register clears the upper part of the X register
+  return true;
+}
+
+bool mayReadFlags(const llvm::MCInst &inst, const LLVMCPU &llvmcpu) {
+  // no flags liveness analysis on this target
+  return true;
+}
+
+bool isFullFlagsWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu) {
+  return false;
+}
+
 } // namespace QBDI
@@ -99,15 +99,22 @@ int MovReg::getSize(const LLVMCPU &llvmcpu) const { return 4; }
 // =======
 
 llvm::MCInst LoadImm::reloc(ExecBlock *execBlock, CPUMode cpumode) const {
-  if (imm > 0xFFFF) {
-    uint16_t id = execBlock->newShadow();
-    execBlock->setShadow(id, imm);
-    rword offset = execBlock->getShadowOffset(id);
-    RegLLVM sr = execBlock->getScratchRegisterInfo().writeScratchRegister;
-
-    return ldr(reg, sr, offset);
+  rword v = imm;
+  // use a single MOVZ or MOVN when possible to avoid consuming a shadow
+  for (unsigned shift = 0; shift < 64; shift += 16) {
+    rword mask = ~(static_cast<rword>(0xFFFF) << shift);
+    if ((v & mask) == 0) {
+      return movri(reg, (v >> shift) & 0xFFFF, shift);
+    } else if ((~v & mask) == 0) {
+      return movnri(reg, (~v >> shift) & 0xFFFF, shift);
+    }
   }
-  return movri(reg, imm);
+  uint16_t id = execBlock->newShadow();
+  execBlock->setShadow(id, v);
+  rword offset = execBlock->getShadowOffset(id);
+  RegLLVM sr = execBlock->getScratchRegisterInfo().writeScratchRegister;
+
+  return ldr(reg, sr, offset);
 }
 
 int LoadImm::getSize(const LLVMCPU &llvmcpu) const { return 4; }
@@ -116,6 +116,12 @@ public:
   llvm::MCInst reloc(ExecBlock *execBlock, CPUMode cpumode) const override;
 
   int getSize(const LLVMCPU &llvmcpu) const override { return 4; }
+
+  rword getContextSyncGPR() const override {
+    rword sync1 = getContextSlotGPR(reg, offset);
+    rword sync2 = getContextSlotGPR(reg2, offset + sizeof(rword));
+    return (sync1 != 0 and sync2 != 0) ? (sync1 | sync2) : 0;
+  }
 };
 
 class StoreDataBlockX2 : public AutoClone<RelocatableInst, StoreDataBlockX2> {
@@ -132,6 +138,14 @@ public:
   llvm::MCInst reloc(ExecBlock *execBlock, CPUMode cpumode) const override;
 
   int getSize(const LLVMCPU &llvmcpu) const override { return 4; }
+
+  rword getContextSyncGPR() const override {
+    rword sync1 = getContextSlotGPR(reg, offset);
+    rword sync2 = getContextSlotGPR(reg2, offset + sizeof(rword));
+    return (sync1 != 0 and sync2 != 0) ? (sync1 | sync2) : 0;
+  }
+
+  bool isContextStore() const override { return true; }
 };
 
 } // namespace QBDI
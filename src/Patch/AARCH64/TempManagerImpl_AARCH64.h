@@ -25,6 +25,10 @@ namespace QBDI {
 
 static const std::set<Reg> TempManagerUnrestoreGPR = {Reg(28)};
 
+// GPR that the prologue doesn't restore from the Context (x28 and, on OSX, the
+// platform reserved x18)
+static const std::set<Reg> TempManagerUnsyncGPR = {Reg(18), Reg(28)};
+
 }
 
 #endif
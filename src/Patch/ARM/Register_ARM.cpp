@@ -651,4 +651,19 @@ void fixLLVMUsedGPR(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
   return;
 }
 
+bool isFullGPRWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
+                    RegLLVM reg) {
+  // a conditional instruction may not write the register
+  return getCondition(inst, llvmcpu) == llvm::ARMCC::AL;
+}
+
+bool mayReadFlags(const llvm::MCInst &inst, const LLVMCPU &llvmcpu) {
+  // no flags liveness analysis on this target
+  return true;
+}
+
+bool isFullFlagsWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu) {
+  return false;
+}
+
 } // namespace QBDI
@@ -15,10 +15,12 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <stdint.h>
 #include <stdlib.h>
 #include <utility>
 
+#include "QBDI/Config.h"
 #include "Engine/VM_internal.h"
 #include "Patch/InstMetadata.h"
 #include "Patch/InstrRule.h"
@@ -112,6 +114,11 @@ void InstrRule::instrument(Patch &patch,
     append(instru, std::move(restoreReg));
     append(instru, getBreakToHost(unrestoredReg[0], patch,
                                   tempManager.shouldRestore(unrestoredReg[0])));
+    // On X86, the whole instrumentation is written in a cold stub that ends
+    // with the break to host.
+    if constexpr (is_x86 or is_x86_64) {
+      instru.insert(instru.begin(), RelocTag::unique(RelocTagColdBegin));
+    }
   }
   // Normal case where we append the temporary register restoration code to the
   // instrumentation
@@ -178,11 +185,12 @@ RangeSet<rword> InstrRuleBasicCBK::affectedRange() const {
 InstrRuleDynamic::InstrRuleDynamic(PatchConditionUniquePtr &&condition,
                                    PatchGenMethod patchGenMethod,
                                    InstPosition position, bool breakToHost,
-                                   int priority, RelocatableInstTag tag)
+                                   int priority, RelocatableInstTag tag,
+                                   bool flagsLiveness)
     : AutoUnique<InstrRule, InstrRuleDynamic>(priority),
       condition(std::forward<PatchConditionUniquePtr>(condition)),
       patchGenMethod(patchGenMethod), position(position),
-      breakToHost(breakToHost), tag(tag) {}
+      breakToHost(breakToHost), tag(tag), flagsLiveness(flagsLiveness) {}
 
 InstrRuleDynamic::~InstrRuleDynamic() = default;
 
@@ -193,13 +201,87 @@ bool InstrRuleDynamic::canBeApplied(const Patch &patch,
 
 std::unique_ptr<InstrRule> InstrRuleDynamic::clone() const {
   return InstrRuleDynamic::unique(condition->clone(), patchGenMethod, position,
-                                  breakToHost, priority);
+                                  breakToHost, priority, tag, flagsLiveness);
 };
 
 RangeSet<rword> InstrRuleDynamic::affectedRange() const {
   return condition->affectedRange();
 }
 
+// InstrRuleAddrSet
+// ================
+
+InstrRuleAddrSet::InstrRuleAddrSet(InstPosition position, int priority,
+                                   RelocatableInstTag tag)
+    : AutoClone<InstrRule, InstrRuleAddrSet>(priority), position(position),
+      tag(tag) {}
+
+InstrRuleAddrSet::~InstrRuleAddrSet() = default;
+
+static inline rword addrSetKey(rword address) {
+  // for ARM, remove the LSB
+  if constexpr (is_arm) {
+    return address & (~1);
+  }
+  return address;
+}
+
+const InstrRuleAddrSet::AddrCBK *
+InstrRuleAddrSet::getAddrCBK(const Patch &patch) const {
+  auto it = callbacks.find(patch.metadata.address);
+  if (it == callbacks.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+RangeSet<rword> InstrRuleAddrSet::affectedRange() const {
+  // RangeSet::add is cheap when the ranges are added in order
+  std::vector<rword> addresses;
+  addresses.reserve(callbacks.size());
+  for (const auto &p : callbacks) {
+    addresses.push_back(p.first);
+  }
+  std::sort(addresses.begin(), addresses.end());
+
+  RangeSet<rword> r;
+  for (rword address : addresses) {
+    r.add(Range<rword>(address, address + 1));
+  }
+  return r;
+}
+
+bool InstrRuleAddrSet::setAddressCB(rword address, InstCallback cbk,
+                                    void *data) {
+  callbacks[addrSetKey(address)] = AddrCBK{cbk, data};
+  return true;
+}
+
+bool InstrRuleAddrSet::removeAddressCB(rword address) {
+  return callbacks.erase(addrSetKey(address)) != 0;
+}
+
+Range<rword> InstrRuleAddrSet::getAddressCBRange(rword address) const {
+  rword key = addrSetKey(address);
+  return Range<rword>(key, key + 1);
+}
+
+bool InstrRuleAddrSet::mayBreakToHost(const Patch &patch,
+                                      const LLVMCPU &llvmcpu) const {
+  return getAddrCBK(patch) != nullptr;
+}
+
+bool InstrRuleAddrSet::tryInstrument(Patch &patch,
+                                     const LLVMCPU &llvmcpu) const {
+  const AddrCBK *addrCBK = getAddrCBK(patch);
+  if (addrCBK == nullptr) {
+    return false;
+  }
+  instrument(patch, getCallbackGenerator(addrCBK->cbk, addrCBK->data), true,
+             position, priority, tag);
+  return true;
+}
+
 // InstrRuleUser
 // =============
 
@@ -212,6 +294,14 @@ InstrRuleUser::InstrRuleUser(InstrRuleCallback cbk, AnalysisType analysisType,
 
 InstrRuleUser::~InstrRuleUser() = default;
 
+bool InstrRuleUser::mayBreakToHost(const Patch &patch,
+                                   const LLVMCPU &llvmcpu) const {
+  // all the callbacks returned by the user break to the host
+  return range.contains(
+      Range<rword>(patch.metadata.address,
+                   patch.metadata.address + patch.metadata.instSize));
+}
+
 bool InstrRuleUser::tryInstrument(Patch &patch, const LLVMCPU &llvmcpu) const {
   if (!range.contains(
           Range<rword>(patch.metadata.address,
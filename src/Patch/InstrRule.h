@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "Patch/PatchUtils.h"
@@ -67,6 +68,40 @@ public:
 
   inline virtual bool changeDataPtr(void *data) { return false; };
 
+  /*! Add or replace the callback of an address. Only supported by the rules
+   * holding a set of addresses.
+   *
+   * @param[in] address  The address of the instruction
+   * @param[in] cbk      The callback to call
+   * @param[in] data     The data pointer to give to the callback
+   *
+   * @return True if the rule holds a set of addresses
+   */
+  inline virtual bool setAddressCB(rword address, InstCallback cbk,
+                                   void *data) {
+    return false;
+  };
+
+  /*! Remove the callback of an address. Only supported by the rules holding
+   * a set of addresses.
+   *
+   * @param[in] address  The address of the instruction
+   *
+   * @return True if the address was in the set
+   */
+  inline virtual bool removeAddressCB(rword address) { return false; };
+
+  /*! Get the range of the instruction whose callback is set or removed with
+   * an address. Only supported by the rules holding a set of addresses.
+   *
+   * @param[in] address  The address given to setAddressCB or removeAddressCB
+   *
+   * @return The range to clear from the cache
+   */
+  inline virtual Range<rword> getAddressCBRange(rword address) const {
+    return Range<rword>(address, address + 1);
+  };
+
   /*! Determine wheter this rule have to be apply on this Path and instrument if
    * needed.
    *
@@ -75,6 +110,23 @@ public:
    */
   virtual bool tryInstrument(Patch &patch, const LLVMCPU &llvmcpu) const = 0;
 
+  /*! Determine whether this rule may add a break to host on this Patch. The
+   * host callback can read or write all the registers of the GPRState.
+   *
+   * @param[in] patch     The current patch.
+   * @param[in] llvmcpu   LLVMCPU object
+   */
+  inline virtual bool mayBreakToHost(const Patch &patch,
+                                     const LLVMCPU &llvmcpu) const {
+    return true;
+  }
+
+  /*! Determine whether the patches of this rule need the liveness of the
+   * status flags (Patch::flagsDead), as SaveFlags and RestoreFlags. The
+   * liveness is only computed for the sequences instrumented by such a rule.
+   */
+  inline virtual bool needFlagsLiveness() const { return false; }
+
   /*! Instrument a patch by evaluating its generators on the current context.
    * Also handles the temporary register management for this patch.
    *
@@ -143,6 +195,11 @@ public:
 
   bool changeDataPtr(void *data) override;
 
+  inline bool mayBreakToHost(const Patch &patch,
+                             const LLVMCPU &llvmcpu) const override {
+    return breakToHost and canBeApplied(patch, llvmcpu);
+  }
+
   inline bool tryInstrument(Patch &patch,
                             const LLVMCPU &llvmcpu) const override {
     if (canBeApplied(patch, llvmcpu)) {
@@ -163,6 +220,7 @@ class InstrRuleDynamic : public AutoUnique<InstrRule, InstrRuleDynamic> {
   InstPosition position;
   bool breakToHost;
   RelocatableInstTag tag;
+  bool flagsLiveness;
 
 public:
   /*! Allocate a new instrumentation rule with a condition, a method to generate
@@ -180,11 +238,14 @@ public:
    *                             host (in the case of a callback for example).
    * @param[in] priority         Priority of the callback
    * @param[in] tag              A tag for the callback
+   * @param[in] flagsLiveness    The generated patches use the liveness of the
+   *                             status flags (see needFlagsLiveness).
    */
   InstrRuleDynamic(PatchConditionUniquePtr &&condition,
                    PatchGenMethod patchGenMethod, InstPosition position,
                    bool breakToHost, int priority = PRIORITY_DEFAULT,
-                   RelocatableInstTag tag = RelocTagInvalid);
+                   RelocatableInstTag tag = RelocTagInvalid,
+                   bool flagsLiveness = false);
 
   ~InstrRuleDynamic() override;
 
@@ -205,6 +266,13 @@ public:
    */
   bool canBeApplied(const Patch &patch, const LLVMCPU &llvmcpu) const;
 
+  inline bool mayBreakToHost(const Patch &patch,
+                             const LLVMCPU &llvmcpu) const override {
+    return breakToHost and canBeApplied(patch, llvmcpu);
+  }
+
+  inline bool needFlagsLiveness() const override { return flagsLiveness; }
+
   inline bool tryInstrument(Patch &patch,
                             const LLVMCPU &llvmcpu) const override {
     if (canBeApplied(patch, llvmcpu)) {
@@ -216,6 +284,52 @@ public:
   }
 };
 
+class InstrRuleAddrSet : public AutoClone<InstrRule, InstrRuleAddrSet> {
+
+  struct AddrCBK {
+    InstCallback cbk;
+    void *data;
+  };
+
+  std::unordered_map<rword, AddrCBK> callbacks;
+  InstPosition position;
+  RelocatableInstTag tag;
+
+  const AddrCBK *getAddrCBK(const Patch &patch) const;
+
+public:
+  /*! Allocate a new instrumentation rule with a set of addresses, each with
+   * its own callback. The rule is tested with a single lookup per instruction
+   * whatever the number of addresses.
+   *
+   * @param[in] position     An enum indicating wether the callbacks should be
+   *                         positioned before the instruction or after it.
+   * @param[in] priority     Priority of the callbacks
+   * @param[in] tag          A tag for the callbacks
+   */
+  InstrRuleAddrSet(InstPosition position, int priority = PRIORITY_DEFAULT,
+                   RelocatableInstTag tag = RelocTagInvalid);
+
+  ~InstrRuleAddrSet() override;
+
+  inline InstPosition getPosition() const { return position; }
+
+  inline size_t size() const { return callbacks.size(); }
+
+  RangeSet<rword> affectedRange() const override;
+
+  bool setAddressCB(rword address, InstCallback cbk, void *data) override;
+
+  bool removeAddressCB(rword address) override;
+
+  Range<rword> getAddressCBRange(rword address) const override;
+
+  bool mayBreakToHost(const Patch &patch,
+                      const LLVMCPU &llvmcpu) const override;
+
+  bool tryInstrument(Patch &patch, const LLVMCPU &llvmcpu) const override;
+};
+
 class InstrRuleUser : public AutoClone<InstrRule, InstrRuleUser> {
 
   InstrRuleCallback cbk;
@@ -242,6 +356,9 @@ public:
 
   inline RangeSet<rword> affectedRange() const override { return range; }
 
+  bool mayBreakToHost(const Patch &patch,
+                      const LLVMCPU &llvmcpu) const override;
+
   bool tryInstrument(Patch &patch, const LLVMCPU &llvmcpu) const override;
 };
 
@@ -62,6 +62,13 @@ public:
   std::map<RegLLVM, RegisterUsage> regUsageExtra;
   // Registers used by the TempRegister for this patch
   std::set<RegLLVM> tempReg;
+  // Bitfield of the GPR that are dead before and after the instruction.
+  // The instrumentation can use them without a backup (see
+  // instrumentPatches)
+  rword deadGPR = 0;
+  // The status flags are dead before and after the instruction. The
+  // instrumentation can modify them without a backup (see instrumentPatches)
+  bool flagsDead = false;
   const LLVMCPU *llvmcpu;
   bool finalize = false;
 
@@ -167,4 +167,59 @@ void getUsedGPR(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
   });
 }
 
+rword getKilledGPR(const llvm::MCInst &inst, const LLVMCPU &llvmcpu) {
+
+  const llvm::MCInstrInfo &MCII = llvmcpu.getMCII();
+  const llvm::MCInstrDesc &desc = MCII.get(inst.getOpcode());
+  unsigned opIsUsedBegin = desc.getNumDefs();
+  unsigned opIsUsedEnd = inst.getNumOperands();
+  if (desc.isVariadic() and variadicOpsIsWrite(inst)) {
+    if (desc.getNumOperands() < 1) {
+      opIsUsedEnd = 0;
+    } else {
+      opIsUsedEnd = desc.getNumOperands() - 1;
+    }
+  }
+
+  rword killed = 0;
+  auto addKilled = [&](RegLLVM reg) {
+    if (not isFullGPRWrite(inst, llvmcpu, reg)) {
+      return;
+    }
+    for (int i = 0; i < getRegisterPacked(reg); i++) {
+      int id = getGPRPosition(getUpperRegister(reg, i));
+      if (id >= 0 and ((unsigned)id) < NUM_GPR) {
+        killed |= (((rword)1) << id);
+      }
+    }
+  };
+
+  for (unsigned int i = 0; i < inst.getNumOperands(); i++) {
+    const llvm::MCOperand &op = inst.getOperand(i);
+    if (op.isReg() and op.getReg() != /* NoRegister */ 0 and
+        (i < opIsUsedBegin or opIsUsedEnd <= i)) {
+      addKilled(op.getReg());
+    }
+  }
+
+  for (const unsigned implicitRegs : desc.implicit_defs()) {
+    if (implicitRegs) {
+      addKilled(implicitRegs);
+    }
+  }
+
+  return killed;
+}
+
+rword getContextSlotGPR(RegLLVM reg, int64_t offset) {
+  size_t pos = getGPRPosition(reg);
+  if (pos >= size_GPR_ID or pos >= NUM_GPR or GPR_ID[pos] != reg) {
+    return 0;
+  }
+  if (offset != static_cast<int64_t>(Reg(pos).offset())) {
+    return 0;
+  }
+  return ((rword)1) << pos;
+}
+
 } // namespace QBDI
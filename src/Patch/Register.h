@@ -91,6 +91,43 @@ void getUsedGPR(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
                 std::array<RegisterUsage, NUM_GPR> &regUsage,
                 std::map<RegLLVM, RegisterUsage> &regUsageExtra);
 
+/* Return true if a write of reg by the instruction always overwrites the whole
+ * GPR, regardless of its previous value (partial and conditional writes return
+ * false).
+ *
+ * This method is called by getKilledGPR and must be implemented by each target.
+ */
+bool isFullGPRWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
+                    RegLLVM reg);
+
+/* Get the GPR entirely overwritten by an instruction (needed for the register
+ * liveness analysis)
+ *
+ * The result is a bitfield of the position of the registers in the GPRState.
+ */
+rword getKilledGPR(const llvm::MCInst &inst, const LLVMCPU &llvmcpu);
+
+/* Return true if the instruction may read a status flag (needed for the flags
+ * liveness analysis)
+ *
+ * This method must be implemented by each target. A target without flags
+ * liveness support returns true.
+ */
+bool mayReadFlags(const llvm::MCInst &inst, const LLVMCPU &llvmcpu);
+
+/* Return true if the instruction always overwrites all the status flags,
+ * regardless of their previous value (needed for the flags liveness analysis)
+ *
+ * This method must be implemented by each target. A target without flags
+ * liveness support returns false.
+ */
+bool isFullFlagsWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu);
+
+/* Get the bit of reg in a GPR bitfield if offset is the slot of reg in the
+ * Context, 0 otherwise (reg isn't a full GPR or offset is another slot).
+ */
+rword getContextSlotGPR(RegLLVM reg, int64_t offset);
+
 }; // namespace QBDI
 
 #endif // REGISTER_H
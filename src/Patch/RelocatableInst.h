@@ -26,6 +26,7 @@
 #include "QBDI/State.h"
 #include "Patch/InstInfo.h"
 #include "Patch/PatchUtils.h"
+#include "Patch/Register.h"
 #include "Patch/Types.h"
 
 namespace QBDI {
@@ -47,6 +48,14 @@ public:
 
   virtual llvm::MCInst reloc(ExecBlock *execBlock, CPUMode cpumode) const = 0;
 
+  // If the instruction only loads or stores GPR from or to their own slot in
+  // the Context, return the bitfield of these GPR. Any other instruction
+  // returns 0 and may modify any register or the Context.
+  virtual rword getContextSyncGPR() const { return 0; }
+
+  // The instruction stores the GPR of getContextSyncGPR() in the Context
+  virtual bool isContextStore() const { return false; }
+
   virtual ~RelocatableInst() = default;
 };
 
@@ -135,6 +144,10 @@ public:
   llvm::MCInst reloc(ExecBlock *execBlock, CPUMode cpumode) const override;
 
   int getSize(const LLVMCPU &llvmcpu) const override;
+
+  rword getContextSyncGPR() const override {
+    return getContextSlotGPR(reg, offset);
+  }
 };
 
 class StoreDataBlock : public AutoClone<RelocatableInst, StoreDataBlock> {
@@ -150,6 +163,12 @@ public:
   llvm::MCInst reloc(ExecBlock *execBlock, CPUMode cpumode) const override;
 
   int getSize(const LLVMCPU &llvmcpu) const override;
+
+  rword getContextSyncGPR() const override {
+    return getContextSlotGPR(reg, offset);
+  }
+
+  bool isContextStore() const override { return true; }
 };
 
 class MovReg : public AutoClone<RelocatableInst, MovReg> {
@@ -30,6 +30,7 @@
 #include "Patch/InstMetadata.h"
 #include "Patch/Patch.h"
 #include "Patch/Register.h"
+#include "Patch/RelocatableInst.h"
 #include "Patch/TempManager.h"
 #include "Patch/Types.h"
 #include "Utility/LogSys.h"
@@ -105,6 +106,18 @@ Reg TempManager::getRegForTemp(unsigned int id) {
     }
   }
 
+  // Find a free register that is dead at this instruction (doesn't need to be
+  // saved)
+  for (unsigned i = _QBDI_FIRST_FREE_REGISTER; i < AVAILABLE_GPR; i++) {
+    Reg r = Reg(i);
+    if ((not usedRegister(r)) and patch.regUsage[i] == 0 and
+        isDeadRegister(r)) {
+      // store it and return it
+      associatedReg(id, r);
+      return r;
+    }
+  }
+
   // Find a free register
   for (unsigned i = _QBDI_FIRST_FREE_REGISTER; i < AVAILABLE_GPR; i++) {
     Reg r = Reg(i);
@@ -145,8 +158,12 @@ Reg::Vec TempManager::getUsedRegisters() const {
 
 size_t TempManager::getUsedRegisterNumber() const { return temps.size(); }
 
+bool TempManager::isDeadRegister(Reg r) const {
+  return (patch.deadGPR & (((rword)1) << r.getID())) != 0;
+}
+
 bool TempManager::shouldRestore(Reg r) const {
-  return TempManagerUnrestoreGPR.count(r) == 0;
+  return TempManagerUnrestoreGPR.count(r) == 0 and not isDeadRegister(r);
 }
 
 RegLLVM TempManager::getSizedSubReg(RegLLVM reg, unsigned size) const {
@@ -163,4 +180,50 @@ RegLLVM TempManager::getSizedSubReg(RegLLVM reg, unsigned size) const {
              reg.getValue(), MRI.getName(reg.getValue()));
 }
 
+void removeRedundantTempSave(std::vector<Patch> &basicBlock, size_t patchEnd) {
+  // Every entry in the sequence (begin of a Patch, return of a callback) comes
+  // from the prologue, that restores all the GPR except TempManagerUnsyncGPR.
+  // As the entries don't generate any instruction, a GPR is equal to its slot
+  // after a load or a store at this slot, until the next other instruction.
+  // The removed stores are only the backups that follow the restoration of
+  // the previous instrumentation: no relative jump targets or crosses them.
+  rword unsyncGPR = 0;
+  for (const Reg &r : TempManagerUnsyncGPR) {
+    unsyncGPR |= (((rword)1) << r.getID());
+  }
+
+  rword syncGPR = 0;
+  size_t removed = 0;
+  for (size_t i = 0; i < patchEnd; i++) {
+    Patch &patch = basicBlock[i];
+    RelocatableInst::UniquePtrVec &insts = patch.insts;
+    auto it = insts.begin();
+    while (it != insts.end()) {
+      const RelocatableInst &inst = **it;
+      // the tags don't generate any instruction
+      if (inst.getTag() != RelocatableInstTag::RelocInst) {
+        it++;
+        continue;
+      }
+      rword instSyncGPR = inst.getContextSyncGPR();
+      if (instSyncGPR != 0 and inst.isContextStore() and
+          (instSyncGPR & ~syncGPR) == 0) {
+        it = insts.erase(it);
+        patch.metadata.patchSize -= 1;
+        removed++;
+        continue;
+      }
+      if (instSyncGPR != 0) {
+        syncGPR |= instSyncGPR & ~unsyncGPR;
+      } else {
+        syncGPR = 0;
+      }
+      it++;
+    }
+  }
+  if (removed != 0) {
+    QBDI_DEBUG("Remove {} redundant backup of temporary registers", removed);
+  }
+}
+
 } // namespace QBDI
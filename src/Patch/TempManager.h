@@ -64,6 +64,9 @@ public:
 
   bool shouldRestore(Reg r) const;
 
+  // the register isn't used before being written by the next instructions
+  bool isDeadRegister(Reg r) const;
+
   bool usedRegister(Reg reg) const;
 
   bool isAllocatedId(unsigned int id) const;
@@ -81,6 +84,12 @@ public:
       Reg::Vec &unrestoredReg) const;
 };
 
+/* Remove the backups of the temporary registers in a sequence when the slot of
+ * the register in the Context already holds its value, because the previous
+ * instrumentation or Patch has just restored or saved it.
+ */
+void removeRedundantTempSave(std::vector<Patch> &basicBlock, size_t patchEnd);
+
 } // namespace QBDI
 
 #endif
@@ -252,6 +252,10 @@ public:
 enum RelocatableInstTag {
   RelocInst = 0,
   RelocTagChangeScratchRegister = 0x1,
+  // The RelocatableInst between these tags are written in a cold stub at the
+  // end of the code block. The stub must end with a jump out of it.
+  RelocTagColdBegin = 0x2,
+  RelocTagColdEnd = 0x3,
   RelocTagPatchBegin = 0x10,
   RelocTagPreInstMemAccess = 0x20,
   RelocTagPreInstStdCBK = 0x21,
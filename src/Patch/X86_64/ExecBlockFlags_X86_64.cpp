@@ -24,11 +24,13 @@
 #include "llvm/MC/MCInstrDesc.h"
 #include "llvm/MC/MCInstrInfo.h"
 
+#include "QBDI/Config.h"
 #include "Engine/LLVMCPU.h"
 #include "Patch/ExecBlockFlags.h"
 #include "Patch/Types.h"
 #include "Patch/X86_64/ExecBlockFlags_X86_64.h"
 #include "Utility/LogSys.h"
+#include "Utility/System.h"
 
 namespace QBDI {
 namespace {
@@ -38,7 +40,10 @@ struct ExecBlockFlagsArray {
 
   constexpr ExecBlockFlagsArray() : arr() {
     for (unsigned i = 0; i < llvm::X86::NUM_TARGET_REGS; i++) {
-      if (llvm::X86::YMM0 <= i && i <= llvm::X86::YMM15) {
+      if ((llvm::X86::YMM0 <= i && i <= llvm::X86::YMM31) ||
+          (llvm::X86::ZMM0 <= i && i <= llvm::X86::ZMM31) ||
+          (llvm::X86::XMM16 <= i && i <= llvm::X86::XMM31) ||
+          (llvm::X86::K0 <= i && i <= llvm::X86::K7)) {
         arr[i] = ExecBlockFlags::needAVX | ExecBlockFlags::needFPU;
       } else if ((llvm::X86::XMM0 <= i && i <= llvm::X86::XMM15) ||
                  (llvm::X86::ST0 <= i && i <= llvm::X86::ST7) ||
@@ -111,4 +116,70 @@ uint8_t getExecBlockFlags(const llvm::MCInst &inst,
   return flags;
 }
 
+uint64_t getXStateMask(Options opts) {
+#if defined(QBDI_ARCH_X86_64)
+  if ((opts & Options::OPT_DISABLE_FPR) != 0) {
+    return 0;
+  }
+  // LLVM only reports the features enabled by the OS in XCR0
+  static const uint64_t hostMask = []() -> uint64_t {
+    if (not isHostCPUFeaturePresent("xsave")) {
+      return 0;
+    }
+    uint64_t mask = XStateComponent::XSTATE_X87 | XStateComponent::XSTATE_SSE;
+    if (isHostCPUFeaturePresent("avx")) {
+      mask |= XStateComponent::XSTATE_AVX;
+      if (isHostCPUFeaturePresent("avx512f")) {
+        mask |= XStateComponent::XSTATE_OPMASK |
+                XStateComponent::XSTATE_ZMM_HI256 |
+                XStateComponent::XSTATE_HI16_ZMM;
+      }
+    }
+    // XSAVE writes each component at the offset given by the CPU. Don't
+    // switch the components that the CPU doesn't place as the FPRState: the
+    // AVX-512 state isn't switched, and the AVX state falls back to FXSAVE.
+    for (const XStateComponentLayout &layout : XSTATE_EXTENDED_LAYOUT) {
+      uint64_t component = 1ULL << layout.index;
+      if ((mask & component) == 0) {
+        continue;
+      }
+      uint32_t offset = 0, size = 0;
+      if (getXStateComponentLayout(layout.index, offset, size) and
+          offset == layout.offset and size == layout.size) {
+        continue;
+      }
+      QBDI_WARN("Unexpected layout of the XSAVE component {} (offset {}, size "
+                "{})",
+                layout.index, offset, size);
+      if (component == XStateComponent::XSTATE_AVX) {
+        return 0;
+      }
+      mask &= ~(XStateComponent::XSTATE_OPMASK |
+                XStateComponent::XSTATE_ZMM_HI256 |
+                XStateComponent::XSTATE_HI16_ZMM);
+    }
+    return mask;
+  }();
+  return hostMask;
+#else
+  return 0;
+#endif
+}
+
+bool useArchPrctlFSGS(Options opts) {
+  if constexpr (not is_x86_64) {
+    return false;
+  }
+  if ((opts & Options::OPT_ENABLE_FS_GS) == 0) {
+    return false;
+  }
+#if defined(QBDI_ARCH_X86_64)
+  if (isFSGSBaseEnabled()) {
+    return false;
+  }
+#endif
+  QBDI_REQUIRE_ABORT(is_linux or is_android, "Need CPU feature fsgsbase");
+  return true;
+}
+
 } // namespace QBDI
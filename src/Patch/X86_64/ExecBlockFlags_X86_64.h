@@ -18,8 +18,13 @@
 #ifndef ExecBlockFlags_X86_64_H
 #define ExecBlockFlags_X86_64_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "QBDI/Config.h"
+#include "QBDI/Options.h"
+#include "QBDI/State.h"
+
 namespace QBDI {
 
 typedef enum : uint8_t {
@@ -28,6 +33,50 @@ typedef enum : uint8_t {
   needFSGS = 1 << 2,
 } ExecBlockFlags;
 
-}
+// XSAVE state components (XCR0 bits) stored in the FPRState
+typedef enum : uint64_t {
+  XSTATE_X87 = 1 << 0,
+  XSTATE_SSE = 1 << 1,
+  XSTATE_AVX = 1 << 2,
+  XSTATE_OPMASK = 1 << 5,
+  XSTATE_ZMM_HI256 = 1 << 6,
+  XSTATE_HI16_ZMM = 1 << 7,
+} XStateComponent;
+
+#if defined(QBDI_ARCH_X86_64)
+struct XStateComponentLayout {
+  unsigned index; // bit of the component in XCR0
+  uint32_t offset;
+  uint32_t size;
+};
+
+// Location of the components beyond SSE in the FPRState, which follows the
+// standard XSAVE format of Intel. A component is only switched with XSAVE if
+// the host reports the same location in CPUID.(EAX=0DH,ECX=index).
+static const XStateComponentLayout XSTATE_EXTENDED_LAYOUT[] = {
+    {2, offsetof(FPRState, ymm0), offsetof(FPRState, rsrv5) -
+                                      offsetof(FPRState, ymm0)},
+    {5, offsetof(FPRState, k0), offsetof(FPRState, zmm0) -
+                                    offsetof(FPRState, k0)},
+    {6, offsetof(FPRState, zmm0), offsetof(FPRState, zmm16) -
+                                      offsetof(FPRState, zmm0)},
+    {7, offsetof(FPRState, zmm16), sizeof(FPRState) -
+                                       offsetof(FPRState, zmm16)},
+};
+#endif
+
+/* Get the XSAVE state components switched by the ExecBlock prologue and
+ * epilogue. Return 0 when the context switch uses FXSAVE (X86, host without
+ * XSAVE support or OPT_DISABLE_FPR).
+ */
+uint64_t getXStateMask(Options opts);
+
+/* Return true when the FS and GS bases are switched by the host with
+ * arch_prctl, because the OS doesn't allow the FSGSBASE instructions in
+ * userland. Abort if the bases cannot be switched.
+ */
+bool useArchPrctlFSGS(Options opts);
+
+} // namespace QBDI
 
 #endif
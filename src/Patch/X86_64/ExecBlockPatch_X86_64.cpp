@@ -16,7 +16,9 @@
  * limitations under the License.
  */
 #include <algorithm>
+#include <memory>
 #include <stddef.h>
+#include <stdint.h>
 #include <vector>
 
 #include "X86InstrInfo.h"
@@ -38,6 +40,49 @@
 
 namespace QBDI {
 
+// Load in EDX:EAX the XSAVE components to switch and apply xinst (XSAVE,
+// XSAVEOPT or XRSTOR) on the FPRState. The AVX and AVX-512 components are only
+// switched when the current sequence needs them.
+static RelocatableInst::UniquePtrVec
+getXStateSwitch(const LLVMCPU &llvmcpu, uint64_t xstateMask,
+                RelocatableInst::UniquePtr xinst) {
+  Options opts = llvmcpu.getOptions();
+  RelocatableInst::UniquePtrVec seq;
+  uint64_t baseMask =
+      xstateMask & (XStateComponent::XSTATE_X87 | XStateComponent::XSTATE_SSE);
+  // the size of LoadImm depends on the value
+  int xstateMaskSize = LoadImm(Reg(0), xstateMask).getSize(llvmcpu);
+  int baseMaskSize = LoadImm(Reg(0), baseMask).getSize(llvmcpu);
+  int switchSize =
+      LoadImm(Reg(3), 0).getSize(llvmcpu) + xinst->getSize(llvmcpu);
+
+  if ((opts & Options::OPT_DISABLE_OPTIONAL_FPR) == 0) {
+    append(seq,
+           LoadReg(Reg(0), Offset(offsetof(Context, hostState.executeFlags)))
+               .genReloc(llvmcpu));
+    seq.push_back(Test(Reg(0), ExecBlockFlags::needFPU));
+    if (baseMask != xstateMask) {
+      seq.push_back(
+          Je(7 + xstateMaskSize + 6 + baseMaskSize + switchSize + 4));
+      seq.push_back(Test(Reg(0), ExecBlockFlags::needAVX));
+      // mov doesn't change the flags of the test
+      seq.push_back(LoadImm::unique(Reg(0), xstateMask));
+      seq.push_back(Jne(baseMaskSize + 4));
+      seq.push_back(LoadImm::unique(Reg(0), baseMask));
+      // target jne needAVX
+    } else {
+      seq.push_back(Je(xstateMaskSize + switchSize + 4));
+      seq.push_back(LoadImm::unique(Reg(0), xstateMask));
+    }
+  } else {
+    seq.push_back(LoadImm::unique(Reg(0), xstateMask));
+  }
+  seq.push_back(LoadImm::unique(Reg(3), 0));
+  seq.push_back(std::move(xinst));
+  // target je needFPU
+  return seq;
+}
+
 RelocatableInst::UniquePtrVec getExecBlockPrologue(const LLVMCPU &llvmcpu) {
   Options opts = llvmcpu.getOptions();
   RelocatableInst::UniquePtrVec prologue;
@@ -46,7 +91,13 @@ RelocatableInst::UniquePtrVec getExecBlockPrologue(const LLVMCPU &llvmcpu) {
   append(prologue, SaveReg(Reg(REG_SP), Offset(offsetof(Context, hostState.sp)))
                        .genReloc(llvmcpu));
   // Restore FPR
-  if ((opts & Options::OPT_DISABLE_FPR) == 0) {
+  uint64_t xstateMask = getXStateMask(opts);
+  if (xstateMask != 0) {
+    QBDI_DEBUG("XSAVE context switch enabled (components 0x{:x})", xstateMask);
+    append(prologue,
+           getXStateSwitch(llvmcpu, xstateMask,
+                           Xrstor(Offset(offsetof(Context, fprState)))));
+  } else if ((opts & Options::OPT_DISABLE_FPR) == 0) {
     if ((opts & Options::OPT_DISABLE_OPTIONAL_FPR) == 0) {
       append(prologue,
              LoadReg(Reg(0), Offset(offsetof(Context, hostState.executeFlags)))
@@ -120,11 +171,9 @@ RelocatableInst::UniquePtrVec getExecBlockPrologue(const LLVMCPU &llvmcpu) {
     }
   }
 #if defined(QBDI_ARCH_X86_64)
-  // if enable FS GS
-  if ((opts & Options::OPT_ENABLE_FS_GS) == Options::OPT_ENABLE_FS_GS) {
-    QBDI_REQUIRE_ABORT(isHostCPUFeaturePresent("fsgsbase"),
-                       "Need CPU feature fsgsbase");
-
+  // if enable FS GS (ExecBlock::run switches them without FSGSBASE support)
+  if ((opts & Options::OPT_ENABLE_FS_GS) == Options::OPT_ENABLE_FS_GS and
+      not useArchPrctlFSGS(opts)) {
     append(prologue,
            LoadReg(Reg(0), Offset(offsetof(Context, hostState.executeFlags)))
                .genReloc(llvmcpu));
@@ -175,11 +224,9 @@ RelocatableInst::UniquePtrVec getExecBlockEpilogue(const LLVMCPU &llvmcpu) {
   append(epilogue, SaveReg(Reg(0), Offset(offsetof(Context, gprState.eflags)))
                        .genReloc(llvmcpu));
 #if defined(QBDI_ARCH_X86_64)
-  // if enable FS GS
-  if ((opts & Options::OPT_ENABLE_FS_GS) == Options::OPT_ENABLE_FS_GS) {
-    QBDI_REQUIRE_ABORT(isHostCPUFeaturePresent("fsgsbase"),
-                       "Need CPU feature fsgsbase");
-
+  // if enable FS GS (ExecBlock::run switches them without FSGSBASE support)
+  if ((opts & Options::OPT_ENABLE_FS_GS) == Options::OPT_ENABLE_FS_GS and
+      not useArchPrctlFSGS(opts)) {
     append(epilogue,
            LoadReg(Reg(0), Offset(offsetof(Context, hostState.executeFlags)))
                .genReloc(llvmcpu));
@@ -201,7 +248,20 @@ RelocatableInst::UniquePtrVec getExecBlockEpilogue(const LLVMCPU &llvmcpu) {
   }
 #endif // QBDI_ARCH_X86_64
   // Save FPR
-  if ((opts & Options::OPT_DISABLE_FPR) == 0) {
+  uint64_t xstateMask = getXStateMask(opts);
+  if (xstateMask != 0) {
+    // XSAVEOPT doesn't write the components in their initial state nor the
+    // components unmodified since the XRSTOR of the prologue.
+    if (isHostCPUFeaturePresent("xsaveopt")) {
+      append(epilogue,
+             getXStateSwitch(llvmcpu, xstateMask,
+                             Xsaveopt(Offset(offsetof(Context, fprState)))));
+    } else {
+      append(epilogue,
+             getXStateSwitch(llvmcpu, xstateMask,
+                             Xsave(Offset(offsetof(Context, fprState)))));
+    }
+  } else if ((opts & Options::OPT_DISABLE_FPR) == 0) {
     if ((opts & Options::OPT_DISABLE_OPTIONAL_FPR) == 0) {
       append(epilogue,
              LoadReg(Reg(0), Offset(offsetof(Context, hostState.executeFlags)))
@@ -3020,6 +3020,46 @@ bool hasREPPrefix(const llvm::MCInst &instr) {
          llvm::X86::IP_NO_PREFIX;
 }
 
+bool hasREPFixedCount(const llvm::MCInst &instr) {
+  if (not hasREPPrefix(instr)) {
+    return false;
+  }
+  switch (instr.getOpcode()) {
+    case llvm::X86::INSB:
+    case llvm::X86::INSL:
+    case llvm::X86::INSW:
+    case llvm::X86::LODSB:
+    case llvm::X86::LODSL:
+    case llvm::X86::LODSQ:
+    case llvm::X86::LODSW:
+    case llvm::X86::MOVSB:
+    case llvm::X86::MOVSL:
+    case llvm::X86::MOVSQ:
+    case llvm::X86::MOVSW:
+    case llvm::X86::OUTSB:
+    case llvm::X86::OUTSL:
+    case llvm::X86::OUTSW:
+    case llvm::X86::STOSB:
+    case llvm::X86::STOSL:
+    case llvm::X86::STOSQ:
+    case llvm::X86::STOSW:
+      return true;
+    default:
+      return false;
+  }
+}
+
+rword getREPCountMask(const llvm::MCInst &instr) {
+  // the address size override also changes the size of the counter
+  if ((instr.getFlags() & llvm::X86::IP_HAS_AD_SIZE) == 0) {
+    return ~static_cast<rword>(0);
+  } else if constexpr (is_x86_64) {
+    return 0xFFFFFFFF;
+  } else {
+    return 0xFFFF;
+  }
+}
+
 bool implicitDSIAccess(const llvm::MCInst &inst,
                        const llvm::MCInstrDesc &desc) {
 
@@ -3045,6 +3085,41 @@ bool implicitDSIAccess(const llvm::MCInst &inst,
   }
 }
 
+bool isMaskedAccess(const llvm::MCInst &inst, const llvm::MCInstrDesc &desc) {
+  // the AVX512 instructions with a mask register
+  if ((desc.TSFlags & llvm::X86II::EVEX_K) != 0) {
+    return true;
+  }
+
+  switch (inst.getOpcode()) {
+    case llvm::X86::MASKMOVDQU:
+    case llvm::X86::MASKMOVDQU64:
+    case llvm::X86::MMX_MASKMOVQ:
+    case llvm::X86::MMX_MASKMOVQ64:
+    case llvm::X86::VMASKMOVDQU:
+    case llvm::X86::VMASKMOVDQU64:
+    case llvm::X86::VMASKMOVPDYmr:
+    case llvm::X86::VMASKMOVPDYrm:
+    case llvm::X86::VMASKMOVPDmr:
+    case llvm::X86::VMASKMOVPDrm:
+    case llvm::X86::VMASKMOVPSYmr:
+    case llvm::X86::VMASKMOVPSYrm:
+    case llvm::X86::VMASKMOVPSmr:
+    case llvm::X86::VMASKMOVPSrm:
+    case llvm::X86::VPMASKMOVDYmr:
+    case llvm::X86::VPMASKMOVDYrm:
+    case llvm::X86::VPMASKMOVDmr:
+    case llvm::X86::VPMASKMOVDrm:
+    case llvm::X86::VPMASKMOVQYmr:
+    case llvm::X86::VPMASKMOVQYrm:
+    case llvm::X86::VPMASKMOVQmr:
+    case llvm::X86::VPMASKMOVQrm:
+      return true;
+    default:
+      return false;
+  }
+}
+
 bool unsupportedRead(const llvm::MCInst &inst) {
 
   switch (inst.getOpcode()) {
@@ -42,8 +42,19 @@ bool mayChangeWriteAddr(const llvm::MCInst &inst,
 
 bool hasREPPrefix(const llvm::MCInst &instr);
 
+// does the instruction have a REP prefix and is repeated exactly RCX times
+// (i.e. is not a REPE/REPNE CMPS or SCAS)
+bool hasREPFixedCount(const llvm::MCInst &instr);
+
+// mask of the counter register used by a REP prefix (RCX, ECX or CX)
+rword getREPCountMask(const llvm::MCInst &instr);
+
 bool implicitDSIAccess(const llvm::MCInst &inst, const llvm::MCInstrDesc &desc);
 
+// does the instruction only access the bytes selected by a mask. The other
+// bytes of the operand may not be mapped.
+bool isMaskedAccess(const llvm::MCInst &inst, const llvm::MCInstrDesc &desc);
+
 } // namespace QBDI
 
 #endif
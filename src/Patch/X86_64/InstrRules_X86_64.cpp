@@ -36,6 +36,10 @@ class Patch;
 /* Generate a series of RelocatableInst which when appended to an
  * instrumentation code trigger a break to host. It receive in argument a
  * temporary reg which will be used for computations then finally restored.
+ *
+ * The instrumentation is written in a cold stub: it must begin with the tag
+ * RelocTagColdBegin. The hot code only keeps the jump to the stub, followed by
+ * the target where the execution is resumed.
  */
 RelocatableInst::UniquePtrVec getBreakToHost(Reg temp, const Patch &patch,
                                              bool restore) {
@@ -43,12 +47,9 @@ RelocatableInst::UniquePtrVec getBreakToHost(Reg temp, const Patch &patch,
 
   QBDI_REQUIRE_ABORT(restore, "X86 don't have a temporary register");
 
-  // Use the temporary register to compute RIP + offset which is the address
-  // which will follow this patch and where the execution needs to be resumed
-  if constexpr (is_x86)
-    breakToHost.push_back(SetRegtoPCRel::unique(temp, 22));
-  else
-    breakToHost.push_back(Add(temp, Reg(REG_PC), 19));
+  // Use the temporary register to compute the address which follows the jump
+  // to the stub and where the execution needs to be resumed
+  breakToHost.push_back(SetRegtoColdReturn::unique(temp));
   // Set the selector to this address so the execution can be resumed when the
   // exec block will be reexecuted
   append(breakToHost,
@@ -59,6 +60,10 @@ RelocatableInst::UniquePtrVec getBreakToHost(Reg temp, const Patch &patch,
   // Jump to the epilogue to break to the host
   append(breakToHost, JmpEpilogue().genReloc(*patch.llvmcpu));
 
+  // end of the cold stub, jump to it from the hot code
+  breakToHost.push_back(RelocTag::unique(RelocTagColdEnd));
+  breakToHost.push_back(ColdStubJump::unique());
+
   // add target when callback return CONTINUE
   append(breakToHost, TargetPrologue().genReloc(patch));
 
@@ -17,6 +17,7 @@
  */
 
 #include "MCTargetDesc/X86BaseInfo.h"
+#include "MCTargetDesc/X86MCTargetDesc.h"
 #include "X86InstrInfo.h"
 #include "llvm/MC/MCInst.h"
 
@@ -191,6 +192,18 @@ llvm::MCInst movzx64rr8(RegLLVM dst, RegLLVM src) {
   return inst;
 }
 
+// mov of the 32-bit sub register, zero extended in the 64-bit register
+llvm::MCInst movzx64ri32(RegLLVM reg, uint32_t imm) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::MOV32ri);
+  inst.addOperand(llvm::MCOperand::createReg(
+      llvm::getX86SubSuperRegister(reg.getValue(), 32)));
+  inst.addOperand(llvm::MCOperand::createImm(imm));
+
+  return inst;
+}
+
 llvm::MCInst test32ri(RegLLVM base, uint32_t imm) {
   llvm::MCInst inst;
 
@@ -292,6 +305,45 @@ llvm::MCInst fxrstor(RegLLVM base, rword offset) {
   return inst;
 }
 
+llvm::MCInst xsave(RegLLVM base, rword offset) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::XSAVE);
+  inst.addOperand(llvm::MCOperand::createReg(base.getValue()));
+  inst.addOperand(llvm::MCOperand::createImm(1));
+  inst.addOperand(llvm::MCOperand::createReg(0));
+  inst.addOperand(llvm::MCOperand::createImm(offset));
+  inst.addOperand(llvm::MCOperand::createReg(0));
+
+  return inst;
+}
+
+llvm::MCInst xsaveopt(RegLLVM base, rword offset) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::XSAVEOPT);
+  inst.addOperand(llvm::MCOperand::createReg(base.getValue()));
+  inst.addOperand(llvm::MCOperand::createImm(1));
+  inst.addOperand(llvm::MCOperand::createReg(0));
+  inst.addOperand(llvm::MCOperand::createImm(offset));
+  inst.addOperand(llvm::MCOperand::createReg(0));
+
+  return inst;
+}
+
+llvm::MCInst xrstor(RegLLVM base, rword offset) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::XRSTOR);
+  inst.addOperand(llvm::MCOperand::createReg(base.getValue()));
+  inst.addOperand(llvm::MCOperand::createImm(1));
+  inst.addOperand(llvm::MCOperand::createReg(0));
+  inst.addOperand(llvm::MCOperand::createImm(offset));
+  inst.addOperand(llvm::MCOperand::createReg(0));
+
+  return inst;
+}
+
 llvm::MCInst vextractf128(RegLLVM base, rword offset, RegLLVM src,
                           uint8_t regoffset) {
   llvm::MCInst inst;
@@ -435,6 +487,41 @@ llvm::MCInst pushf64() {
   return inst;
 }
 
+llvm::MCInst lahf() {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::LAHF);
+
+  return inst;
+}
+
+llvm::MCInst sahf() {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::SAHF);
+
+  return inst;
+}
+
+llvm::MCInst seto(RegLLVM reg) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::SETCCr);
+  inst.addOperand(llvm::MCOperand::createReg(reg.getValue()));
+  inst.addOperand(llvm::MCOperand::createImm(llvm::X86::CondCode::COND_O));
+
+  return inst;
+}
+
+llvm::MCInst add8i8(int8_t imm) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::ADD8i8);
+  inst.addOperand(llvm::MCOperand::createImm(imm));
+
+  return inst;
+}
+
 llvm::MCInst ret() {
   llvm::MCInst inst;
 
@@ -509,6 +596,24 @@ llvm::MCInst xor64rr(RegLLVM dst, RegLLVM src) {
   return inst;
 }
 
+llvm::MCInst xchg32ar(RegLLVM reg) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::XCHG32ar);
+  inst.addOperand(llvm::MCOperand::createReg(reg.getValue()));
+
+  return inst;
+}
+
+llvm::MCInst xchg64ar(RegLLVM reg) {
+  llvm::MCInst inst;
+
+  inst.setOpcode(llvm::X86::XCHG64ar);
+  inst.addOperand(llvm::MCOperand::createReg(reg.getValue()));
+
+  return inst;
+}
+
 // high level layer 2
 
 [[maybe_unused]] static bool isr8_15Reg(RegLLVM r) {
@@ -527,6 +632,11 @@ llvm::MCInst xor64rr(RegLLVM dst, RegLLVM src) {
   }
 }
 
+unsigned movzx64ri32Size(RegLLVM reg) {
+  // R8D to R15D need a REX prefix
+  return isr8_15Reg(reg) ? 6 : 5;
+}
+
 static unsigned lenInstLEAtype(RegLLVM base, RegLLVM scale, Constant cst,
                                RegLLVM segment) {
 
@@ -590,6 +700,18 @@ RelocatableInst::UniquePtr Fxrstor(Offset offset) {
   return DataBlockRelx86(fxrstor(0, 0), 0, offset, 7, 7);
 }
 
+RelocatableInst::UniquePtr Xsave(Offset offset) {
+  return DataBlockRelx86(xsave(0, 0), 0, offset, 7, 7);
+}
+
+RelocatableInst::UniquePtr Xsaveopt(Offset offset) {
+  return DataBlockRelx86(xsaveopt(0, 0), 0, offset, 7, 7);
+}
+
+RelocatableInst::UniquePtr Xrstor(Offset offset) {
+  return DataBlockRelx86(xrstor(0, 0), 0, offset, 7, 7);
+}
+
 RelocatableInst::UniquePtr Vextractf128(Offset offset, RegLLVM src,
                                         Constant regoffset) {
   return DataBlockRelx86(vextractf128(0, 0, src, regoffset), 0, offset, 10, 10);
@@ -637,6 +759,25 @@ RelocatableInst::UniquePtr Popf() {
     return NoRelocSized::unique(popf32(), 1);
 }
 
+RelocatableInst::UniquePtr Lahf() { return NoRelocSized::unique(lahf(), 1); }
+
+RelocatableInst::UniquePtr Sahf() { return NoRelocSized::unique(sahf(), 1); }
+
+RelocatableInst::UniquePtr SetoAL() {
+  return NoRelocSized::unique(seto(llvm::X86::AL), 3);
+}
+
+RelocatableInst::UniquePtr AddALi(int8_t imm) {
+  return NoRelocSized::unique(add8i8(imm), 2);
+}
+
+RelocatableInst::UniquePtr XchgAXr(Reg reg) {
+  if constexpr (is_x86_64)
+    return NoRelocSized::unique(xchg64ar(reg), 2);
+  else
+    return NoRelocSized::unique(xchg32ar(reg), 1);
+}
+
 RelocatableInst::UniquePtr Ret() { return NoRelocSized::unique(ret(), 1); }
 
 RelocatableInst::UniquePtr Test(Reg reg, uint32_t value) {
@@ -64,6 +64,10 @@ llvm::MCInst mov64rm(RegLLVM dst, RegLLVM base, rword scale, RegLLVM offset,
 
 llvm::MCInst movzx64rr8(RegLLVM dst, RegLLVM src);
 
+llvm::MCInst movzx64ri32(RegLLVM reg, uint32_t imm);
+
+unsigned movzx64ri32Size(RegLLVM reg);
+
 llvm::MCInst test32ri(RegLLVM base, uint32_t imm);
 
 llvm::MCInst test64ri32(RegLLVM base, uint32_t imm);
@@ -82,6 +86,12 @@ llvm::MCInst fxsave(RegLLVM base, rword offset);
 
 llvm::MCInst fxrstor(RegLLVM base, rword offset);
 
+llvm::MCInst xsave(RegLLVM base, rword offset);
+
+llvm::MCInst xsaveopt(RegLLVM base, rword offset);
+
+llvm::MCInst xrstor(RegLLVM base, rword offset);
+
 llvm::MCInst vextractf128(RegLLVM base, rword offset, RegLLVM src,
                           uint8_t regoffset);
 
@@ -114,6 +124,14 @@ llvm::MCInst popf32();
 
 llvm::MCInst popf64();
 
+llvm::MCInst lahf();
+
+llvm::MCInst sahf();
+
+llvm::MCInst seto(RegLLVM reg);
+
+llvm::MCInst add8i8(int8_t imm);
+
 llvm::MCInst ret();
 
 llvm::MCInst rdfsbase(RegLLVM reg);
@@ -130,6 +148,10 @@ llvm::MCInst xor32rr(RegLLVM dst, RegLLVM src);
 
 llvm::MCInst xor64rr(RegLLVM dst, RegLLVM src);
 
+llvm::MCInst xchg32ar(RegLLVM reg);
+
+llvm::MCInst xchg64ar(RegLLVM reg);
+
 // high level layer 2
 
 std::unique_ptr<RelocatableInst> JmpM(Offset offset);
@@ -138,6 +160,12 @@ std::unique_ptr<RelocatableInst> Fxsave(Offset offset);
 
 std::unique_ptr<RelocatableInst> Fxrstor(Offset offset);
 
+std::unique_ptr<RelocatableInst> Xsave(Offset offset);
+
+std::unique_ptr<RelocatableInst> Xsaveopt(Offset offset);
+
+std::unique_ptr<RelocatableInst> Xrstor(Offset offset);
+
 std::unique_ptr<RelocatableInst> Vextractf128(Offset offset, RegLLVM src,
                                               Constant regoffset);
 
@@ -154,6 +182,16 @@ std::unique_ptr<RelocatableInst> Pushf();
 
 std::unique_ptr<RelocatableInst> Popf();
 
+std::unique_ptr<RelocatableInst> Lahf();
+
+std::unique_ptr<RelocatableInst> Sahf();
+
+std::unique_ptr<RelocatableInst> SetoAL();
+
+std::unique_ptr<RelocatableInst> AddALi(int8_t imm);
+
+std::unique_ptr<RelocatableInst> XchgAXr(Reg reg);
+
 std::unique_ptr<RelocatableInst> Ret();
 
 std::unique_ptr<RelocatableInst> Test(Reg reg, uint32_t value);
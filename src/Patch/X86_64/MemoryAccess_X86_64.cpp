@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 #include <algorithm>
+#include <array>
 #include <memory>
 #include <stddef.h>
 #include <stdint.h>
@@ -27,6 +28,7 @@
 #include "llvm/MC/MCInstrInfo.h"
 
 #include "Engine/LLVMCPU.h"
+#include "ExecBlock/Context.h"
 #include "ExecBlock/ExecBlock.h"
 #include "Patch/InstInfo.h"
 #include "Patch/InstMetadata.h"
@@ -43,6 +45,7 @@
 
 #include "QBDI/Bitmask.h"
 #include "QBDI/Callback.h"
+#include "QBDI/Options.h"
 #include "QBDI/State.h"
 
 namespace llvm {
@@ -65,8 +68,36 @@ enum MemoryTag : uint16_t {
   MEM_READ_0_END_ADDRESS_TAG = MEMORY_TAG_BEGIN + 7,
   MEM_READ_1_END_ADDRESS_TAG = MEMORY_TAG_BEGIN + 8,
   MEM_WRITE_END_ADDRESS_TAG = MEMORY_TAG_BEGIN + 9,
+
+  MEM_VALUE_EXTENDED_TAG = MEMORY_TAG_BEGIN + 10,
 };
 
+// Direction Flag of EFLAGS
+static constexpr rword EFLAGS_DF = 1 << 10;
+
+// Maximum size of the range of a REP instruction reported before the
+// instruction. A larger range (or a counter that overflows) is reported as an
+// access of unknown size, as the REPE/REPNE instructions.
+static constexpr rword MAX_REP_RANGE_SIZE = 0x100000;
+
+// Maximum size of an access with OPT_RECORD_LARGE_MEMORY_VALUE
+static constexpr unsigned MAX_LARGE_VALUE_SIZE = 64;
+static constexpr size_t MAX_LARGE_VALUE_SHADOWS =
+    MAX_LARGE_VALUE_SIZE / sizeof(rword);
+
+// MemoryAccess::size is 16 bits long: split the large ranges in many accesses
+static void pushMemoryAccessRange(MemoryAccess &access, rword address,
+                                  rword size,
+                                  std::vector<MemoryAccess> &dest) {
+  do {
+    access.accessAddress = address;
+    access.size = std::min<rword>(size, 0x8000);
+    dest.push_back(access);
+    address += access.size;
+    size -= access.size;
+  } while (size > 0);
+}
+
 void analyseMemoryAccessAddrValue(const ExecBlock &curExecBlock,
                                   llvm::ArrayRef<ShadowInfo> &shadows,
                                   std::vector<MemoryAccess> &dest,
@@ -105,9 +136,39 @@ void analyseMemoryAccessAddrValue(const ExecBlock &curExecBlock,
   access.instAddress = curExecBlock.getInstAddress(shadows[0].instID);
 
   if (access.size > sizeof(rword)) {
-    access.flags |= MEMORY_UNKNOWN_VALUE;
-    access.value = 0;
-    dest.push_back(std::move(access));
+    // With OPT_RECORD_LARGE_MEMORY_VALUE, the value follows the address and
+    // the access is split in rword
+    if (shadows.size() < 2 or shadows[0].instID != shadows[1].instID or
+        shadows[1].tag != expectValueTag) {
+      access.flags |= MEMORY_UNKNOWN_VALUE;
+      access.value = 0;
+      dest.push_back(std::move(access));
+      return;
+    }
+    size_t remindSize = access.size;
+    access.size = sizeof(rword);
+    access.value = curExecBlock.getShadow(shadows[1].shadowID);
+    dest.push_back(access);
+    remindSize -= sizeof(rword);
+
+    for (size_t index = 2; remindSize > 0; ++index) {
+      QBDI_REQUIRE_ACTION(index < shadows.size(), return );
+      QBDI_REQUIRE_ACTION(shadows[0].instID == shadows[index].instID, return );
+      QBDI_REQUIRE_ACTION(shadows[index].tag == MEM_VALUE_EXTENDED_TAG,
+                          return );
+
+      access.accessAddress += sizeof(rword);
+      access.value = curExecBlock.getShadow(shadows[index].shadowID);
+      if (remindSize < sizeof(rword)) {
+        access.size = remindSize;
+        rword mask = (1ull << (access.size * 8)) - 1;
+        access.value &= mask;
+        remindSize = 0;
+      } else {
+        remindSize -= sizeof(rword);
+      }
+      dest.push_back(access);
+    }
     return;
   }
 
@@ -170,7 +231,32 @@ void analyseMemoryAccessAddrRange(const ExecBlock &curExecBlock,
   access.value = 0;
 
   if (not postInst) {
-    access.accessAddress = curExecBlock.getShadow(shadows[0].shadowID);
+    rword beginAddress = curExecBlock.getShadow(shadows[0].shadowID);
+    const llvm::MCInst &inst =
+        curExecBlock.getOriginalMCInst(shadows[0].instID);
+    if (hasREPFixedCount(inst)) {
+      // The analysis before the instruction is only done in PREINST: the
+      // context holds the counter and the flags used by the instruction.
+      // The instruction is repeated exactly RCX times. With DF=1, the memory
+      // is accessed between [beginAddress - (count - 1) * accessAtomicSize,
+      // beginAddress + accessAtomicSize)
+      const GPRState &gprState = curExecBlock.getContext()->gprState;
+      rword count = QBDI_GPR_GET(&gprState, 2 /* RCX */) &
+                    getREPCountMask(inst);
+      if (count == 0) {
+        // no access
+        return;
+      }
+      if (count <= MAX_REP_RANGE_SIZE / accessAtomicSize) {
+        rword size = count * accessAtomicSize;
+        if ((gprState.eflags & EFLAGS_DF) != 0) {
+          beginAddress = beginAddress + accessAtomicSize - size;
+        }
+        pushMemoryAccessRange(access, beginAddress, size, dest);
+        return;
+      }
+    }
+    access.accessAddress = beginAddress;
     access.flags |= MEMORY_UNKNOWN_SIZE;
     access.size = 0;
     dest.push_back(std::move(access));
@@ -194,18 +280,16 @@ void analyseMemoryAccessAddrRange(const ExecBlock &curExecBlock,
   rword endAddress = curExecBlock.getShadow(shadows[index].shadowID);
 
   if (endAddress >= beginAddress) {
-    access.accessAddress = beginAddress;
-    access.size = endAddress - beginAddress;
+    pushMemoryAccessRange(access, beginAddress, endAddress - beginAddress,
+                          dest);
   } else {
     // the endAddress is lesser than the begin address, this may be the case
     // in X86 with REP prefix and DF=1
     // In this case, the memory have been access between [endAddress +
     // accessSize, beginAddress + accessAtomicSize)
-    access.accessAddress = endAddress + accessAtomicSize;
-    access.size = beginAddress - endAddress;
+    pushMemoryAccessRange(access, endAddress + accessAtomicSize,
+                          beginAddress - endAddress, dest);
   }
-
-  dest.push_back(std::move(access));
 }
 
 void analyseMemoryAccess(const ExecBlock &curExecBlock, uint16_t instID,
@@ -235,7 +319,10 @@ void analyseMemoryAccess(const ExecBlock &curExecBlock, uint16_t instID,
                                      llvmcpu);
         break;
       case MEM_WRITE_BEGIN_ADDRESS_TAG:
-        if (afterInst) {
+        // the written range of a REP instruction with a fixed count is known
+        // before the instruction
+        if (afterInst or
+            hasREPFixedCount(curExecBlock.getOriginalMCInst(instID))) {
           analyseMemoryAccessAddrRange(curExecBlock, shadows, afterInst, dest,
                                        llvmcpu);
         }
@@ -245,6 +332,81 @@ void analyseMemoryAccess(const ExecBlock &curExecBlock, uint16_t instID,
   }
 }
 
+// Check if the value of an access larger than a rword can be recorded in
+// shadows. The last part of the access must be loadable with a single mov.
+// The whole operand of a masked access is not read: the masked bytes may not
+// be mapped, and aren't written.
+static bool recordLargeValue(const llvm::MCInst &inst, unsigned size,
+                             const LLVMCPU &llvmcpu) {
+  if ((llvmcpu.getOptions() & Options::OPT_RECORD_LARGE_MEMORY_VALUE) == 0) {
+    return false;
+  }
+  unsigned remain = size % sizeof(rword);
+  return size > sizeof(rword) and size <= MAX_LARGE_VALUE_SIZE and
+         (remain & (remain - 1)) == 0 and not isMinSizeRead(inst) and
+         not isMaskedAccess(inst, llvmcpu.getMCII().get(inst.getOpcode()));
+}
+
+enum LargeValueKind {
+  LARGE_READ_VALUE = 0,
+  LARGE_WRITE_VALUE,
+  LARGE_WRITE_VALUE_PREADDR,
+  LARGE_VALUE_KIND_NUM,
+};
+
+static PatchGenerator::UniquePtrVec
+buildLargeValuePatch(LargeValueKind kind, size_t nbShadow) {
+  PatchGenerator::UniquePtrVec r;
+  switch (kind) {
+    case LARGE_READ_VALUE:
+      r.push_back(GetReadAddress::unique(Temp(0)));
+      r.push_back(WriteTemp::unique(Temp(0), Shadow(MEM_READ_ADDRESS_TAG)));
+      break;
+    case LARGE_WRITE_VALUE:
+      r.push_back(GetWriteAddress::unique(Temp(0)));
+      r.push_back(WriteTemp::unique(Temp(0), Shadow(MEM_WRITE_ADDRESS_TAG)));
+      break;
+    default:
+      r.push_back(ReadTemp::unique(Temp(0), Shadow(MEM_WRITE_ADDRESS_TAG)));
+      break;
+  }
+  for (size_t i = 0; i < nbShadow; i++) {
+    uint16_t tag = MEM_VALUE_EXTENDED_TAG;
+    if (kind == LARGE_READ_VALUE) {
+      r.push_back(GetReadValue::unique(Temp(1), Temp(0), i));
+      if (i == 0) {
+        tag = MEM_READ_VALUE_TAG;
+      }
+    } else {
+      r.push_back(GetWriteValue::unique(Temp(1), Temp(0), i));
+      if (i == 0) {
+        tag = MEM_WRITE_VALUE_TAG;
+      }
+    }
+    r.push_back(WriteTemp::unique(Temp(1), Shadow(tag)));
+  }
+  return r;
+}
+
+// Patch to record the address and the value of an access larger than a rword.
+// The value is copied in consecutive shadows, one per rword.
+static const PatchGenerator::UniquePtrVec &
+getLargeValuePatch(LargeValueKind kind, unsigned size) {
+  using PatchArray = std::array<PatchGenerator::UniquePtrVec,
+                                MAX_LARGE_VALUE_SHADOWS + 1>;
+  static const std::array<PatchArray, LARGE_VALUE_KIND_NUM> patchs = []() {
+    std::array<PatchArray, LARGE_VALUE_KIND_NUM> r;
+    for (size_t k = 0; k < LARGE_VALUE_KIND_NUM; k++) {
+      for (size_t nb = 1; nb <= MAX_LARGE_VALUE_SHADOWS; nb++) {
+        r[k][nb] = buildLargeValuePatch(static_cast<LargeValueKind>(k), nb);
+      }
+    }
+    return r;
+  }();
+
+  return patchs[kind][(size + sizeof(rword) - 1) / sizeof(rword)];
+}
+
 static const PatchGenerator::UniquePtrVec &
 generatePreReadInstrumentPatch(Patch &patch, const LLVMCPU &llvmcpu) {
 
@@ -286,7 +448,10 @@ generatePreReadInstrumentPatch(Patch &patch, const LLVMCPU &llvmcpu) {
       return r;
     }
   } else {
-    if (getReadSize(patch.metadata.inst, llvmcpu) > sizeof(rword)) {
+    unsigned size = getReadSize(patch.metadata.inst, llvmcpu);
+    if (recordLargeValue(patch.metadata.inst, size, llvmcpu)) {
+      return getLargeValuePatch(LARGE_READ_VALUE, size);
+    } else if (size > sizeof(rword)) {
       static const PatchGenerator::UniquePtrVec r = conv_unique<PatchGenerator>(
           GetReadAddress::unique(Temp(0)),
           WriteTemp::unique(Temp(0), Shadow(MEM_READ_ADDRESS_TAG)));
@@ -366,7 +531,10 @@ generatePostWriteInstrumentPatch(Patch &patch, const LLVMCPU &llvmcpu) {
   // Some instruction need to have the address get before the instruction
   else if (mayChangeWriteAddr(patch.metadata.inst, desc) and
            not isStackWrite(patch.metadata.inst)) {
-    if (getWriteSize(patch.metadata.inst, llvmcpu) > sizeof(rword)) {
+    unsigned size = getWriteSize(patch.metadata.inst, llvmcpu);
+    if (recordLargeValue(patch.metadata.inst, size, llvmcpu)) {
+      return getLargeValuePatch(LARGE_WRITE_VALUE_PREADDR, size);
+    } else if (size > sizeof(rword)) {
       static const PatchGenerator::UniquePtrVec r;
       return r;
     } else {
@@ -377,7 +545,10 @@ generatePostWriteInstrumentPatch(Patch &patch, const LLVMCPU &llvmcpu) {
       return r;
     }
   } else {
-    if (getWriteSize(patch.metadata.inst, llvmcpu) > sizeof(rword)) {
+    unsigned size = getWriteSize(patch.metadata.inst, llvmcpu);
+    if (recordLargeValue(patch.metadata.inst, size, llvmcpu)) {
+      return getLargeValuePatch(LARGE_WRITE_VALUE, size);
+    } else if (size > sizeof(rword)) {
       static const PatchGenerator::UniquePtrVec r = conv_unique<PatchGenerator>(
           GetWriteAddress::unique(Temp(0)),
           WriteTemp::unique(Temp(0), Shadow(MEM_WRITE_ADDRESS_TAG)));
@@ -15,6 +15,7 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <stdint.h>
 #include <stdlib.h>
 #include <utility>
@@ -322,6 +323,49 @@ GetWriteAddress::generate(const Patch &patch, TempManager &temp_manager) const {
                    "Called on an instruction which does not make write access");
 }
 
+// Load the value of an access of size bytes. When the access is larger than a
+// rword, only the rword at the given index is loaded.
+static RelocatableInst::UniquePtrVec
+loadAccessValue(const Patch &patch, TempManager &temp_manager, Temp temp,
+                Temp address, RegLLVM seg, unsigned size, size_t index) {
+  RelocatableInst::UniquePtrVec res;
+  RegLLVM dst = temp_manager.getRegForTemp(temp);
+  RegLLVM addr = temp_manager.getRegForTemp(address);
+
+  if (size > sizeof(rword)) {
+    QBDI_REQUIRE_ABORT_PATCH(index * sizeof(rword) < size, patch,
+                             "Index {} out of an access of {} bytes", index,
+                             size);
+    if (index != 0) {
+      // the segment is applied on the load
+      res.push_back(Lea(dst, addr, 1, 0, index * sizeof(rword), 0));
+      addr = dst;
+    }
+    size = std::min<unsigned>(size - index * sizeof(rword), sizeof(rword));
+  } else {
+    QBDI_REQUIRE_ABORT_PATCH(index == 0, patch,
+                             "Unexpected index {} for an access of {} bytes",
+                             index, size);
+  }
+
+  if (is_bits_64 and size < sizeof(rword)) {
+    dst = temp_manager.getSizedSubReg(dst, 4);
+  }
+
+  if (size == 8) {
+    res.push_back(Mov64rm(dst, addr, seg));
+  } else if (size == 4) {
+    res.push_back(Mov32rm(dst, addr, seg));
+  } else if (size == 2) {
+    res.push_back(Mov32rm16(dst, addr, seg));
+  } else if (size == 1) {
+    res.push_back(Mov32rm8(dst, addr, seg));
+  } else {
+    QBDI_ABORT_PATCH(patch, "Unsupported access size {}", size);
+  }
+  return res;
+}
+
 // GetReadValue
 // ============
 
@@ -333,14 +377,6 @@ GetReadValue::generate(const Patch &patch, TempManager &temp_manager) const {
       size > 0, patch,
       "Called on an instruction which does not make read access");
 
-  RegLLVM dst = temp_manager.getRegForTemp(temp);
-
-  if (is_bits_64 and size < sizeof(rword)) {
-    dst = temp_manager.getSizedSubReg(dst, 4);
-  } else if (size > sizeof(rword)) {
-    return conv_unique<RelocatableInst>(Xorrr(dst, dst));
-  }
-  Reg addr = temp_manager.getRegForTemp(address);
   RegLLVM seg;
 
   const llvm::MCInstrDesc &desc =
@@ -371,17 +407,7 @@ GetReadValue::generate(const Patch &patch, TempManager &temp_manager) const {
     seg = inst.getOperand(realMemIndex + 4).getReg();
   }
 
-  if (size == 8) {
-    return conv_unique<RelocatableInst>(Mov64rm(dst, addr, seg));
-  } else if (size == 4) {
-    return conv_unique<RelocatableInst>(Mov32rm(dst, addr, seg));
-  } else if (size == 2) {
-    return conv_unique<RelocatableInst>(Mov32rm16(dst, addr, seg));
-  } else if (size == 1) {
-    return conv_unique<RelocatableInst>(Mov32rm8(dst, addr, seg));
-  } else {
-    QBDI_ABORT_PATCH(patch, "Unsupported read size {}", size);
-  }
+  return loadAccessValue(patch, temp_manager, temp, address, seg, size, index);
 }
 
 // GetWriteValue
@@ -396,14 +422,6 @@ GetWriteValue::generate(const Patch &patch, TempManager &temp_manager) const {
       size > 0, patch,
       "Called on an instruction which does not make write access");
 
-  RegLLVM dst = temp_manager.getRegForTemp(temp);
-
-  if (is_bits_64 and size < sizeof(rword)) {
-    dst = temp_manager.getSizedSubReg(dst, 4);
-  } else if (size > sizeof(rword)) {
-    return conv_unique<RelocatableInst>(Xorrr(dst, dst));
-  }
-  Reg addr = temp_manager.getRegForTemp(address);
   unsigned seg = 0;
 
   const llvm::MCInstrDesc &desc =
@@ -433,17 +451,36 @@ GetWriteValue::generate(const Patch &patch, TempManager &temp_manager) const {
     seg = inst.getOperand(realMemIndex + 4).getReg();
   }
 
-  if (size == 8) {
-    return conv_unique<RelocatableInst>(Mov64rm(dst, addr, seg));
-  } else if (size == 4) {
-    return conv_unique<RelocatableInst>(Mov32rm(dst, addr, seg));
-  } else if (size == 2) {
-    return conv_unique<RelocatableInst>(Mov32rm16(dst, addr, seg));
-  } else if (size == 1) {
-    return conv_unique<RelocatableInst>(Mov32rm8(dst, addr, seg));
-  } else {
-    QBDI_ABORT_PATCH(patch, "Unsupported written size {}", size);
+  return loadAccessValue(patch, temp_manager, temp, address, seg, size, index);
+}
+
+// SaveFlags
+// =========
+
+RelocatableInst::UniquePtrVec
+SaveFlags::generate(const Patch &patch, TempManager &temp_manager) const {
+  if (patch.flagsDead) {
+    return {};
+  }
+  Reg dst = temp_manager.getRegForTemp(temp);
+
+  return conv_unique<RelocatableInst>(MovReg::unique(dst, Reg(0)), Lahf(),
+                                      SetoAL(), XchgAXr(dst));
+}
+
+// RestoreFlags
+// ============
+
+RelocatableInst::UniquePtrVec
+RestoreFlags::generate(const Patch &patch, TempManager &temp_manager) const {
+  if (patch.flagsDead) {
+    return {};
   }
+  Reg src = temp_manager.getRegForTemp(temp);
+
+  // AL is 1 if OF was set: 0x1 + 0x7f overflows
+  return conv_unique<RelocatableInst>(XchgAXr(src), AddALi(0x7f), Sahf(),
+                                      XchgAXr(src));
 }
 
 } // namespace QBDI
@@ -190,6 +190,7 @@ class GetReadValue : public AutoClone<PatchGenerator, GetReadValue> {
 
   Temp temp;
   Temp address;
+  size_t index;
 
 public:
   /*! Resolve the memory address where the instructions will read its value and
@@ -199,8 +200,11 @@ public:
    * @param[in] temp      A temporary where the memory value will be copied.
    * @param[in] address   A temporary with the address to load. Unchanged
    *                      (except if also temp)
+   * @param[in] index     Index of the rword to load when the access is
+   *                      larger than a rword
    */
-  GetReadValue(Temp temp, Temp address) : temp(temp), address(address) {}
+  GetReadValue(Temp temp, Temp address, size_t index = 0)
+      : temp(temp), address(address), index(index) {}
 
   /*! Output:
    *
@@ -214,6 +218,7 @@ class GetWriteValue : public AutoClone<PatchGenerator, GetWriteValue> {
 
   Temp temp;
   Temp address;
+  size_t index;
 
 public:
   /*! Resolve the memory address where the instructions has written its value
@@ -224,8 +229,11 @@ public:
    *                      The written address must be in the tmp.
    * @param[in] address   A temporary with the address to load. Unchanged
    *                      (except if also temp)
+   * @param[in] index     Index of the rword to load when the access is
+   *                      larger than a rword
    */
-  GetWriteValue(Temp temp, Temp address) : temp(temp), address(address) {}
+  GetWriteValue(Temp temp, Temp address, size_t index = 0)
+      : temp(temp), address(address), index(index) {}
 
   /*! Output:
    *
@@ -235,6 +243,60 @@ public:
   generate(const Patch &patch, TempManager &temp_manager) const override;
 };
 
+class SaveFlags : public AutoClone<PatchGenerator, SaveFlags> {
+
+  Temp temp;
+
+public:
+  /*! Save the status flags in a temporary, before an instrumentation that
+   * modifies them. RAX is left unchanged. Nothing is generated if the flags
+   * are dead before and after the instruction (see Patch::flagsDead).
+   *
+   * The flags are saved with LAHF and SETO, which are much faster than PUSHF,
+   * and restored with RestoreFlags. DF and the system flags are not saved.
+   *
+   * @param[in] temp   A temporary where the flags will be saved.
+   */
+  SaveFlags(Temp temp) : temp(temp) {}
+
+  /*! Output:
+   *
+   * if the flags are live:
+   * MOV REG64 temp, REG64 RAX
+   * LAHF
+   * SETO REG8 AL
+   * XCHG REG64 RAX, REG64 temp
+   */
+  std::vector<std::unique_ptr<RelocatableInst>>
+  generate(const Patch &patch, TempManager &temp_manager) const override;
+};
+
+class RestoreFlags : public AutoClone<PatchGenerator, RestoreFlags> {
+
+  Temp temp;
+
+public:
+  /*! Restore the status flags saved by SaveFlags. RAX is left unchanged.
+   * Nothing is generated if the flags are dead before and after the
+   * instruction (see Patch::flagsDead).
+   *
+   * @param[in] temp   The temporary used by SaveFlags.
+   *                   Overwritten by this generator.
+   */
+  RestoreFlags(Temp temp) : temp(temp) {}
+
+  /*! Output:
+   *
+   * if the flags are live:
+   * XCHG REG64 RAX, REG64 temp
+   * ADD REG8 AL, IMM8 0x7f
+   * SAHF
+   * XCHG REG64 RAX, REG64 temp
+   */
+  std::vector<std::unique_ptr<RelocatableInst>>
+  generate(const Patch &patch, TempManager &temp_manager) const override;
+};
+
 } // namespace QBDI
 
 #endif
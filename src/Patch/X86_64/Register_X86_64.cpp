@@ -15,13 +15,20 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <bitset>
 #include <cstdint>
 #include <map>
 #include <stddef.h>
+#include <string.h>
 
 #include "X86InstrInfo.h"
+#include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCInstrDesc.h"
+#include "llvm/MC/MCInstrInfo.h"
 
+#include "Engine/LLVMCPU.h"
 #include "Patch/Register.h"
+#include "Patch/X86_64/InstInfo_X86_64.h"
 #include "Patch/Types.h"
 #include "Utility/LogSys.h"
 
@@ -626,9 +633,145 @@ void fixLLVMUsedGPR(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
     case llvm::X86::LOOPNE:
       arr[2] |= RegisterUsed | RegisterSet;
       break;
+    // the destination is compared with the accumulator before being written
+    case llvm::X86::CMPXCHG8rr:
+    case llvm::X86::CMPXCHG16rr:
+    case llvm::X86::CMPXCHG32rr:
+    case llvm::X86::CMPXCHG64rr: {
+      size_t id = getGPRPosition(inst.getOperand(0).getReg());
+      if (id < NUM_GPR) {
+        arr[id] |= RegisterUsed;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+bool isFullGPRWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu,
+                    RegLLVM reg) {
+  switch (inst.getOpcode()) {
+    // the destination is left unchanged when the source is zero
+    case llvm::X86::BSF16rm:
+    case llvm::X86::BSF16rr:
+    case llvm::X86::BSF32rm:
+    case llvm::X86::BSF32rr:
+    case llvm::X86::BSF64rm:
+    case llvm::X86::BSF64rr:
+    case llvm::X86::BSR16rm:
+    case llvm::X86::BSR16rr:
+    case llvm::X86::BSR32rm:
+    case llvm::X86::BSR32rr:
+    case llvm::X86::BSR64rm:
+    case llvm::X86::BSR64rr:
+    // the destination is only written if it's equal to the accumulator
+    case llvm::X86::CMPXCHG8rr:
+    case llvm::X86::CMPXCHG16rr:
+    case llvm::X86::CMPXCHG32rr:
+    case llvm::X86::CMPXCHG64rr:
+      return false;
     default:
       break;
   }
+  // a write of a 32 bits register clears the upper part of the 64 bits
+  // register. 8 and 16 bits writes keep the other bits of the register.
+  return getRegisterSize(reg) >= 4;
+}
+
+bool mayReadFlags(const llvm::MCInst &inst, const LLVMCPU &llvmcpu) {
+  const llvm::MCInstrDesc &desc = llvmcpu.getMCII().get(inst.getOpcode());
+
+  for (const unsigned implicitRegs : desc.implicit_uses()) {
+    if (implicitRegs == llvm::X86::EFLAGS) {
+      return true;
+    }
+  }
+  for (unsigned int i = 0; i < inst.getNumOperands(); i++) {
+    const llvm::MCOperand &op = inst.getOperand(i);
+    if (op.isReg() and op.getReg() == llvm::X86::EFLAGS) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Instructions that write all the status flags (OF, SF, ZF, AF, PF and CF).
+// LLVM declares EFLAGS as defined by any instruction that modifies a flag, the
+// list is matched on the opcode name to cover all the operand forms.
+static constexpr const char *FULL_FLAGS_WRITE[] = {
+    "ADC",    "ADD",   "AND",    "CMP",     "NEG",    "OR",     "SBB",
+    "SUB",    "TEST",  "XADD",   "XOR",     "POPCNT", "COMIS",  "UCOMIS",
+    "VCOMIS", "PTEST", "VPTEST", "VUCOMIS", "VTESTP",
+};
+
+// Opcodes matched by FULL_FLAGS_WRITE that keep or leave undefined some flags
+static constexpr const char *PARTIAL_FLAGS_WRITE[] = {
+    "ADCX",
+    "ANDN",
+    "CMPXCHG8B",
+    "CMPXCHG16B",
+};
+
+static bool matchPrefix(const char *name, const char *const prefixes[],
+                        size_t nb) {
+  for (size_t i = 0; i < nb; i++) {
+    if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+
+// The opcodes that write all the status flags. The names of the opcodes are
+// only matched once, when the table is built.
+struct FullFlagsWriteArray {
+  std::bitset<llvm::X86::INSTRUCTION_LIST_END> arr;
+
+  FullFlagsWriteArray(const llvm::MCInstrInfo &MCII) {
+    for (unsigned opcode = 0; opcode < llvm::X86::INSTRUCTION_LIST_END;
+         opcode++) {
+      const llvm::MCInstrDesc &desc = MCII.get(opcode);
+      bool defFlags = false;
+      for (const unsigned implicitRegs : desc.implicit_defs()) {
+        if (implicitRegs == llvm::X86::EFLAGS) {
+          defFlags = true;
+        }
+      }
+      if (not defFlags) {
+        continue;
+      }
+      const char *name = MCII.getName(opcode).data();
+      arr[opcode] =
+          matchPrefix(name, FULL_FLAGS_WRITE,
+                      sizeof(FULL_FLAGS_WRITE) / sizeof(const char *)) and
+          not matchPrefix(name, PARTIAL_FLAGS_WRITE,
+                          sizeof(PARTIAL_FLAGS_WRITE) / sizeof(const char *));
+    }
+  }
+
+  inline bool get(size_t op) const {
+    if (op < llvm::X86::INSTRUCTION_LIST_END) {
+      return arr[op];
+    }
+
+    QBDI_ERROR("No opcode {}", op);
+    return false;
+  }
+};
+
+} // anonymous namespace
+
+bool isFullFlagsWrite(const llvm::MCInst &inst, const LLVMCPU &llvmcpu) {
+  // a string instruction with a REP prefix and a null counter doesn't change
+  // the flags
+  if (hasREPPrefix(inst)) {
+    return false;
+  }
+  static const FullFlagsWriteArray fullFlagsWrite(llvmcpu.getMCII());
+  return fullFlagsWrite.get(inst.getOpcode());
 }
 
 } // namespace QBDI
@@ -154,7 +154,9 @@ int MovReg::getSize(const LLVMCPU &llvmcpu) const {
 
 llvm::MCInst LoadImm::reloc(ExecBlock *execBlock, CPUMode cpumode) const {
   if constexpr (is_x86_64) {
-    if (imm < -0x80000000ull or 0x80000000ull <= imm) {
+    if (imm <= 0xFFFFFFFFull) {
+      return movzx64ri32(reg, imm);
+    } else if (imm < -0x80000000ull) {
       return mov64ri(reg, imm);
     } else {
       return mov64ri32(reg, imm);
@@ -166,7 +168,9 @@ llvm::MCInst LoadImm::reloc(ExecBlock *execBlock, CPUMode cpumode) const {
 
 int LoadImm::getSize(const LLVMCPU &llvmcpu) const {
   if constexpr (is_x86_64) {
-    if (imm < -0x80000000ull or 0x80000000ull <= imm) {
+    if (imm <= 0xFFFFFFFFull) {
+      return movzx64ri32Size(reg);
+    } else if (imm < -0x80000000ull) {
       return 10;
     } else {
       return 7;
@@ -181,7 +185,7 @@ int LoadImm::getSize(const LLVMCPU &llvmcpu) const {
 
 llvm::MCInst InstId::reloc(ExecBlock *execBlock, CPUMode cpumode) const {
   if constexpr (is_x86_64) {
-    return mov64ri32(reg, execBlock->getNextInstID());
+    return movzx64ri32(reg, execBlock->getNextInstID());
   } else {
     return mov32ri(reg, execBlock->getNextInstID());
   }
@@ -189,7 +193,7 @@ llvm::MCInst InstId::reloc(ExecBlock *execBlock, CPUMode cpumode) const {
 
 int InstId::getSize(const LLVMCPU &llvmcpu) const {
   if constexpr (is_x86_64) {
-    return 7;
+    return movzx64ri32Size(reg);
   } else {
     return 5;
   }
@@ -206,6 +210,38 @@ llvm::MCInst EpilogueJump::reloc(ExecBlock *execBlock, CPUMode cpumode) const {
 
 int EpilogueJump::getSize(const LLVMCPU &llvmcpu) const { return 5; }
 
+// ColdStubJump
+// ============
+
+llvm::MCInst ColdStubJump::reloc(ExecBlock *execBlock, CPUMode cpumode) const {
+  return jmp(execBlock->getColdStubOffset() - 1);
+}
+
+int ColdStubJump::getSize(const LLVMCPU &llvmcpu) const { return 5; }
+
+// SetRegtoColdReturn
+// ==================
+
+llvm::MCInst SetRegtoColdReturn::reloc(ExecBlock *execBlock,
+                                       CPUMode cpumode) const {
+  // the ColdStubJump is 5 bytes long
+  rword address = execBlock->getColdJumpPC() + 5;
+  if constexpr (is_x86_64)
+    // the cold stub is in the same code block: use a RIP relative lea
+    return lea64(reg, Reg(REG_PC), 1, 0,
+                 address - execBlock->getCurrentPC() - 7, 0);
+  else
+    return mov32ri(reg, address);
+}
+
+int SetRegtoColdReturn::getSize(const LLVMCPU &llvmcpu) const {
+  if constexpr (is_x86_64) {
+    return 7;
+  } else {
+    return 5;
+  }
+}
+
 // SetRegtoPCRel
 // =============
 
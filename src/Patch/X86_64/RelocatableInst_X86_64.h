@@ -58,6 +58,31 @@ public:
   int getSize(const LLVMCPU &llvmcpu) const override;
 };
 
+class ColdStubJump : public AutoClone<RelocatableInst, ColdStubJump> {
+
+public:
+  ColdStubJump() : AutoClone<RelocatableInst, ColdStubJump>() {}
+
+  // Jump to the last cold stub written
+  llvm::MCInst reloc(ExecBlock *execBlock, CPUMode cpumode) const override;
+
+  int getSize(const LLVMCPU &llvmcpu) const override;
+};
+
+class SetRegtoColdReturn
+    : public AutoClone<RelocatableInst, SetRegtoColdReturn> {
+  Reg reg;
+
+public:
+  SetRegtoColdReturn(Reg reg)
+      : AutoClone<RelocatableInst, SetRegtoColdReturn>(), reg(reg) {}
+
+  // set reg to the address following the ColdStubJump of the current stub
+  llvm::MCInst reloc(ExecBlock *execBlock, CPUMode cpumode) const override;
+
+  int getSize(const LLVMCPU &llvmcpu) const override;
+};
+
 class SetRegtoPCRel : public AutoClone<RelocatableInst, SetRegtoPCRel> {
   Reg reg;
   rword offset;
@@ -25,6 +25,9 @@ namespace QBDI {
 
 static const std::set<Reg> TempManagerUnrestoreGPR = {};
 
+// GPR that the prologue doesn't restore from the Context
+static const std::set<Reg> TempManagerUnsyncGPR = {};
+
 }
 
 #endif
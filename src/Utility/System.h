@@ -19,12 +19,15 @@
 #define SYSTEM_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string>
 #include <system_error>
 #include <vector>
 
 #include "llvm/Support/Memory.h"
 
+#include "QBDI/Config.h"
+
 namespace QBDI {
 bool isRWXSupported();
 llvm::sys::MemoryBlock
@@ -35,6 +38,14 @@ void releaseMappedMemory(llvm::sys::MemoryBlock &block);
 const std::string getHostCPUName();
 const std::vector<std::string> getHostCPUFeatures();
 bool isHostCPUFeaturePresent(const char *f);
+#if defined(QBDI_ARCH_X86_64)
+// The CPU supports (RD|WR)(FS|GS)BASE and the OS allows them in userland
+bool isFSGSBaseEnabled();
+// Offset and size of an XSAVE state component in the standard (non compacted)
+// format, as reported by CPUID.(EAX=0DH,ECX=component)
+bool getXStateComponentLayout(unsigned component, uint32_t &offset,
+                              uint32_t &size);
+#endif
 } // namespace QBDI
 
 #endif // SYSTEM_H
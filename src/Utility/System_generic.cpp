@@ -32,6 +32,23 @@
 #include "Utility/LogSys.h"
 #include "Utility/System.h"
 
+#if defined(QBDI_ARCH_X86_64) && \
+    (defined(QBDI_PLATFORM_LINUX) || defined(QBDI_PLATFORM_ANDROID))
+#include <sys/auxv.h>
+
+#ifndef HWCAP2_FSGSBASE
+#define HWCAP2_FSGSBASE (1 << 1)
+#endif
+#endif
+
+#if defined(QBDI_ARCH_X86_64)
+#if defined(QBDI_PLATFORM_WINDOWS)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 namespace QBDI {
 
 bool isRWXSupported() { return false; }
@@ -178,4 +195,54 @@ bool isHostCPUFeaturePresent(const char *query) {
   return false;
 }
 
+#if defined(QBDI_ARCH_X86_64)
+bool isFSGSBaseEnabled() {
+  static const bool enabled = []() -> bool {
+    if (not isHostCPUFeaturePresent("fsgsbase")) {
+      return false;
+    }
+#if defined(QBDI_PLATFORM_LINUX) || defined(QBDI_PLATFORM_ANDROID)
+    // the kernel must set CR4.FSGSBASE (linux >= 5.9), else the instructions
+    // raise a SIGILL
+    if ((getauxval(AT_HWCAP2) & HWCAP2_FSGSBASE) == 0) {
+      QBDI_DEBUG("FSGSBASE instructions not enabled by the kernel");
+      return false;
+    }
+#endif
+    return true;
+  }();
+  return enabled;
+}
+
+bool getXStateComponentLayout(unsigned component, uint32_t &offset,
+                              uint32_t &size) {
+  uint32_t eax, ebx;
+#if defined(QBDI_PLATFORM_WINDOWS)
+  int regs[4];
+  __cpuid(regs, 0);
+  if (static_cast<uint32_t>(regs[0]) < 0xD) {
+    return false;
+  }
+  __cpuidex(regs, 0xD, component);
+  eax = static_cast<uint32_t>(regs[0]);
+  ebx = static_cast<uint32_t>(regs[1]);
+#else
+  uint32_t ecx, edx;
+  if (__get_cpuid_max(0, nullptr) < 0xD) {
+    return false;
+  }
+  __cpuid_count(0xD, component, eax, ebx, ecx, edx);
+  (void)ecx;
+  (void)edx;
+#endif
+  // a component not supported by the CPU has a null size
+  if (eax == 0) {
+    return false;
+  }
+  size = eax;
+  offset = ebx;
+  return true;
+}
+#endif
+
 } // namespace QBDI
@@ -387,6 +387,30 @@ QBDI::VMAction checkUnrolledWriteBB(QBDI::VMInstanceRef vm,
   return QBDI::VMAction::CONTINUE;
 }
 
+struct MergeInfo {
+  TestInfo info;
+  size_t count;
+};
+
+QBDI::VMAction countReadBB(QBDI::VMInstanceRef vm, const QBDI::VMState *vmState,
+                           QBDI::GPRState *gprState, QBDI::FPRState *fprState,
+                           void *data) {
+
+  MergeInfo *merge = (MergeInfo *)data;
+  std::vector<QBDI::MemoryAccess> memaccesses = vm->getBBMemoryAccess();
+  QBDI::Range<QBDI::rword> brange((QBDI::rword)merge->info.buffer,
+                                  ((QBDI::rword)merge->info.buffer) +
+                                      merge->info.buffer_size);
+  for (const QBDI::MemoryAccess &memaccess : memaccesses) {
+    if (memaccess.type == QBDI::MEMORY_READ and
+        brange.contains(memaccess.accessAddress)) {
+      merge->info.i += memaccess.size;
+      merge->count += 1;
+    }
+  }
+  return QBDI::VMAction::CONTINUE;
+}
+
 QBDI::VMAction readSnooper(QBDI::VMInstanceRef vm, QBDI::GPRState *gprState,
                            QBDI::FPRState *fprState, void *data) {
 
@@ -587,6 +611,36 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest-BasicBlockWrite") {
   REQUIRE(infoInst.i == infoBB.i);
 }
 
+TEST_CASE_METHOD(APITest, "MemoryAccessTest-BasicBlockMerge") {
+  char buffer[] = "p0p30fd0p3";
+  size_t buffer_size = sizeof(buffer) / sizeof(char);
+  MergeInfo infoBB = {{(void *)buffer, sizeof(buffer), 0}, 0};
+  MergeInfo infoMerge = {{(void *)buffer, sizeof(buffer), 0}, 0};
+
+  vm.recordMemoryAccess(QBDI::MEMORY_READ);
+  uint32_t id =
+      vm.addVMEventCB(QBDI::VMEvent::SEQUENCE_EXIT, countReadBB, &infoBB);
+
+  QBDI::simulateCall(state, FAKE_RET_ADDR, {(QBDI::rword)buffer});
+  bool ran = vm.run((QBDI::rword)unrolledRead, (QBDI::rword)FAKE_RET_ADDR);
+  REQUIRE(true == ran);
+  REQUIRE(infoBB.info.i == buffer_size);
+
+  vm.deleteInstrumentation(id);
+  vm.setOptions(vm.getOptions() | QBDI::Options::OPT_MERGE_MEMORY_ACCESS);
+  vm.addVMEventCB(QBDI::VMEvent::SEQUENCE_EXIT, countReadBB, &infoMerge);
+
+  QBDI::simulateCall(state, FAKE_RET_ADDR, {(QBDI::rword)buffer});
+  ran = vm.run((QBDI::rword)unrolledRead, (QBDI::rword)FAKE_RET_ADDR);
+  REQUIRE(true == ran);
+  QBDI::rword ret = QBDI_GPR_GET(state, QBDI::REG_RETURN);
+  REQUIRE(ret == (QBDI::rword)unrolledRead(buffer));
+  // the same bytes are reported with less accesses
+  REQUIRE(infoMerge.info.i == buffer_size);
+  REQUIRE(infoBB.count == buffer_size);
+  REQUIRE(infoMerge.count < infoBB.count);
+}
+
 TEST_CASE_METHOD(APITest, "MemoryAccessTest-ReadRange") {
   uint32_t buffer[] = {3531902336, 1974345459, 1037124602, 2572792182,
                        3451121073, 4105092976, 2050515100, 2786945221,
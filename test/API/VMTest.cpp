@@ -207,6 +207,153 @@ TEST_CASE_METHOD(APITest, "VMTest-Breakpoint") {
   SUCCEED();
 }
 
+TEST_CASE_METHOD(APITest, "VMTest-BreakpointSet") {
+  uint32_t counter0 = 0;
+  uint32_t counter1 = 0;
+  QBDI::rword retval = 0;
+  uint32_t id = vm.addCodeAddrCBSet(
+      {(QBDI::rword)dummyFun0, (QBDI::rword)dummyFun1},
+      QBDI::InstPosition::PREINST, countInstruction, &counter0);
+  REQUIRE(id != QBDI::VMError::INVALID_EVENTID);
+
+  vm.call(&retval, (QBDI::rword)dummyFun0);
+  REQUIRE(retval == (QBDI::rword)42);
+  vm.call(&retval, (QBDI::rword)dummyFun1, {5});
+  REQUIRE(retval == (QBDI::rword)5);
+  REQUIRE(counter0 == 2u);
+
+  // replace the callback of an address and remove the other one
+  REQUIRE(vm.addCodeAddrCBSetEntry(id, (QBDI::rword)dummyFun0,
+                                   countInstruction, &counter1));
+  REQUIRE(vm.removeCodeAddrCBSetEntry(id, (QBDI::rword)dummyFun1));
+  REQUIRE_FALSE(vm.removeCodeAddrCBSetEntry(id, (QBDI::rword)dummyFun1));
+  vm.call(&retval, (QBDI::rword)dummyFun0);
+  vm.call(&retval, (QBDI::rword)dummyFun1, {5});
+  REQUIRE(counter0 == 2u);
+  REQUIRE(counter1 == 1u);
+
+  REQUIRE(vm.deleteInstrumentation(id));
+  REQUIRE_FALSE(vm.addCodeAddrCBSetEntry(id, (QBDI::rword)dummyFun0,
+                                         countInstruction, &counter1));
+  vm.call(&retval, (QBDI::rword)dummyFun0);
+  REQUIRE(counter1 == 1u);
+
+  SUCCEED();
+}
+
+TEST_CASE_METHOD(APITest, "VMTest-InstructionBudget") {
+  uint32_t exhausted = 0;
+  QBDI::rword retval = 0;
+  vm.addVMEventCB(QBDI::BUDGET_EXHAUSTED,
+                  [&exhausted](QBDI::VMInstanceRef, const QBDI::VMState *,
+                               QBDI::GPRState *, QBDI::FPRState *) {
+                    exhausted++;
+                    return QBDI::VMAction::CONTINUE;
+                  });
+
+  // without budget
+  REQUIRE(vm.call(&retval, (QBDI::rword)dummyFun0));
+  REQUIRE(retval == (QBDI::rword)42);
+  REQUIRE(exhausted == 0u);
+  REQUIRE_FALSE(vm.isInstructionBudgetEnabled());
+  REQUIRE(vm.getInstructionBudget() == 0u);
+
+  // large enough budget
+  vm.setInstructionBudget(100000);
+  REQUIRE(vm.call(&retval, (QBDI::rword)dummyFun0));
+  REQUIRE(retval == (QBDI::rword)42);
+  REQUIRE(exhausted == 0u);
+  REQUIRE(vm.getInstructionBudget() < 100000u);
+  REQUIRE(vm.getInstructionBudget() > 0u);
+
+  // the first sequence doesn't fit in the budget
+  vm.setInstructionBudget(1);
+  QBDI::simulateCall(state, FAKE_RET_ADDR);
+  vm.run((QBDI::rword)dummyFun0, (QBDI::rword)FAKE_RET_ADDR);
+  REQUIRE(exhausted == 1u);
+  REQUIRE(vm.getInstructionBudget() == 1u);
+
+  // a used up budget stays enabled
+  vm.setInstructionBudget(0);
+  REQUIRE(vm.isInstructionBudgetEnabled());
+  vm.setInstructionBudget(vm.getInstructionBudget());
+  QBDI::simulateCall(state, FAKE_RET_ADDR);
+  vm.run((QBDI::rword)dummyFun0, (QBDI::rword)FAKE_RET_ADDR);
+  REQUIRE(exhausted == 2u);
+  REQUIRE(vm.isInstructionBudgetEnabled());
+  REQUIRE(vm.getInstructionBudget() == 0u);
+
+  // the callback increases the budget
+  vm.deleteAllInstrumentations();
+  vm.addVMEventCB(QBDI::BUDGET_EXHAUSTED,
+                  [&exhausted](QBDI::VMInstanceRef vmInstance,
+                               const QBDI::VMState *, QBDI::GPRState *,
+                               QBDI::FPRState *) {
+                    exhausted++;
+                    vmInstance->setInstructionBudget(100000);
+                    return QBDI::VMAction::CONTINUE;
+                  });
+  REQUIRE(vm.call(&retval, (QBDI::rword)dummyFun0));
+  REQUIRE(retval == (QBDI::rword)42);
+  REQUIRE(exhausted == 3u);
+
+  // the execution stops when the callback doesn't increase the budget, even
+  // if it doesn't return CONTINUE
+  vm.deleteAllInstrumentations();
+  vm.addVMEventCB(QBDI::BUDGET_EXHAUSTED,
+                  [&exhausted](QBDI::VMInstanceRef, const QBDI::VMState *,
+                               QBDI::GPRState *, QBDI::FPRState *) {
+                    exhausted++;
+                    return QBDI::VMAction::BREAK_TO_VM;
+                  });
+  vm.setInstructionBudget(1);
+  QBDI::simulateCall(state, FAKE_RET_ADDR);
+  vm.run((QBDI::rword)dummyFun0, (QBDI::rword)FAKE_RET_ADDR);
+  REQUIRE(exhausted == 4u);
+  REQUIRE(vm.getInstructionBudget() == 1u);
+
+  vm.removeInstructionBudget();
+  REQUIRE_FALSE(vm.isInstructionBudgetEnabled());
+  REQUIRE(vm.getInstructionBudget() == 0u);
+  REQUIRE(vm.call(&retval, (QBDI::rword)dummyFun0));
+  REQUIRE(exhausted == 4u);
+
+  SUCCEED();
+}
+
+/* The stop address of a run must not invalidate the cache */
+TEST_CASE_METHOD(APITest, "VMTest-StopAddressCache") {
+  uint32_t newBB = 0;
+  QBDI::rword retval = 0;
+  vm.addVMEventCB(QBDI::BASIC_BLOCK_NEW,
+                  [&newBB](QBDI::VMInstanceRef, const QBDI::VMState *,
+                           QBDI::GPRState *, QBDI::FPRState *) {
+                    newBB++;
+                    return QBDI::VMAction::CONTINUE;
+                  });
+
+  vm.call(&retval, (QBDI::rword)dummyFun0);
+  REQUIRE(retval == (QBDI::rword)42);
+  REQUIRE(newBB != 0u);
+  newBB = 0;
+  for (int i = 0; i < 4; i++) {
+    vm.call(&retval, (QBDI::rword)dummyFun0);
+    REQUIRE(retval == (QBDI::rword)42);
+  }
+  REQUIRE(newBB == 0u);
+
+  // stop address inside the instrumented range
+  for (int i = 0; i < 4; i++) {
+    QBDI::simulateCall(state, FAKE_RET_ADDR, {i});
+    REQUIRE(vm.run((QBDI::rword)dummyFunCall, (QBDI::rword)dummyFun1));
+    vm.run((QBDI::rword)dummyFun1, (QBDI::rword)FAKE_RET_ADDR);
+    REQUIRE(QBDI_GPR_GET(state, QBDI::REG_RETURN) ==
+            (QBDI::rword)dummyFunCall(i));
+  }
+
+  SUCCEED();
+}
+
 TEST_CASE_METHOD(APITest, "VMTest-InstCallback") {
   QBDI::rword info[2] = {42, 0};
   QBDI::simulateCall(state, FAKE_RET_ADDR, {info[0]});
@@ -1803,3 +1950,35 @@ TEST_CASE_METHOD(APITest, "VMTest-SelfModifyingCode2") {
 
   SUCCEED();
 }
+
+TEST_CASE_METHOD(APITest, "VMTest-CacheGeneration") {
+  QBDI::VM vm2;
+  REQUIRE(vm.getCacheGeneration() != vm2.getCacheGeneration());
+
+  vm.precacheBasicBlock((QBDI::rword)dummyFun0);
+  const QBDI::InstAnalysis *analysis =
+      vm.getCachedInstAnalysis((QBDI::rword)dummyFun0);
+  REQUIRE(analysis != nullptr);
+
+  // the analyses stay in the cache
+  uint64_t generation = vm.getCacheGeneration();
+  QBDI::rword retval;
+  vm.call(&retval, (QBDI::rword)dummyFun0);
+  REQUIRE(retval == (QBDI::rword)42);
+  REQUIRE(vm.getCacheGeneration() == generation);
+  REQUIRE(vm.getCachedInstAnalysis((QBDI::rword)dummyFun0) == analysis);
+
+  // a flush of the cache changes the generation
+  vm.clearAllCache();
+  REQUIRE(vm.getCacheGeneration() != generation);
+  REQUIRE(vm.getCacheGeneration() != vm2.getCacheGeneration());
+  REQUIRE(vm.getCachedInstAnalysis((QBDI::rword)dummyFun0) == nullptr);
+
+  generation = vm.getCacheGeneration();
+  vm.precacheBasicBlock((QBDI::rword)dummyFun0);
+  REQUIRE(vm.getCacheGeneration() == generation);
+  vm.clearCache((QBDI::rword)dummyFun0, (QBDI::rword)dummyFun0 + 1);
+  REQUIRE(vm.getCacheGeneration() != generation);
+
+  SUCCEED();
+}
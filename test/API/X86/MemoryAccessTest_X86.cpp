@@ -757,8 +757,10 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86-rep_movsl") {
   uint32_t v1[5] = {0xab673, 0xeba9256, 0x638feba8, 0x7182faB, 0x7839021b};
   uint32_t v2[5] = {0};
   ExpectedMemoryAccesses expectedPre = {{
-      {(QBDI::rword)&v1, 0, 0, QBDI::MEMORY_READ,
-       QBDI::MEMORY_UNKNOWN_VALUE | QBDI::MEMORY_UNKNOWN_SIZE},
+      {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+      {(QBDI::rword)&v2, 0, sizeof(v1), QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_UNKNOWN_VALUE},
   }};
   ExpectedMemoryAccesses expectedPost = {{
       {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
@@ -799,8 +801,10 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86-rep_movsl2") {
   uint32_t v1[5] = {0xab673, 0xeba9256, 0x638feba8, 0x7182faB, 0x7839021b};
   uint32_t v2[5] = {0};
   ExpectedMemoryAccesses expectedPre = {{
-      {(QBDI::rword)&v1[4], 0, 0, QBDI::MEMORY_READ,
-       QBDI::MEMORY_UNKNOWN_VALUE | QBDI::MEMORY_UNKNOWN_SIZE},
+      {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+      {(QBDI::rword)&v2, 0, sizeof(v1), QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_UNKNOWN_VALUE},
   }};
   ExpectedMemoryAccesses expectedPost = {{
       {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
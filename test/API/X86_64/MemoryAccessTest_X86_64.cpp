@@ -23,9 +23,15 @@
 #include "QBDI/Memory.hpp"
 #include "QBDI/Platform.h"
 #include "QBDI/Range.h"
+#include "QBDI/VM_C.h"
 
 #include "Utility/System.h"
 
+#ifndef QBDI_PLATFORM_WINDOWS
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 static bool checkFeature(const char *f) {
   if (!QBDI::isHostCPUFeaturePresent(f)) {
     WARN("Host doesn't support " << f << " feature: SKIP");
@@ -88,6 +94,25 @@ static QBDI::VMAction checkAccess(QBDI::VMInstanceRef vm,
   return QBDI::VMAction::CONTINUE;
 }
 
+struct BBMemoryAccesses {
+  QBDI::Range<QBDI::rword> range;
+  std::vector<QBDI::MemoryAccess> accesses;
+};
+
+static QBDI::VMAction getBBAccesses(QBDI::VMInstanceRef vm,
+                                    const QBDI::VMState *vmState,
+                                    QBDI::GPRState *gprState,
+                                    QBDI::FPRState *fprState, void *data) {
+
+  BBMemoryAccesses *info = static_cast<BBMemoryAccesses *>(data);
+  for (const QBDI::MemoryAccess &memaccess : vm->getBBMemoryAccess()) {
+    if (info->range.contains(memaccess.accessAddress)) {
+      info->accesses.push_back(memaccess);
+    }
+  }
+  return QBDI::VMAction::CONTINUE;
+}
+
 // test stack memory access
 // PUSH POP CALL RET
 
@@ -786,8 +811,10 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-rep_movsl") {
   uint32_t v1[5] = {0xab673, 0xeba9256, 0x638feba8, 0x7182faB, 0x7839021b};
   uint32_t v2[5] = {0};
   ExpectedMemoryAccesses expectedPre = {{
-      {(QBDI::rword)&v1, 0, 0, QBDI::MEMORY_READ,
-       QBDI::MEMORY_UNKNOWN_VALUE | QBDI::MEMORY_UNKNOWN_SIZE},
+      {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+      {(QBDI::rword)&v2, 0, sizeof(v1), QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_UNKNOWN_VALUE},
   }};
   ExpectedMemoryAccesses expectedPost = {{
       {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
@@ -828,8 +855,10 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-rep_movsl2") {
   uint32_t v1[5] = {0xab673, 0xeba9256, 0x638feba8, 0x7182faB, 0x7839021b};
   uint32_t v2[5] = {0};
   ExpectedMemoryAccesses expectedPre = {{
-      {(QBDI::rword)&v1[4], 0, 0, QBDI::MEMORY_READ,
-       QBDI::MEMORY_UNKNOWN_VALUE | QBDI::MEMORY_UNKNOWN_SIZE},
+      {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+      {(QBDI::rword)&v2, 0, sizeof(v1), QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_UNKNOWN_VALUE},
   }};
   ExpectedMemoryAccesses expectedPost = {{
       {(QBDI::rword)&v1, 0, sizeof(v1), QBDI::MEMORY_READ,
@@ -1304,6 +1333,107 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-stosq2") {
     CHECK(e.see);
 }
 
+TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-rep_stosq") {
+
+  const char source[] =
+      "std\n"
+      "rep stosq\n"
+      "cld\n";
+
+  QBDI::rword v1 = 0x6efab792eb;
+  QBDI::rword v2[6] = {0};
+  ExpectedMemoryAccesses expectedPre = {{
+      {(QBDI::rword)&v2[1], 0, 5 * sizeof(QBDI::rword), QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+  }};
+  ExpectedMemoryAccesses expectedPost = {{
+      {(QBDI::rword)&v2[1], 0, 5 * sizeof(QBDI::rword), QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+  }};
+
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+  vm.addMnemonicCB("STOSQ", QBDI::PREINST, checkAccess, &expectedPre);
+  vm.addMnemonicCB("STOSQ", QBDI::POSTINST, checkAccess, &expectedPost);
+
+  QBDI::GPRState *state = vm.getGPRState();
+  state->rax = v1;
+  state->rdi = (QBDI::rword)&v2[5];
+  state->rcx = 5;
+  vm.setGPRState(state);
+
+  QBDI::rword retval;
+  bool ran = runOnASM(&retval, source);
+
+  CHECK(ran);
+  CHECK(v2[0] == 0);
+  for (size_t i = 1; i < 6; i++)
+    CHECK(v2[i] == v1);
+  for (auto &e : expectedPre.accesses)
+    CHECK(e.see);
+  for (auto &e : expectedPost.accesses)
+    CHECK(e.see);
+}
+
+static QBDI::VMAction getAccessClearCounter(QBDI::VMInstanceRef vm,
+                                            QBDI::GPRState *gprState,
+                                            QBDI::FPRState *fprState,
+                                            void *data) {
+  *static_cast<std::vector<QBDI::MemoryAccess> *>(data) =
+      vm->getInstMemoryAccess();
+  // don't execute the instruction with the counter of the test
+  gprState->rcx = 0;
+  return QBDI::VMAction::CONTINUE;
+}
+
+TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-rep_stosq-count") {
+
+  const char source[] =
+      "cld\n"
+      "rep stosq\n";
+
+  QBDI::rword v1[2] = {0};
+  std::vector<QBDI::MemoryAccess> accesses;
+
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+  vm.addMnemonicCB("STOSQ", QBDI::PREINST, getAccessClearCounter, &accesses);
+
+  // the size of the range overflows or is too large to be reported before
+  // the instruction
+  for (QBDI::rword count : {((QBDI::rword)1) << 61, ((QBDI::rword)1) << 20}) {
+    QBDI::GPRState *state = vm.getGPRState();
+    state->rdi = (QBDI::rword)&v1;
+    state->rcx = count;
+    vm.setGPRState(state);
+
+    accesses.clear();
+    QBDI::rword retval;
+    bool ran = runOnASM(&retval, source);
+
+    CHECK(ran);
+    CHECKED_IF(accesses.size() == 1) {
+      CHECK(accesses[0].accessAddress == (QBDI::rword)&v1);
+      CHECK(accesses[0].size == 0);
+      CHECK(accesses[0].type == QBDI::MEMORY_WRITE);
+      CHECK(accesses[0].flags ==
+            (QBDI::MEMORY_UNKNOWN_SIZE | QBDI::MEMORY_UNKNOWN_VALUE));
+    }
+  }
+
+  // no access with a null counter
+  QBDI::GPRState *state = vm.getGPRState();
+  state->rdi = (QBDI::rword)&v1;
+  state->rcx = 0;
+  vm.setGPRState(state);
+
+  accesses.clear();
+  QBDI::rword retval;
+  bool ran = runOnASM(&retval, source);
+
+  CHECK(ran);
+  CHECK(accesses.size() == 0);
+  CHECK(v1[0] == 0);
+}
+
 TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-movzx") {
 
   const char source[] = "movzbq  0x5(%rbx), %rax\n";
@@ -1558,6 +1688,99 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-movapd") {
     CHECK(e.see);
 }
 
+TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-movapd-flags") {
+
+  if (!checkFeature("sse2")) {
+    return;
+  }
+
+  // the flags of the cmp must survive the instrumentation of the movapd
+  const char source[] =
+      "xor %eax, %eax\n"
+      "cmp %rdx, %rsi\n"
+      "movapd (%rcx), %xmm1\n"
+      "movapd %xmm2, (%rbx)\n"
+      "sete %al\n"
+      "setb %ah\n";
+
+  QBDI_ALIGNED(16) uint8_t buff1[16] = {0};
+  QBDI_ALIGNED(16) uint8_t buff2[16] = {0};
+
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+
+  QBDI::GPRState *state = vm.getGPRState();
+  state->rcx = (QBDI::rword)&buff1;
+  state->rbx = (QBDI::rword)&buff2;
+  state->rdx = 7;
+  state->rsi = 5;
+  vm.setGPRState(state);
+
+  QBDI::rword retval;
+  bool ran = runOnASM(&retval, source);
+
+  CHECK(ran);
+  CHECK(retval == 0x100);
+}
+
+TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-movapd-large-value") {
+
+  if (!checkFeature("sse2")) {
+    return;
+  }
+
+  const char source[] =
+      "movapd	(%rax), %xmm1\n"
+      "movapd %xmm2, (%rbx)\n";
+
+  const uint8_t v1[16] = {0x41, 0x6a, 0xc4, 0x1e, 0x14, 0xa9, 0x5d, 0x27,
+                          0x67, 0x4f, 0x91, 0x6e, 0x4b, 0x57, 0x4d, 0xc9};
+  const uint8_t v2[16] = {0xa9, 0x5d, 0x27, 0x6a, 0xc4, 0x91, 0x6e, 0x4b,
+                          0x57, 0x4d, 0x41, 0x6a, 0x0e, 0x80, 0xeb, 0xad};
+  QBDI_ALIGNED(16) uint8_t buff1[16];
+  QBDI_ALIGNED(16) uint8_t buff2[16] = {0};
+
+  memcpy(buff1, v1, sizeof(v1));
+
+  ExpectedMemoryAccesses expectedLoad = {{
+      {(QBDI::rword)&buff1, 0x275da9141ec46a41, 8, QBDI::MEMORY_READ,
+       QBDI::MEMORY_NO_FLAGS},
+      {((QBDI::rword)&buff1) + 8, 0xc94d574b6e914f67, 8, QBDI::MEMORY_READ,
+       QBDI::MEMORY_NO_FLAGS},
+  }};
+  ExpectedMemoryAccesses expectedStore = {{
+      {(QBDI::rword)&buff2, 0x4b6e91c46a275da9, 8, QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_NO_FLAGS},
+      {((QBDI::rword)&buff2) + 8, 0xadeb800e6a414d57, 8, QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_NO_FLAGS},
+  }};
+
+  vm.setOptions(vm.getOptions() | QBDI::OPT_RECORD_LARGE_MEMORY_VALUE);
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+  vm.addMnemonicCB("MOVAPDrm", QBDI::PREINST, checkAccess, &expectedLoad);
+  vm.addMnemonicCB("MOVAPDmr", QBDI::POSTINST, checkAccess, &expectedStore);
+
+  QBDI::GPRState *state = vm.getGPRState();
+  state->rax = (QBDI::rword)&buff1;
+  state->rbx = (QBDI::rword)&buff2;
+  vm.setGPRState(state);
+
+  QBDI::FPRState *fstate = vm.getFPRState();
+  memset(fstate->xmm1, '\x00', sizeof(v1));
+  memcpy(fstate->xmm2, v2, sizeof(v2));
+  vm.setFPRState(fstate);
+
+  QBDI::rword retval;
+  bool ran = runOnASM(&retval, source);
+
+  CHECK(ran);
+  CHECK(memcmp(fstate->xmm2, buff2, sizeof(v2)) == 0);
+  CHECK(memcmp(fstate->xmm1, v1, sizeof(v1)) == 0);
+  for (auto &e : expectedLoad.accesses)
+    CHECK(e.see);
+  for (auto &e : expectedStore.accesses)
+    CHECK(e.see);
+}
+
 TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-maskmovdqu") {
 
   if (!checkFeature("avx")) {
@@ -1669,6 +1892,74 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-maskmovq") {
     CHECK(e.see);
 }
 
+#ifndef QBDI_PLATFORM_WINDOWS
+TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-vmaskmovps-page-end") {
+
+  if (!checkFeature("avx")) {
+    return;
+  }
+
+  // The two last lanes of the accesses are masked and after the end of the
+  // page: the value of the accesses mustn't be read.
+  const char source[] =
+      "vmaskmovps (%rax), %xmm1, %xmm2\n"
+      "vmaskmovps %xmm3, %xmm1, (%rax)\n";
+
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  uint8_t *pages = static_cast<uint8_t *>(mmap(nullptr, 2 * pageSize,
+                                               PROT_READ | PROT_WRITE,
+                                               MAP_PRIVATE | MAP_ANON, -1, 0));
+  REQUIRE(pages != MAP_FAILED);
+  REQUIRE(mprotect(pages + pageSize, pageSize, PROT_NONE) == 0);
+  uint8_t *buff = pages + pageSize - 8;
+
+  const uint8_t v1[8] = {0x41, 0x6a, 0xc4, 0x1e, 0x14, 0xa9, 0x5d, 0x27};
+  const uint8_t v2[16] = {0xa9, 0x5d, 0x27, 0x6a, 0xc4, 0x91, 0x6e, 0x4b,
+                          0x57, 0x4d, 0x41, 0x6a, 0x0e, 0x80, 0xeb, 0xad};
+  const uint8_t mask[16] = {0, 0, 0, 0x80, 0, 0, 0, 0x80,
+                            0, 0, 0, 0,    0, 0, 0, 0};
+  memcpy(buff, v1, sizeof(v1));
+
+  ExpectedMemoryAccesses expectedLoad = {{
+      {(QBDI::rword)buff, 0, 16, QBDI::MEMORY_READ,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+  }};
+  ExpectedMemoryAccesses expectedStore = {{
+      {(QBDI::rword)buff, 0, 16, QBDI::MEMORY_WRITE,
+       QBDI::MEMORY_UNKNOWN_VALUE},
+  }};
+
+  vm.setOptions(vm.getOptions() | QBDI::OPT_RECORD_LARGE_MEMORY_VALUE);
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+  vm.addMnemonicCB("VMASKMOVPSrm", QBDI::PREINST, checkAccess, &expectedLoad);
+  vm.addMnemonicCB("VMASKMOVPSmr", QBDI::POSTINST, checkAccess,
+                   &expectedStore);
+
+  QBDI::GPRState *state = vm.getGPRState();
+  state->rax = (QBDI::rword)buff;
+  vm.setGPRState(state);
+
+  QBDI::FPRState *fstate = vm.getFPRState();
+  memcpy(fstate->xmm1, mask, sizeof(mask));
+  memset(fstate->xmm2, '\xff', sizeof(fstate->xmm2));
+  memcpy(fstate->xmm3, v2, sizeof(v2));
+  vm.setFPRState(fstate);
+
+  QBDI::rword retval;
+  bool ran = runOnASM(&retval, source);
+
+  CHECK(ran);
+  CHECK(memcmp(fstate->xmm2, v1, sizeof(v1)) == 0);
+  CHECK(memcmp(buff, v2, 8) == 0);
+  for (auto &e : expectedLoad.accesses)
+    CHECK(e.see);
+  for (auto &e : expectedStore.accesses)
+    CHECK(e.see);
+
+  munmap(pages, 2 * pageSize);
+}
+#endif
+
 TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-xlat") {
 
   const char source[] = "xlatb\n";
@@ -1781,3 +2072,167 @@ TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-xsave") {
   for (auto &e : expectedPost.accesses)
     CHECK(e.see);
 }
+
+TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-BasicBlockMerge") {
+
+  // the write doesn't break the contiguous reads
+  const char source[] =
+      "mov (%rbx), %rax\n"
+      "mov 8(%rbx), %rcx\n"
+      "mov %rax, 32(%rbx)\n"
+      "mov 16(%rbx), %rdx\n"
+      "mov 40(%rbx), %rsi\n"
+      "mov 32(%rbx), %rdi\n";
+
+  QBDI::rword buff[8] = {0};
+  const QBDI::rword base = (QBDI::rword)&buff;
+  BBMemoryAccesses info = {{base, base + sizeof(buff)}, {}};
+
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+  vm.addVMEventCB(QBDI::VMEvent::SEQUENCE_EXIT, getBBAccesses, &info);
+
+  QBDI::GPRState *state = vm.getGPRState();
+  state->rbx = base;
+  vm.setGPRState(state);
+
+  QBDI::rword retval;
+  bool ran = runOnASM(&retval, source);
+  CHECK(ran);
+  REQUIRE(info.accesses.size() == 6u);
+  const QBDI::rword unmergedOffset[] = {0, 8, 32, 16, 40, 32};
+  for (size_t i = 0; i < 6; i++) {
+    CHECK(info.accesses[i].accessAddress == base + unmergedOffset[i]);
+    CHECK(info.accesses[i].size == 8);
+    CHECK(info.accesses[i].type ==
+          ((i == 2) ? QBDI::MEMORY_WRITE : QBDI::MEMORY_READ));
+  }
+
+  info.accesses.clear();
+  vm.setOptions(vm.getOptions() | QBDI::Options::OPT_MERGE_MEMORY_ACCESS);
+  state->rbx = base;
+  vm.setGPRState(state);
+
+  ran = runOnASM(&retval, source);
+  CHECK(ran);
+  REQUIRE(info.accesses.size() == 3u);
+  CHECK(info.accesses[0].accessAddress == base);
+  CHECK(info.accesses[0].size == 24);
+  CHECK(info.accesses[0].type == QBDI::MEMORY_READ);
+  CHECK(info.accesses[0].flags == QBDI::MEMORY_UNKNOWN_VALUE);
+  CHECK(info.accesses[1].accessAddress == base + 32);
+  CHECK(info.accesses[1].size == 8);
+  CHECK(info.accesses[1].type == QBDI::MEMORY_WRITE);
+  CHECK(info.accesses[1].flags == QBDI::MEMORY_NO_FLAGS);
+  CHECK(info.accesses[2].accessAddress == base + 32);
+  CHECK(info.accesses[2].size == 16);
+  CHECK(info.accesses[2].type == QBDI::MEMORY_READ);
+  CHECK(info.accesses[2].flags == QBDI::MEMORY_UNKNOWN_VALUE);
+}
+
+TEST_CASE_METHOD(APITest, "MemoryAccessTest_X86_64-LastMemoryAccess_C") {
+
+  const char source[] =
+      "mov (%rbx), %rax\n"
+      "mov 8(%rbx), %rcx\n"
+      "mov %rax, 32(%rbx)\n"
+      "mov 16(%rbx), %rdx\n"
+      "mov 40(%rbx), %rsi\n"
+      "mov 32(%rbx), %rdi\n"
+      "nop\n";
+
+  QBDI::rword buff[8] = {0};
+  const QBDI::rword base = (QBDI::rword)&buff;
+
+  // accesses of all the instructions and of the last 1, 3 and 5 instructions
+  // (the nop included)
+  const uint32_t instCounts[] = {0, 1, 3, 5};
+  std::vector<QBDI::MemoryAccess> accesses[4];
+  size_t truncatedTotal = 0;
+  QBDI::MemoryAccess truncated[2];
+
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+  vm.addMnemonicCB("NOOP", QBDI::PREINST,
+                   [&](QBDI::VMInstanceRef vm, QBDI::GPRState *,
+                       QBDI::FPRState *) {
+                     for (size_t i = 0; i < 4; i++) {
+                       accesses[i].resize(16);
+                       size_t total = QBDI::qbdi_getLastMemoryAccess(
+                           vm, instCounts[i], accesses[i].data(), 16);
+                       CHECK(total <= 16u);
+                       accesses[i].resize(total);
+                     }
+                     truncatedTotal =
+                         QBDI::qbdi_getLastMemoryAccess(vm, 0, truncated, 2);
+                     CHECK(QBDI::qbdi_getLastMemoryAccess(vm, 0, nullptr, 0) ==
+                           truncatedTotal);
+                     return QBDI::VMAction::CONTINUE;
+                   });
+
+  QBDI::GPRState *state = vm.getGPRState();
+  state->rbx = base;
+  vm.setGPRState(state);
+
+  QBDI::rword retval;
+  bool ran = runOnASM(&retval, source);
+  CHECK(ran);
+
+  // the nop doesn't access the memory
+  CHECK(accesses[1].size() == 0u);
+
+  const QBDI::rword unmergedOffset[] = {0, 8, 32, 16, 40, 32};
+  REQUIRE(accesses[0].size() == 6u);
+  for (size_t i = 0; i < 6; i++) {
+    CHECK(accesses[0][i].accessAddress == base + unmergedOffset[i]);
+    CHECK(accesses[0][i].size == 8);
+    CHECK(accesses[0][i].type ==
+          ((i == 2) ? QBDI::MEMORY_WRITE : QBDI::MEMORY_READ));
+  }
+  REQUIRE(accesses[2].size() == 2u);
+  CHECK(accesses[2][0].accessAddress == base + 40);
+  CHECK(accesses[2][1].accessAddress == base + 32);
+  REQUIRE(accesses[3].size() == 4u);
+  CHECK(accesses[3][0].accessAddress == base + 32);
+  CHECK(accesses[3][0].type == QBDI::MEMORY_WRITE);
+  CHECK(accesses[3][1].accessAddress == base + 16);
+  CHECK(truncatedTotal == 6u);
+  CHECK(truncated[0].accessAddress == base);
+  CHECK(truncated[1].accessAddress == base + 8);
+
+  vm.setOptions(vm.getOptions() | QBDI::Options::OPT_MERGE_MEMORY_ACCESS);
+  state->rbx = base;
+  vm.setGPRState(state);
+
+  ran = runOnASM(&retval, source);
+  CHECK(ran);
+
+  CHECK(accesses[1].size() == 0u);
+
+  REQUIRE(accesses[0].size() == 3u);
+  CHECK(accesses[0][0].accessAddress == base);
+  CHECK(accesses[0][0].size == 24);
+  CHECK(accesses[0][0].type == QBDI::MEMORY_READ);
+  CHECK(accesses[0][1].accessAddress == base + 32);
+  CHECK(accesses[0][1].size == 8);
+  CHECK(accesses[0][1].type == QBDI::MEMORY_WRITE);
+  CHECK(accesses[0][2].accessAddress == base + 32);
+  CHECK(accesses[0][2].size == 16);
+  CHECK(accesses[0][2].type == QBDI::MEMORY_READ);
+  // only the accesses of the last instructions are merged together
+  REQUIRE(accesses[2].size() == 1u);
+  CHECK(accesses[2][0].accessAddress == base + 32);
+  CHECK(accesses[2][0].size == 16);
+  CHECK(accesses[2][0].type == QBDI::MEMORY_READ);
+  REQUIRE(accesses[3].size() == 3u);
+  CHECK(accesses[3][0].accessAddress == base + 32);
+  CHECK(accesses[3][0].size == 8);
+  CHECK(accesses[3][0].type == QBDI::MEMORY_WRITE);
+  CHECK(accesses[3][1].accessAddress == base + 16);
+  CHECK(accesses[3][1].size == 8);
+  CHECK(accesses[3][1].type == QBDI::MEMORY_READ);
+  CHECK(accesses[3][2].accessAddress == base + 32);
+  CHECK(accesses[3][2].size == 16);
+  CHECK(accesses[3][2].type == QBDI::MEMORY_READ);
+  CHECK(truncatedTotal == 3u);
+  CHECK(truncated[0].accessAddress == base);
+  CHECK(truncated[1].accessAddress == base + 32);
+}
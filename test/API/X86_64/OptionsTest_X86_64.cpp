@@ -20,11 +20,24 @@
 
 #include <algorithm>
 #include <sstream>
+#include <string.h>
 #include <string>
 #include "inttypes.h"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/MC/MCInst.h"
+
 #include "QBDI/Memory.hpp"
 #include "QBDI/Platform.h"
+#include "Engine/Engine.h"
+#include "Engine/LLVMCPU.h"
+#include "Patch/InstrRule.h"
+#include "Patch/MemoryAccess.h"
+#include "Patch/Patch.h"
+#include "Patch/PatchRuleAssembly.h"
+#include "Patch/RelocatableInst.h"
+
+#include "Utility/System.h"
 
 TEST_CASE_METHOD(OptionsTest, "OptionsTest_X86_64-ATTSyntax") {
 
@@ -103,3 +116,235 @@ TEST_CASE_METHOD(OptionsTest, "OptionsTest_X86_64-setOption") {
 
   QBDI::alignedFree(fakestack);
 }
+
+static QBDI::VMAction countMemoryAccess(QBDI::VMInstanceRef vm,
+                                       const QBDI::VMState *vmState,
+                                       QBDI::GPRState *gprState,
+                                       QBDI::FPRState *fprState, void *data) {
+  *((size_t *)data) += vm->getBBMemoryAccess().size();
+  return QBDI::VMAction::CONTINUE;
+}
+
+// Size of the code generated for a basic block with the instrumentation of
+// VM::recordMemoryAccess
+static size_t getMemoryAccessCodeSize(llvm::ArrayRef<uint8_t> code,
+                                      QBDI::rword address,
+                                      QBDI::Options options) {
+  QBDI::LLVMCPUs llvmcpus;
+  const QBDI::LLVMCPU &llvmcpu = llvmcpus.getCPU(QBDI::CPUMode::DEFAULT);
+
+  QBDI::PatchRuleAssembly patchRuleAssembly(options);
+  QBDI::Patch::Vec basicBlock;
+  size_t offset = 0;
+  while (offset < code.size()) {
+    llvm::MCInst inst;
+    uint64_t size;
+    REQUIRE(llvmcpu.getInstruction(inst, size, code.slice(offset),
+                                   address + offset));
+    patchRuleAssembly.generate(inst, address + offset, size, llvmcpu,
+                               basicBlock);
+    offset += size;
+  }
+
+  QBDI::InstrRuleList rules;
+  uint32_t id = 0;
+  for (auto &r : QBDI::getInstrRuleMemAccessRead()) {
+    rules.emplace_back(id++, std::move(r));
+  }
+  for (auto &r : QBDI::getInstrRuleMemAccessWrite()) {
+    rules.emplace_back(id++, std::move(r));
+  }
+  QBDI::instrumentPatches(basicBlock, basicBlock.size(), rules, llvmcpu,
+                          options);
+
+  size_t codeSize = 0;
+  for (const QBDI::Patch &patch : basicBlock) {
+    codeSize += QBDI::getUniquePtrVecSize(patch.insts, llvmcpu);
+  }
+  return codeSize;
+}
+
+TEST_CASE_METHOD(OptionsTest, "OptionsTest_X86_64-RegLiveness") {
+  // RCX, RDX and RSI are written before being read: the memory access
+  // instrumentation can use them without backup
+  InMemoryObject obj("movq (%rdi), %rcx\n"
+                     "movq 8(%rdi), %rdx\n"
+                     "addq %rcx, %rdx\n"
+                     "movq %rdx, 16(%rdi)\n"
+                     "movl $0x20, %ecx\n"
+                     "movl $0x30, %edx\n"
+                     "movl $0x40, %esi\n"
+                     "movq 16(%rdi), %rax\n"
+                     "ret\n");
+  QBDI::rword addr = (QBDI::rword)obj.getCode().data();
+
+  // the backup of the temporary registers is removed
+  CHECK(getMemoryAccessCodeSize(obj.getCode(), addr,
+                                QBDI::Options::OPT_ENABLE_REG_LIVENESS) <
+        getMemoryAccessCodeSize(obj.getCode(), addr, QBDI::Options::NO_OPT));
+
+  uint8_t *fakestack;
+  QBDI::GPRState *state = vm.getGPRState();
+  bool ret = QBDI::allocateVirtualStack(state, 4096, &fakestack);
+  REQUIRE(ret == true);
+
+  vm.addInstrumentedRange(addr, addr + (QBDI::rword)obj.getCode().size());
+  REQUIRE(vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE));
+  size_t nbAccess = 0;
+  size_t nbAccessRef = 0;
+  vm.addVMEventCB(QBDI::SEQUENCE_EXIT, countMemoryAccess, &nbAccess);
+
+  for (QBDI::Options opt :
+       {QBDI::Options::NO_OPT, QBDI::Options::OPT_ENABLE_REG_LIVENESS}) {
+    vm.setOptions(opt);
+    QBDI::rword buffer[3] = {0x1000, 0x234, 0};
+    nbAccess = 0;
+    state->rbx = 0x1111;
+    state->r8 = 0x8888;
+    state->r11 = 0xbbbb;
+    state->r15 = 0xffff;
+
+    QBDI::rword retval;
+    REQUIRE(vm.call(&retval, addr, {(QBDI::rword)buffer}));
+
+    CHECK(retval == 0x1234);
+    CHECK(buffer[2] == 0x1234);
+    // 4 accesses + the read of the return address
+    CHECK(nbAccess >= 4);
+    if (opt == QBDI::Options::NO_OPT) {
+      nbAccessRef = nbAccess;
+    } else {
+      CHECK(nbAccess == nbAccessRef);
+    }
+    CHECK(state->rcx == 0x20);
+    CHECK(state->rdx == 0x30);
+    CHECK(state->rsi == 0x40);
+    CHECK(state->rbx == 0x1111);
+    CHECK(state->r8 == 0x8888);
+    CHECK(state->r11 == 0xbbbb);
+    CHECK(state->r15 == 0xffff);
+  }
+
+  QBDI::alignedFree(fakestack);
+}
+
+TEST_CASE_METHOD(OptionsTest, "OptionsTest_X86_64-RegLivenessCmpxchg") {
+  // RCX is only written by the cmpxchg if it's equal to RAX: the memory access
+  // instrumentation of the mov can't use it without backup
+  InMemoryObject obj("movq (%rdi), %rax\n"
+                     "cmpxchgq %rdx, %rcx\n"
+                     "movq %rcx, 8(%rdi)\n"
+                     "ret\n");
+  QBDI::rword addr = (QBDI::rword)obj.getCode().data();
+
+  uint8_t *fakestack;
+  QBDI::GPRState *state = vm.getGPRState();
+  bool ret = QBDI::allocateVirtualStack(state, 4096, &fakestack);
+  REQUIRE(ret == true);
+
+  vm.addInstrumentedRange(addr, addr + (QBDI::rword)obj.getCode().size());
+  REQUIRE(vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE));
+
+  for (QBDI::Options opt :
+       {QBDI::Options::NO_OPT, QBDI::Options::OPT_ENABLE_REG_LIVENESS}) {
+    vm.setOptions(opt);
+    // different and equal values
+    for (QBDI::rword value : {0x1000, 0x1234}) {
+      QBDI::rword buffer[2] = {value, 0};
+      state->rcx = 0x1234;
+      state->rdx = 0x5678;
+
+      QBDI::rword retval;
+      REQUIRE(vm.call(&retval, addr, {(QBDI::rword)buffer}));
+
+      QBDI::rword expectedRCX = (value == 0x1234) ? 0x5678 : 0x1234;
+      CHECK(retval == 0x1234);
+      CHECK(buffer[1] == expectedRCX);
+      CHECK(state->rcx == expectedRCX);
+    }
+  }
+
+  QBDI::alignedFree(fakestack);
+}
+
+TEST_CASE_METHOD(OptionsTest, "OptionsTest_X86_64-AVX512State") {
+  if (!QBDI::isHostCPUFeaturePresent("avx512f")) {
+    WARN("Host doesn't support avx512f feature: SKIP");
+    return;
+  }
+  InMemoryObject obj("vextracti64x4 $1, %zmm1, %ymm2\n"
+                     "vmovdqa64 %zmm16, %zmm17\n"
+                     "kmovw %k1, %eax\n"
+                     "ret\n");
+  QBDI::rword addr = (QBDI::rword)obj.getCode().data();
+
+  uint8_t *fakestack;
+  QBDI::GPRState *state = vm.getGPRState();
+  bool ret = QBDI::allocateVirtualStack(state, 4096, &fakestack);
+  REQUIRE(ret == true);
+
+  vm.addInstrumentedRange(addr, addr + (QBDI::rword)obj.getCode().size());
+
+  for (QBDI::Options opt :
+       {QBDI::Options::NO_OPT, QBDI::Options::OPT_DISABLE_OPTIONAL_FPR}) {
+    vm.setOptions(opt);
+    QBDI::FPRState *fstate = vm.getFPRState();
+    memset(fstate->zmm1, 0x11, sizeof(fstate->zmm1));
+    memset(fstate->zmm16, 0x22, sizeof(fstate->zmm16));
+    memset(fstate->zmm17, 0, sizeof(fstate->zmm17));
+    fstate->k1 = 0x1234;
+
+    QBDI::rword retval;
+    REQUIRE(vm.call(&retval, addr, {}));
+
+    fstate = vm.getFPRState();
+    CHECK(retval == 0x1234);
+    CHECK(fstate->k1 == 0x1234);
+    for (size_t i = 0; i < sizeof(fstate->xmm2); i++) {
+      INFO("The offset is " << i);
+      CHECK(fstate->xmm2[i] == 0x11);
+      CHECK(fstate->ymm2[i] == 0x11);
+    }
+    for (size_t i = 0; i < sizeof(fstate->zmm17); i++) {
+      INFO("The offset is " << i);
+      CHECK(fstate->zmm17[i] == 0x22);
+    }
+  }
+
+  QBDI::alignedFree(fakestack);
+}
+
+TEST_CASE_METHOD(OptionsTest, "OptionsTest_X86_64-FSGS") {
+#if !defined(QBDI_PLATFORM_LINUX)
+  if (!QBDI::isFSGSBaseEnabled()) {
+    WARN("Host doesn't support fsgsbase feature: SKIP");
+    return;
+  }
+#endif
+  InMemoryObject obj("movq %fs:0, %rax\n"
+                     "addq %gs:8, %rax\n"
+                     "ret\n");
+  QBDI::rword addr = (QBDI::rword)obj.getCode().data();
+
+  uint8_t *fakestack;
+  QBDI::GPRState *state = vm.getGPRState();
+  bool ret = QBDI::allocateVirtualStack(state, 4096, &fakestack);
+  REQUIRE(ret == true);
+
+  vm.setOptions(QBDI::Options::OPT_ENABLE_FS_GS);
+  vm.addInstrumentedRange(addr, addr + (QBDI::rword)obj.getCode().size());
+
+  QBDI::rword fsBuffer[2] = {0x1000, 0};
+  QBDI::rword gsBuffer[2] = {0, 0x234};
+  state->fs = (QBDI::rword)fsBuffer;
+  state->gs = (QBDI::rword)gsBuffer;
+
+  QBDI::rword retval;
+  REQUIRE(vm.call(&retval, addr, {}));
+
+  CHECK(retval == 0x1234);
+  CHECK(state->fs == (QBDI::rword)fsBuffer);
+  CHECK(state->gs == (QBDI::rword)gsBuffer);
+
+  QBDI::alignedFree(fakestack);
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+
+#include "QBDI/Config.h"
+#include "Benchmark/BenchmarkReport.h"
+
+#include <catch2/catch.hpp>
+
+#if defined(QBDI_ARCH_X86_64)
+static const char *BENCH_ARCH = "X86_64";
+#elif defined(QBDI_ARCH_X86)
+static const char *BENCH_ARCH = "X86";
+#elif defined(QBDI_ARCH_ARM)
+static const char *BENCH_ARCH = "ARM";
+#elif defined(QBDI_ARCH_AARCH64)
+static const char *BENCH_ARCH = "AARCH64";
+#endif
+
+void writeBenchmarkReport(const char *path,
+                          const std::vector<BenchmarkResult> &results) {
+  FILE *f = fopen(path, "w");
+  REQUIRE(f != nullptr);
+  fprintf(f, "{\n  \"arch\": \"%s\",\n  \"results\": [\n", BENCH_ARCH);
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &r = results[i];
+    fprintf(f,
+            "    {\"sample\": \"%s\", \"stage\": \"%s\", \"config\": \"%s\", "
+            "\"events\": %zu, \"value\": %.3f, \"unit\": \"%s\", "
+            "\"samples\": [",
+            r.sample.c_str(), r.stage.c_str(), r.config.c_str(), r.events,
+            r.value, r.unit.c_str());
+    for (size_t j = 0; j < r.samples.size(); j++) {
+      fprintf(f, "%s%.3f", (j == 0) ? "" : ", ", r.samples[j]);
+    }
+    fprintf(f, "]}%s\n", (i + 1 < results.size()) ? "," : "");
+    printf("%-16s %-32s %-24s %14.3f %s\n", r.sample.c_str(), r.stage.c_str(),
+           r.config.c_str(), r.value, r.unit.c_str());
+  }
+  fprintf(f, "  ]\n}\n");
+  fclose(f);
+}
+
+void writeBenchmarkCSV(const char *path,
+                       const std::vector<BenchmarkResult> &results) {
+  FILE *f = fopen(path, "w");
+  REQUIRE(f != nullptr);
+  fprintf(f, "arch,sample,stage,config,events,value,unit\n");
+  for (const BenchmarkResult &r : results) {
+    fprintf(f, "%s,%s,%s,%s,%zu,%.3f,%s\n", BENCH_ARCH, r.sample.c_str(),
+            r.stage.c_str(), r.config.c_str(), r.events, r.value,
+            r.unit.c_str());
+  }
+  fclose(f);
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef QBDITEST_BENCHMARKREPORT_H
+#define QBDITEST_BENCHMARKREPORT_H
+
+#include <algorithm>
+#include <chrono>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// The benchmarks that need a finer unit than the time of a Catch2 BENCHMARK
+// (instructions per second, nanoseconds per event) write their results in a
+// JSON (or CSV) report:
+//
+// {"arch": "X86_64",
+//  "results": [{"sample": ..., "stage": ..., "config": ..., "events": ...,
+//               "value": ..., "unit": ..., "samples": [...]}, ...]}
+//
+// The value is the fastest round, and the samples are all the rounds. The
+// reports are stored and compared by tools/benchmark_compare.
+
+struct BenchmarkResult {
+  // the code or the workload measured
+  std::string sample;
+  // the path of QBDI measured
+  std::string stage;
+  // the variant of the stage, or an empty string
+  std::string config;
+  // number of events (instructions, callbacks, ...) of a round
+  size_t events;
+  double value;
+  // "inst/s", "ns/event", "ms" or "x native"
+  std::string unit;
+  // the value of each round
+  std::vector<double> samples;
+};
+
+static const unsigned BENCH_MIN_ROUNDS = 5;
+static const std::chrono::milliseconds BENCH_MIN_TIME(500);
+
+/*! Run setup() and run() until both BENCH_MIN_ROUNDS and BENCH_MIN_TIME are
+ * reached. Only run() is timed.
+ *
+ * @return The duration of each round, in seconds
+ */
+template <typename Setup, typename Run>
+std::vector<double> measureRounds(Setup setup, Run run) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point begin = Clock::now();
+  std::vector<double> rounds;
+  while (rounds.size() < BENCH_MIN_ROUNDS or
+         Clock::now() - begin < BENCH_MIN_TIME) {
+    auto input = setup();
+    Clock::time_point start = Clock::now();
+    run(input);
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    rounds.push_back(elapsed.count());
+  }
+  return rounds;
+}
+
+/*! Build a result from the duration of the rounds
+ *
+ * @param[in] convert  Convert a duration in seconds to the unit of the result
+ */
+template <typename Convert>
+BenchmarkResult makeBenchmarkResult(const std::string &sample,
+                                    const std::string &stage,
+                                    const std::string &config, size_t events,
+                                    const std::vector<double> &rounds,
+                                    Convert convert, const std::string &unit) {
+  std::vector<double> samples;
+  for (double r : rounds) {
+    samples.push_back(convert(r));
+  }
+  double best = *std::min_element(rounds.begin(), rounds.end());
+  return {sample, stage, config, events, convert(best), unit, samples};
+}
+
+/*! Print the results and write them in a JSON report
+ *
+ * @param[in] path     The path of the report
+ * @param[in] results  The results of the benchmark
+ */
+void writeBenchmarkReport(const char *path,
+                          const std::vector<BenchmarkResult> &results);
+
+/*! Write the results in a CSV report
+ *
+ * @param[in] path     The path of the report
+ * @param[in] results  The results of the benchmark
+ */
+void writeBenchmarkCSV(const char *path,
+                       const std::vector<BenchmarkResult> &results);
+
+#endif /* QBDITEST_BENCHMARKREPORT_H */
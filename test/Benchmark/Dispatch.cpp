@@ -0,0 +1,245 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <functional>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include <QBDI.h>
+#include "Benchmark/BenchmarkReport.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+// Measure the cost of the runtime paths of QBDI, in nanoseconds per event,
+// on tight loops whose code is already in the cache. The results are written
+// in BENCH_DISPATCH_JSON_PATH.
+
+static const char *BENCH_DISPATCH_JSON_PATH = "QBDIBenchmark_dispatch.json";
+static const QBDI::rword BENCH_LOOP_ITER = 10000;
+static const size_t BENCH_BUFFER_SIZE = 64;
+
+static QBDI::rword dispatchBuffer[BENCH_BUFFER_SIZE];
+static QBDI::rword unusedBuffer[BENCH_BUFFER_SIZE];
+static const char *dispatchString = "QBDI";
+// not instrumented: each call is a round trip through the ExecBroker
+static size_t (*volatile externalFunction)(const char *) = strlen;
+
+QBDI_NOINLINE QBDI::rword dispatchLoop(QBDI::rword n) {
+  QBDI::rword acc = 0;
+  for (QBDI::rword i = 0; i < n; i++) {
+    dispatchBuffer[i % BENCH_BUFFER_SIZE] += i;
+    acc ^= dispatchBuffer[(i * 7) % BENCH_BUFFER_SIZE];
+  }
+  return acc;
+}
+
+QBDI_NOINLINE QBDI::rword transferLoop(QBDI::rword n) {
+  QBDI::rword acc = 0;
+  for (QBDI::rword i = 0; i < n; i++) {
+    acc += externalFunction(dispatchString);
+  }
+  return acc;
+}
+
+namespace {
+
+using LoopFunction = QBDI::rword (*)(QBDI::rword);
+using Instrument = std::function<void(QBDI::VM &, void *)>;
+
+QBDI::VMAction countInstCB(QBDI::VMInstanceRef vm, QBDI::GPRState *gprState,
+                           QBDI::FPRState *fprState, void *data) {
+  (*static_cast<uint64_t *>(data))++;
+  return QBDI::VMAction::CONTINUE;
+}
+
+QBDI::VMAction countEventCB(QBDI::VMInstanceRef vm,
+                            const QBDI::VMState *vmState,
+                            QBDI::GPRState *gprState,
+                            QBDI::FPRState *fprState, void *data) {
+  (*static_cast<uint64_t *>(data))++;
+  return QBDI::VMAction::CONTINUE;
+}
+
+template <QBDI::VMAction action>
+QBDI::VMAction actionCB(QBDI::VMInstanceRef vm, QBDI::GPRState *gprState,
+                        QBDI::FPRState *fprState, void *data) {
+  return action;
+}
+
+QBDI::VMAction emptyEventCB(QBDI::VMInstanceRef vm,
+                            const QBDI::VMState *vmState,
+                            QBDI::GPRState *gprState,
+                            QBDI::FPRState *fprState, void *data) {
+  return QBDI::VMAction::CONTINUE;
+}
+
+QBDI::VMAction memoryAccessCB(QBDI::VMInstanceRef vm,
+                              QBDI::GPRState *gprState,
+                              QBDI::FPRState *fprState, void *data) {
+  (*static_cast<uint64_t *>(data)) += vm->getInstMemoryAccess().size();
+  return QBDI::VMAction::CONTINUE;
+}
+
+// Called with the instrumentation of the case to measure, or with a callback
+// that counts the events of the case
+struct DispatchCase {
+  const char *stage;
+  const char *config;
+  LoopFunction loop;
+  Instrument instrument;
+  Instrument count;
+};
+
+class DispatchVM {
+  uint8_t *fakestack = nullptr;
+
+public:
+  QBDI::VM vm;
+
+  DispatchVM() {
+    QBDI::allocateVirtualStack(vm.getGPRState(), 1 << 20, &fakestack);
+    vm.addInstrumentedModuleFromAddr(
+        reinterpret_cast<QBDI::rword>(dispatchLoop));
+  }
+
+  ~DispatchVM() { QBDI::alignedFree(fakestack); }
+
+  QBDI::rword call(LoopFunction loop) {
+    QBDI::rword ret = 0;
+    vm.call(&ret, reinterpret_cast<QBDI::rword>(loop), {BENCH_LOOP_ITER});
+    return ret;
+  }
+};
+
+BenchmarkResult benchCase(const DispatchCase &c) {
+  uint64_t events = 0;
+  {
+    DispatchVM counter;
+    c.count(counter.vm, &events);
+    counter.call(c.loop);
+  }
+  REQUIRE(events > 0);
+
+  DispatchVM bench;
+  uint64_t data = 0;
+  c.instrument(bench.vm, &data);
+  // fill the cache
+  bench.call(c.loop);
+
+  std::vector<double> rounds =
+      measureRounds([] { return 0; }, [&](int) { bench.call(c.loop); });
+  return makeBenchmarkResult(
+      c.loop == transferLoop ? "transfer loop" : "dispatch loop", c.stage,
+      c.config, events, rounds,
+      [events](double round) { return round * 1e9 / events; }, "ns/event");
+}
+
+void countInst(QBDI::VM &vm, void *data) {
+  vm.addCodeCB(QBDI::PREINST, countInstCB, data);
+}
+
+void countBasicBlock(QBDI::VM &vm, void *data) {
+  vm.addVMEventCB(QBDI::BASIC_BLOCK_ENTRY, countEventCB, data);
+}
+
+void countMemoryInst(QBDI::VM &vm, void *data) {
+  vm.addMemAccessCB(QBDI::MEMORY_READ_WRITE, countInstCB, data);
+}
+
+template <QBDI::InstPosition pos, QBDI::VMAction action>
+void addActionCB(QBDI::VM &vm, void *data) {
+  vm.addCodeCB(pos, actionCB<action>, data);
+}
+
+template <QBDI::VMEvent event>
+void addEventCB(QBDI::VM &vm, void *data) {
+  vm.addVMEventCB(event, emptyEventCB, data);
+}
+
+} // namespace
+
+TEST_CASE("Benchmark_Dispatch") {
+  const QBDI::rword buffer = reinterpret_cast<QBDI::rword>(dispatchBuffer);
+  const QBDI::rword unused = reinterpret_cast<QBDI::rword>(unusedBuffer);
+
+  // SKIP_INST and SKIP_PATCH change the behavior of the loop and aren't
+  // measured
+  const std::vector<DispatchCase> cases = {
+      {"Engine::run", "cache hit", dispatchLoop, [](QBDI::VM &, void *) {},
+       countBasicBlock},
+      {"InstCallback", "PREINST CONTINUE", dispatchLoop,
+       addActionCB<QBDI::PREINST, QBDI::CONTINUE>, countInst},
+      {"InstCallback", "PREINST BREAK_TO_VM", dispatchLoop,
+       addActionCB<QBDI::PREINST, QBDI::BREAK_TO_VM>, countInst},
+      {"InstCallback", "POSTINST CONTINUE", dispatchLoop,
+       addActionCB<QBDI::POSTINST, QBDI::CONTINUE>, countInst},
+      {"InstCallback", "POSTINST BREAK_TO_VM", dispatchLoop,
+       addActionCB<QBDI::POSTINST, QBDI::BREAK_TO_VM>, countInst},
+      {"VMCallback", "SEQUENCE_ENTRY", dispatchLoop,
+       addEventCB<QBDI::SEQUENCE_ENTRY>,
+       [](QBDI::VM &vm, void *data) {
+         vm.addVMEventCB(QBDI::SEQUENCE_ENTRY, countEventCB, data);
+       }},
+      {"VMCallback", "BASIC_BLOCK_ENTRY", dispatchLoop,
+       addEventCB<QBDI::BASIC_BLOCK_ENTRY>, countBasicBlock},
+      {"VMCallback", "BASIC_BLOCK_EXIT", dispatchLoop,
+       addEventCB<QBDI::BASIC_BLOCK_EXIT>, countBasicBlock},
+      {"ExecBroker", "call and return", transferLoop,
+       [](QBDI::VM &, void *) {},
+       [](QBDI::VM &vm, void *data) {
+         vm.addVMEventCB(QBDI::EXEC_TRANSFER_CALL, countEventCB, data);
+       }},
+      {"ExecBroker", "EXEC_TRANSFER_CALL", transferLoop,
+       addEventCB<QBDI::EXEC_TRANSFER_CALL>,
+       [](QBDI::VM &vm, void *data) {
+         vm.addVMEventCB(QBDI::EXEC_TRANSFER_CALL, countEventCB, data);
+       }},
+      {"addMemAccessCB", "empty callback", dispatchLoop,
+       [](QBDI::VM &vm, void *data) {
+         vm.addMemAccessCB(QBDI::MEMORY_READ_WRITE, actionCB<QBDI::CONTINUE>,
+                           data);
+       },
+       countMemoryInst},
+      {"getInstMemoryAccess", "", dispatchLoop,
+       [](QBDI::VM &vm, void *data) {
+         vm.addMemAccessCB(QBDI::MEMORY_READ_WRITE, memoryAccessCB, data);
+       },
+       countMemoryInst},
+      {"addMemRangeCB", "gate hit", dispatchLoop,
+       [buffer](QBDI::VM &vm, void *data) {
+         vm.addMemRangeCB(buffer, buffer + sizeof(dispatchBuffer),
+                          QBDI::MEMORY_READ_WRITE, actionCB<QBDI::CONTINUE>,
+                          data);
+       },
+       countMemoryInst},
+      {"addMemRangeCB", "gate miss", dispatchLoop,
+       [unused](QBDI::VM &vm, void *data) {
+         vm.addMemRangeCB(unused, unused + sizeof(unusedBuffer),
+                          QBDI::MEMORY_READ_WRITE, actionCB<QBDI::CONTINUE>,
+                          data);
+       },
+       countMemoryInst},
+  };
+
+  std::vector<BenchmarkResult> results;
+  for (const DispatchCase &c : cases) {
+    results.push_back(benchCase(c));
+  }
+  writeBenchmarkReport(BENCH_DISPATCH_JSON_PATH, results);
+}
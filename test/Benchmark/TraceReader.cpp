@@ -0,0 +1,107 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "TraceReader.h"
+#include "TraceWriter.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+static const char *BENCH_TRACE_PATH = "QBDIBenchmark_trace.bin";
+static const uint64_t BENCH_TRACE_INST = 1000000;
+
+// Generate a trace that looks like a real execution: short basic blocks in a
+// few pages, with a memory access every three instructions.
+static void generateTrace(const char *path) {
+  QBDI::Trace::TraceWriter writer;
+  REQUIRE(writer.open(path));
+
+  uint64_t seed = 0x2545F4914F6CDD1DULL;
+  uint64_t pc = 0x400000;
+  uint64_t stack = 0x7ffff000;
+  for (uint64_t i = 0; i < BENCH_TRACE_INST; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    if ((seed & 0x7) == 0) {
+      pc = 0x400000 + ((seed >> 8) & 0xfffff);
+    } else {
+      pc += 1 + ((seed >> 3) & 0x7);
+    }
+    writer.writeInst(pc);
+    if (i % 3 == 0) {
+      writer.writeMemoryAccess(stack - ((seed >> 16) & 0xff) * 8, 8,
+                               QBDI::Trace::TRACE_ACCESS_READ, seed);
+    }
+  }
+  REQUIRE(writer.close());
+}
+
+TEST_CASE("Benchmark_TraceReader") {
+
+  generateTrace(BENCH_TRACE_PATH);
+
+  QBDI::Trace::TraceReader reader;
+  REQUIRE(reader.open(BENCH_TRACE_PATH));
+  REQUIRE(reader.getInstCount() == BENCH_TRACE_INST);
+
+  BENCHMARK("Decode whole trace") {
+    QBDI::Trace::TraceCursor cursor = reader.begin();
+    QBDI::Trace::TraceRecord record;
+    uint64_t sum = 0;
+    while (reader.next(cursor, record)) {
+      sum += record.address;
+    }
+    return sum;
+  };
+
+  BENCHMARK("Decode whole trace by batch") {
+    QBDI::Trace::TraceCursor cursor = reader.begin();
+    std::vector<QBDI::Trace::TraceRecord> records(4096);
+    uint64_t sum = 0;
+    size_t n;
+    while ((n = reader.read(cursor, records.data(), records.size())) != 0) {
+      for (size_t i = 0; i < n; i++) {
+        sum += records[i].address;
+      }
+    }
+    return sum;
+  };
+
+  BENCHMARK("Seek to 1000 instruction counts") {
+    QBDI::Trace::TraceCursor cursor;
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < 1000; i++) {
+      if (reader.seekToInstCount((i * 7919) % BENCH_TRACE_INST, cursor)) {
+        sum += cursor.recordIndex;
+      }
+    }
+    return sum;
+  };
+
+  BENCHMARK("Open trace and load the seek index") {
+    QBDI::Trace::TraceReader r;
+    return r.open(BENCH_TRACE_PATH, 1024);
+  };
+
+  reader.close();
+  remove(BENCH_TRACE_PATH);
+}
@@ -0,0 +1,330 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCInstrDesc.h"
+#include "llvm/MC/MCInstrInfo.h"
+
+#include "QBDI/Memory.hpp"
+#include "Benchmark/BenchmarkReport.h"
+#include "Engine/Engine.h"
+#include "Engine/LLVMCPU.h"
+#include "ExecBlock/ExecBlock.h"
+#include "Patch/InstrRule.h"
+#include "Patch/MemoryAccess.h"
+#include "Patch/Patch.h"
+#include "Patch/PatchCondition.h"
+#include "Patch/PatchRuleAssembly.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+// Measure the translation throughput, in instructions per second, of each
+// stage of Engine::handleNewBasicBlock. The results are written in
+// BENCH_TRANSLATION_JSON_PATH.
+
+static const char *BENCH_TRANSLATION_JSON_PATH =
+    "QBDIBenchmark_translation.json";
+// Size of the code translated by each round
+static const size_t BENCH_CODE_SIZE = 1 << 16;
+static const size_t BENCH_MIX_INST = 1 << 13;
+
+#if defined(QBDI_ARCH_X86_64) || defined(QBDI_ARCH_X86)
+static const size_t BENCH_INST_ALIGN = 1;
+#elif defined(QBDI_ARCH_ARM)
+static const size_t BENCH_INST_ALIGN = 2;
+#elif defined(QBDI_ARCH_AARCH64)
+static const size_t BENCH_INST_ALIGN = 4;
+#endif
+
+namespace {
+
+struct CodeSample {
+  std::string name;
+  std::vector<uint8_t> code;
+  QBDI::rword address;
+};
+
+struct DecodedInst {
+  llvm::MCInst inst;
+  QBDI::rword address;
+  uint32_t size;
+};
+
+using BasicBlocks = std::vector<QBDI::Patch::Vec>;
+
+QBDI::VMAction emptyCB(QBDI::VMInstanceRef vm, QBDI::GPRState *gprState,
+                       QBDI::FPRState *fprState, void *data) {
+  return QBDI::VMAction::CONTINUE;
+}
+
+// The beginning of the executable map of QBDIBenchmark, which contains the
+// code of QBDI and LLVM
+CodeSample getLibrarySample() {
+  QBDI::rword ref = reinterpret_cast<QBDI::rword>(&QBDI::getCurrentProcessMaps);
+  for (const QBDI::MemoryMap &m : QBDI::getCurrentProcessMaps()) {
+    if ((m.permission & QBDI::PF_EXEC) == 0 or not m.range.contains(ref)) {
+      continue;
+    }
+    size_t size = std::min<size_t>(m.range.size(), BENCH_CODE_SIZE);
+    const uint8_t *start = reinterpret_cast<const uint8_t *>(m.range.start());
+    return {"library .text", std::vector<uint8_t>(start, start + size),
+            m.range.start()};
+  }
+  FAIL("Cannot find the executable map of QBDIBenchmark");
+  return {};
+}
+
+std::vector<DecodedInst> decode(const QBDI::LLVMCPU &llvmcpu,
+                                const CodeSample &sample) {
+  std::vector<DecodedInst> insts;
+  llvm::ArrayRef<uint8_t> code(sample.code);
+  size_t offset = 0;
+  while (offset < code.size()) {
+    DecodedInst d;
+    uint64_t size;
+    d.address = sample.address + offset;
+    if (not llvmcpu.getInstruction(d.inst, size, code.slice(offset),
+                                   d.address)) {
+      // data or padding in the code
+      offset += BENCH_INST_ALIGN;
+      continue;
+    }
+    d.size = size;
+    insts.push_back(d);
+    offset += size;
+  }
+  return insts;
+}
+
+// Build a code sample with a given proportion of memory accesses and
+// branches, from the instructions of the library sample.
+CodeSample buildMix(const std::string &name, const QBDI::LLVMCPU &llvmcpu,
+                    const CodeSample &library,
+                    const std::vector<DecodedInst> &libraryInsts,
+                    unsigned memoryPercent, unsigned branchPercent) {
+  std::vector<const DecodedInst *> classes[3];
+  for (const DecodedInst &d : libraryInsts) {
+    const llvm::MCInstrDesc &desc = llvmcpu.getMCII().get(d.inst.getOpcode());
+    if (desc.isBranch() or desc.isCall() or desc.isReturn() or
+        desc.isTerminator()) {
+      classes[2].push_back(&d);
+    } else if (desc.mayLoad() or desc.mayStore()) {
+      classes[1].push_back(&d);
+    } else {
+      classes[0].push_back(&d);
+    }
+  }
+  REQUIRE(classes[0].size() > 0);
+  REQUIRE(classes[1].size() > 0);
+  REQUIRE(classes[2].size() > 0);
+
+  CodeSample mix;
+  mix.name = name;
+  uint64_t seed = 0x2545F4914F6CDD1DULL;
+  for (size_t i = 0; i < BENCH_MIX_INST; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    unsigned percent = seed % 100;
+    const std::vector<const DecodedInst *> &cls =
+        (percent < branchPercent)                   ? classes[2]
+        : (percent < branchPercent + memoryPercent) ? classes[1]
+                                                    : classes[0];
+    const DecodedInst *d = cls[(seed >> 8) % cls.size()];
+    const uint8_t *bytes = library.code.data() + (d->address - library.address);
+    mix.code.insert(mix.code.end(), bytes, bytes + d->size);
+  }
+  mix.address = reinterpret_cast<QBDI::rword>(mix.code.data());
+  return mix;
+}
+
+// Same loop as Engine::patch, without the disassembly
+BasicBlocks generate(const QBDI::LLVMCPU &llvmcpu,
+                     const std::vector<DecodedInst> &insts) {
+  QBDI::PatchRuleAssembly patchRuleAssembly(QBDI::Options::NO_OPT);
+  BasicBlocks basicBlocks;
+  QBDI::Patch::Vec basicBlock;
+  for (const DecodedInst &d : insts) {
+    if (patchRuleAssembly.generate(d.inst, d.address, d.size, llvmcpu,
+                                   basicBlock)) {
+      basicBlocks.push_back(std::move(basicBlock));
+      basicBlock.clear();
+    }
+  }
+  if (patchRuleAssembly.earlyEnd(llvmcpu, basicBlock) and
+      basicBlock.size() > 0) {
+    basicBlocks.push_back(std::move(basicBlock));
+  }
+  return basicBlocks;
+}
+
+size_t countPatches(const BasicBlocks &basicBlocks) {
+  size_t count = 0;
+  for (const QBDI::Patch::Vec &basicBlock : basicBlocks) {
+    count += basicBlock.size();
+  }
+  return count;
+}
+
+// A PREINST callback, as most tools have, and the rules of
+// VM::recordMemoryAccess
+QBDI::InstrRuleList getInstrRules(bool memoryAccess) {
+  QBDI::InstrRuleList rules;
+  uint32_t id = 0;
+  rules.emplace_back(id++, QBDI::InstrRuleBasicCBK::unique(
+                               QBDI::True::unique(), emptyCB, nullptr,
+                               QBDI::PREINST, true, QBDI::PRIORITY_DEFAULT,
+                               QBDI::RelocTagPreInstStdCBK));
+  if (memoryAccess) {
+    for (auto &r : QBDI::getInstrRuleMemAccessRead()) {
+      rules.emplace_back(id++, std::move(r));
+    }
+    for (auto &r : QBDI::getInstrRuleMemAccessWrite()) {
+      rules.emplace_back(id++, std::move(r));
+    }
+  }
+  return rules;
+}
+
+// Instrument the basic blocks with the function used by Engine::instrument
+void instrument(const QBDI::LLVMCPU &llvmcpu, const QBDI::InstrRuleList &rules,
+                QBDI::Options options, BasicBlocks &basicBlocks) {
+  for (QBDI::Patch::Vec &basicBlock : basicBlocks) {
+    QBDI::instrumentPatches(basicBlock, basicBlock.size(), rules, llvmcpu,
+                            options);
+  }
+}
+
+struct WriteInput {
+  BasicBlocks basicBlocks;
+  // kept until the end of the round to not time their destruction
+  std::vector<std::unique_ptr<QBDI::ExecBlock>> execBlocks;
+};
+
+// Write the basic blocks as ExecBlockManager::writeBasicBlock does: a new
+// ExecBlock is allocated when the current one is full.
+void writeSequences(const QBDI::LLVMCPUs &llvmcpus, WriteInput &input) {
+  input.execBlocks.push_back(std::make_unique<QBDI::ExecBlock>(llvmcpus));
+  bool emptyBlock = true;
+  for (const QBDI::Patch::Vec &basicBlock : input.basicBlocks) {
+    size_t patchIdx = 0;
+    while (patchIdx < basicBlock.size()) {
+      QBDI::SeqWriteResult res = input.execBlocks.back()->writeSequence(
+          basicBlock.begin() + patchIdx, basicBlock.end());
+      if (res.seqID == QBDI::EXEC_BLOCK_FULL) {
+        REQUIRE_FALSE(emptyBlock);
+        input.execBlocks.push_back(
+            std::make_unique<QBDI::ExecBlock>(llvmcpus));
+        emptyBlock = true;
+        continue;
+      }
+      emptyBlock = false;
+      patchIdx += res.patchWritten;
+    }
+  }
+}
+
+// Throughput of a stage, in instructions per second
+BenchmarkResult throughput(const CodeSample &sample, const char *stage,
+                           const char *config, size_t nbInst,
+                           const std::vector<double> &rounds) {
+  return makeBenchmarkResult(
+      sample.name, stage, config, nbInst, rounds,
+      [nbInst](double round) { return nbInst / round; }, "inst/s");
+}
+
+void benchSample(const QBDI::LLVMCPUs &llvmcpus, const CodeSample &sample,
+                 std::vector<BenchmarkResult> &results) {
+  const QBDI::LLVMCPU &llvmcpu = llvmcpus.getCPU(QBDI::CPUMode::DEFAULT);
+  const std::vector<DecodedInst> insts = decode(llvmcpu, sample);
+  const size_t nbPatch = countPatches(generate(llvmcpu, insts));
+  REQUIRE(insts.size() > 0);
+  REQUIRE(nbPatch > 0);
+
+  results.push_back(throughput(
+      sample, "LLVMCPU::getInstruction", "", insts.size(),
+      measureRounds([] { return 0; },
+                    [&](int) { decode(llvmcpu, sample); })));
+
+  results.push_back(throughput(
+      sample, "PatchRuleAssembly::generate", "", insts.size(),
+      measureRounds(
+          [] { return BasicBlocks(); },
+          [&](BasicBlocks &out) { out = generate(llvmcpu, insts); })));
+
+  for (bool memoryAccess : {false, true}) {
+    for (bool liveness : {false, true}) {
+      const QBDI::InstrRuleList rules = getInstrRules(memoryAccess);
+      const QBDI::Options options = liveness
+                                        ? QBDI::Options::OPT_ENABLE_REG_LIVENESS
+                                        : QBDI::Options::NO_OPT;
+      const char *config =
+          memoryAccess ? (liveness ? "memory access, reg liveness"
+                                   : "memory access")
+                       : (liveness ? "reg liveness" : "");
+
+      results.push_back(throughput(
+          sample, "Engine::instrument", config, nbPatch,
+          measureRounds([&] { return generate(llvmcpu, insts); },
+                        [&](BasicBlocks &basicBlocks) {
+                          instrument(llvmcpu, rules, options, basicBlocks);
+                        })));
+
+      results.push_back(throughput(
+          sample, "ExecBlock::writeSequence", config, nbPatch,
+          measureRounds(
+              [&] {
+                WriteInput input;
+                input.basicBlocks = generate(llvmcpu, insts);
+                instrument(llvmcpu, rules, options, input.basicBlocks);
+                return input;
+              },
+              [&](WriteInput &input) { writeSequences(llvmcpus, input); })));
+    }
+  }
+}
+
+} // namespace
+
+TEST_CASE("Benchmark_Translation") {
+  QBDI::LLVMCPUs llvmcpus;
+  const QBDI::LLVMCPU &llvmcpu = llvmcpus.getCPU(QBDI::CPUMode::DEFAULT);
+
+  const CodeSample library = getLibrarySample();
+  const std::vector<DecodedInst> libraryInsts = decode(llvmcpu, library);
+
+  std::vector<BenchmarkResult> results;
+  benchSample(llvmcpus, library, results);
+  benchSample(llvmcpus,
+              buildMix("mix alu", llvmcpu, library, libraryInsts, 0, 0),
+              results);
+  benchSample(llvmcpus,
+              buildMix("mix memory", llvmcpu, library, libraryInsts, 50, 0),
+              results);
+  benchSample(llvmcpus,
+              buildMix("mix branch", llvmcpu, library, libraryInsts, 20, 20),
+              results);
+
+  writeBenchmarkReport(BENCH_TRANSLATION_JSON_PATH, results);
+}
@@ -0,0 +1,593 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <QBDI.h>
+#include "Benchmark/BenchmarkReport.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+// Run a corpus of workloads natively and under several configurations of the
+// VM. The slowdowns are written in BENCH_WORKLOAD_JSON_PATH and
+// BENCH_WORKLOAD_CSV_PATH.
+
+static const char *BENCH_WORKLOAD_JSON_PATH = "QBDIBenchmark_workload.json";
+static const char *BENCH_WORKLOAD_CSV_PATH = "QBDIBenchmark_workload.csv";
+
+static const size_t WORKLOAD_TEXT_SIZE = 1 << 15;
+static const size_t WORKLOAD_JSON_ITEMS = 512;
+static const size_t WORKLOAD_SORT_SIZE = 1 << 13;
+static const QBDI::rword WORKLOAD_INTERPRETER_N = 2000;
+
+static const char *const workloadWords[] = {
+    "the",  "quick",  "brown",           "fox",      "jumps", "over",
+    "lazy", "dog",    "qbdi",            "dynamic",  "binary",
+    "a",    "basic",  "instrumentation", "sequence", "of",    "blocks",
+    "is",   "cached", "and",             "run",      "oxo",   "xxy",
+};
+static const size_t workloadNbWords =
+    sizeof(workloadWords) / sizeof(workloadWords[0]);
+
+static std::string workloadText;
+static std::string workloadJson;
+static std::vector<uint32_t> workloadIntegers;
+static std::vector<uint32_t> workloadSortBuffer;
+static std::vector<uint32_t> workloadWordIndex;
+static std::vector<uint8_t> workloadCompressed;
+
+static uint64_t workloadSeed;
+
+static uint64_t workloadRandom() {
+  workloadSeed ^= workloadSeed << 13;
+  workloadSeed ^= workloadSeed >> 7;
+  workloadSeed ^= workloadSeed << 17;
+  return workloadSeed;
+}
+
+static void prepareWorkloads() {
+  if (not workloadText.empty()) {
+    return;
+  }
+  workloadSeed = 0x2545F4914F6CDD1DULL;
+  while (workloadText.size() < WORKLOAD_TEXT_SIZE) {
+    workloadText += workloadWords[workloadRandom() % workloadNbWords];
+    workloadText += (workloadRandom() % 8 == 0) ? '\n' : ' ';
+  }
+
+  workloadJson = "[";
+  for (size_t i = 0; i < WORKLOAD_JSON_ITEMS; i++) {
+    workloadJson += (i == 0) ? "{" : ", {";
+    workloadJson += "\"id\": " + std::to_string(i);
+    workloadJson += ", \"name\": \"";
+    workloadJson += workloadWords[workloadRandom() % workloadNbWords];
+    workloadJson += "\\n\", \"score\": -";
+    workloadJson += std::to_string(workloadRandom() % 100000);
+    workloadJson += ", \"valid\": true, \"parent\": null, \"tags\": [";
+    for (size_t j = 0; j < i % 5; j++) {
+      workloadJson += (j == 0) ? "\"" : ", \"";
+      workloadJson += workloadWords[workloadRandom() % workloadNbWords];
+      workloadJson += "\"";
+    }
+    workloadJson += "], \"child\": {\"depth\": [[1, 2], [3]]}}";
+  }
+  workloadJson += "]";
+
+  for (size_t i = 0; i < WORKLOAD_SORT_SIZE; i++) {
+    workloadIntegers.push_back(workloadRandom());
+  }
+  workloadSortBuffer.resize(WORKLOAD_SORT_SIZE);
+  workloadWordIndex.resize(WORKLOAD_SORT_SIZE);
+  workloadCompressed.resize(WORKLOAD_TEXT_SIZE * 2);
+}
+
+// Compression
+// ===========
+
+// LZ77 with a hash table of the last position of each 3-byte prefix
+QBDI_NOINLINE QBDI::rword compressWorkload(QBDI::rword) {
+  static uint32_t head[1 << 12];
+  const uint8_t *in = reinterpret_cast<const uint8_t *>(workloadText.data());
+  const size_t size = workloadText.size();
+  uint8_t *out = workloadCompressed.data();
+  size_t outSize = 0;
+
+  memset(head, 0, sizeof(head));
+  size_t i = 0;
+  while (i < size) {
+    size_t matchLen = 0;
+    size_t matchDist = 0;
+    if (i + 3 <= size) {
+      uint32_t h = ((in[i] << 6) ^ (in[i + 1] << 3) ^ in[i + 2]) & 0xfff;
+      size_t candidate = head[h];
+      head[h] = i + 1;
+      if (candidate != 0 and i - (candidate - 1) < 0xffff) {
+        candidate--;
+        while (i + matchLen < size and matchLen < 0xff and
+               in[candidate + matchLen] == in[i + matchLen]) {
+          matchLen++;
+        }
+        matchDist = i - candidate;
+      }
+    }
+    if (matchLen >= 3) {
+      out[outSize++] = 0xff;
+      out[outSize++] = matchLen;
+      out[outSize++] = matchDist & 0xff;
+      out[outSize++] = matchDist >> 8;
+      i += matchLen;
+    } else {
+      if (in[i] == 0xff) {
+        out[outSize++] = 0xff;
+        out[outSize++] = 0;
+      } else {
+        out[outSize++] = in[i];
+      }
+      i++;
+    }
+  }
+  QBDI::rword checksum = outSize;
+  for (size_t j = 0; j < outSize; j++) {
+    checksum = checksum * 31 + out[j];
+  }
+  return checksum;
+}
+
+// JSON parsing
+// ============
+
+struct JsonParser {
+  const char *cur;
+  QBDI::rword numbers;
+  QBDI::rword strings;
+
+  void skipSpaces() {
+    while (*cur == ' ' or *cur == '\n' or *cur == '\t' or *cur == '\r') {
+      cur++;
+    }
+  }
+
+  bool parseString() {
+    if (*cur++ != '"') {
+      return false;
+    }
+    while (*cur != '"') {
+      if (*cur == '\0') {
+        return false;
+      }
+      if (*cur == '\\') {
+        cur++;
+      }
+      cur++;
+    }
+    cur++;
+    strings++;
+    return true;
+  }
+
+  bool parseNumber() {
+    bool negative = (*cur == '-');
+    if (negative) {
+      cur++;
+    }
+    if (*cur < '0' or *cur > '9') {
+      return false;
+    }
+    QBDI::rword value = 0;
+    while (*cur >= '0' and *cur <= '9') {
+      value = value * 10 + (*cur++ - '0');
+    }
+    numbers += negative ? -value : value;
+    return true;
+  }
+
+  bool parseLiteral(const char *literal) {
+    size_t len = strlen(literal);
+    if (strncmp(cur, literal, len) != 0) {
+      return false;
+    }
+    cur += len;
+    return true;
+  }
+
+  bool parseValue() {
+    skipSpaces();
+    switch (*cur) {
+      case '{':
+        cur++;
+        skipSpaces();
+        if (*cur == '}') {
+          cur++;
+          return true;
+        }
+        while (true) {
+          skipSpaces();
+          if (not parseString()) {
+            return false;
+          }
+          skipSpaces();
+          if (*cur++ != ':' or not parseValue()) {
+            return false;
+          }
+          skipSpaces();
+          if (*cur == '}') {
+            cur++;
+            return true;
+          }
+          if (*cur++ != ',') {
+            return false;
+          }
+        }
+      case '[':
+        cur++;
+        skipSpaces();
+        if (*cur == ']') {
+          cur++;
+          return true;
+        }
+        while (true) {
+          if (not parseValue()) {
+            return false;
+          }
+          skipSpaces();
+          if (*cur == ']') {
+            cur++;
+            return true;
+          }
+          if (*cur++ != ',') {
+            return false;
+          }
+        }
+      case '"':
+        return parseString();
+      case 't':
+        return parseLiteral("true");
+      case 'f':
+        return parseLiteral("false");
+      case 'n':
+        return parseLiteral("null");
+      default:
+        return parseNumber();
+    }
+  }
+};
+
+QBDI_NOINLINE QBDI::rword jsonWorkload(QBDI::rword) {
+  JsonParser parser = {workloadJson.c_str(), 0, 0};
+  if (not parser.parseValue()) {
+    return 0;
+  }
+  return parser.numbers * 31 + parser.strings;
+}
+
+// Regex matching
+// ==============
+
+// The matcher of "The Practice of Programming" (c . ^ $ *)
+static bool matchHere(const char *re, const char *text, const char *end);
+
+static bool matchStar(char c, const char *re, const char *text,
+                      const char *end) {
+  do {
+    if (matchHere(re, text, end)) {
+      return true;
+    }
+  } while (text != end and (*text++ == c or c == '.'));
+  return false;
+}
+
+static bool matchHere(const char *re, const char *text, const char *end) {
+  if (re[0] == '\0') {
+    return true;
+  }
+  if (re[1] == '*') {
+    return matchStar(re[0], re + 2, text, end);
+  }
+  if (re[0] == '$' and re[1] == '\0') {
+    return text == end;
+  }
+  if (text != end and (re[0] == '.' or re[0] == *text)) {
+    return matchHere(re + 1, text + 1, end);
+  }
+  return false;
+}
+
+static bool match(const char *re, const char *text, const char *end) {
+  if (re[0] == '^') {
+    return matchHere(re + 1, text, end);
+  }
+  do {
+    if (matchHere(re, text, end)) {
+      return true;
+    }
+  } while (text++ != end);
+  return false;
+}
+
+QBDI_NOINLINE QBDI::rword regexWorkload(QBDI::rword) {
+  static const char *const patterns[] = {"qu.*k", "^the", "dog$",
+                                         "x*y",   "o.o",  "b.*c.*d"};
+  QBDI::rword count = 0;
+  const char *line = workloadText.c_str();
+  const char *textEnd = line + workloadText.size();
+  while (line < textEnd) {
+    const char *end =
+        static_cast<const char *>(memchr(line, '\n', textEnd - line));
+    if (end == nullptr) {
+      end = textEnd;
+    }
+    for (const char *re : patterns) {
+      count = (count << 1) + match(re, line, end);
+    }
+    line = end + 1;
+  }
+  return count;
+}
+
+// Sorting
+// =======
+
+static bool wordLess(uint32_t a, uint32_t b) {
+  const char *wa = workloadWords[a % workloadNbWords];
+  const char *wb = workloadWords[b % workloadNbWords];
+  while (*wa != '\0' and *wa == *wb) {
+    wa++;
+    wb++;
+  }
+  if (*wa != *wb) {
+    return *wa < *wb;
+  }
+  return a < b;
+}
+
+QBDI_NOINLINE QBDI::rword sortWorkload(QBDI::rword) {
+  std::copy(workloadIntegers.begin(), workloadIntegers.end(),
+            workloadSortBuffer.begin());
+  std::sort(workloadSortBuffer.begin(), workloadSortBuffer.end());
+
+  std::copy(workloadIntegers.begin(), workloadIntegers.end(),
+            workloadWordIndex.begin());
+  std::stable_sort(workloadWordIndex.begin(), workloadWordIndex.end(),
+                   wordLess);
+
+  return workloadSortBuffer[WORKLOAD_SORT_SIZE / 2] ^ workloadWordIndex[0];
+}
+
+// Interpreter
+// ===========
+
+enum InterpreterOp : uint8_t {
+  OP_MOV,
+  OP_ADDI,
+  OP_ISONE,
+  OP_ISODD,
+  OP_HALF,
+  OP_TRIPLE,
+  OP_JZ,
+  OP_JNZ,
+  OP_JMP,
+  OP_DECJNZ,
+  OP_HALT,
+};
+
+struct InterpreterInst {
+  InterpreterOp op;
+  uint8_t a;
+  uint8_t b;
+  uint8_t target;
+};
+
+// Total number of steps of the Collatz sequences of [1, r0]
+static const InterpreterInst interpreterProgram[] = {
+    {OP_MOV, 1, 0, 0},    {OP_ISONE, 3, 1, 0},   {OP_JNZ, 3, 0, 10},
+    {OP_ADDI, 2, 1, 0},   {OP_ISODD, 3, 1, 0},   {OP_JZ, 3, 0, 8},
+    {OP_TRIPLE, 1, 1, 0}, {OP_JMP, 0, 0, 1},     {OP_HALF, 1, 1, 0},
+    {OP_JMP, 0, 0, 1},    {OP_DECJNZ, 0, 0, 0},  {OP_HALT, 0, 0, 0},
+};
+
+QBDI_NOINLINE QBDI::rword interpreterWorkload(QBDI::rword n) {
+  QBDI::rword regs[4] = {n, 0, 0, 0};
+  size_t pc = 0;
+  while (true) {
+    const InterpreterInst &inst = interpreterProgram[pc++];
+    switch (inst.op) {
+      case OP_MOV:
+        regs[inst.a] = regs[inst.b];
+        break;
+      case OP_ADDI:
+        regs[inst.a] += inst.b;
+        break;
+      case OP_ISONE:
+        regs[inst.a] = (regs[inst.b] == 1);
+        break;
+      case OP_ISODD:
+        regs[inst.a] = regs[inst.b] & 1;
+        break;
+      case OP_HALF:
+        regs[inst.a] = regs[inst.b] >> 1;
+        break;
+      case OP_TRIPLE:
+        regs[inst.a] = regs[inst.b] * 3 + 1;
+        break;
+      case OP_JZ:
+        if (regs[inst.a] == 0) {
+          pc = inst.target;
+        }
+        break;
+      case OP_JNZ:
+        if (regs[inst.a] != 0) {
+          pc = inst.target;
+        }
+        break;
+      case OP_JMP:
+        pc = inst.target;
+        break;
+      case OP_DECJNZ:
+        if (--regs[inst.a] != 0) {
+          pc = inst.target;
+        }
+        break;
+      case OP_HALT:
+        return regs[2];
+    }
+  }
+}
+
+// Harness
+// =======
+
+namespace {
+
+using WorkloadFunction = QBDI::rword (*)(QBDI::rword);
+
+struct Workload {
+  const char *name;
+  WorkloadFunction function;
+  QBDI::rword arg;
+};
+
+struct VMConfig {
+  const char *name;
+  void (*instrument)(QBDI::VM &vm, uint64_t *data);
+};
+
+QBDI::VMAction countInstCB(QBDI::VMInstanceRef vm, QBDI::GPRState *gprState,
+                           QBDI::FPRState *fprState, void *data) {
+  (*static_cast<uint64_t *>(data))++;
+  return QBDI::VMAction::CONTINUE;
+}
+
+QBDI::VMAction countEventCB(QBDI::VMInstanceRef vm,
+                            const QBDI::VMState *vmState,
+                            QBDI::GPRState *gprState,
+                            QBDI::FPRState *fprState, void *data) {
+  (*static_cast<uint64_t *>(data))++;
+  return QBDI::VMAction::CONTINUE;
+}
+
+QBDI::VMAction memoryAccessCB(QBDI::VMInstanceRef vm,
+                              QBDI::GPRState *gprState,
+                              QBDI::FPRState *fprState, void *data) {
+  (*static_cast<uint64_t *>(data)) += vm->getInstMemoryAccess().size();
+  return QBDI::VMAction::CONTINUE;
+}
+
+const VMConfig vmConfigs[] = {
+    {"empty VM", [](QBDI::VM &, uint64_t *) {}},
+    {"BB event callbacks",
+     [](QBDI::VM &vm, uint64_t *data) {
+       vm.addVMEventCB(QBDI::BASIC_BLOCK_ENTRY | QBDI::BASIC_BLOCK_EXIT,
+                       countEventCB, data);
+     }},
+    {"instruction counting",
+     [](QBDI::VM &vm, uint64_t *data) {
+       vm.addCodeCB(QBDI::PREINST, countInstCB, data);
+     }},
+    {"memory recording",
+     [](QBDI::VM &vm, uint64_t *data) {
+       vm.addMemAccessCB(QBDI::MEMORY_READ_WRITE, memoryAccessCB, data);
+     }},
+};
+
+class WorkloadVM {
+  uint8_t *fakestack = nullptr;
+
+public:
+  QBDI::VM vm;
+
+  WorkloadVM(const Workload &w, QBDI::Options opts) : vm("", {}, opts) {
+    QBDI::allocateVirtualStack(vm.getGPRState(), 1 << 20, &fakestack);
+    vm.addInstrumentedModuleFromAddr(
+        reinterpret_cast<QBDI::rword>(w.function));
+  }
+
+  ~WorkloadVM() { QBDI::alignedFree(fakestack); }
+
+  QBDI::rword call(const Workload &w) {
+    QBDI::rword ret = 0;
+    vm.call(&ret, reinterpret_cast<QBDI::rword>(w.function), {w.arg});
+    return ret;
+  }
+};
+
+void benchWorkload(const Workload &w, std::vector<BenchmarkResult> &results) {
+  const QBDI::rword expected = w.function(w.arg);
+
+  uint64_t nbInst = 0;
+  {
+    WorkloadVM counter(w, QBDI::Options::NO_OPT);
+    counter.vm.addCodeCB(QBDI::PREINST, countInstCB, &nbInst);
+    REQUIRE(counter.call(w) == expected);
+  }
+
+  std::vector<double> nativeRounds =
+      measureRounds([] { return 0; }, [&](int) { w.function(w.arg); });
+  results.push_back(makeBenchmarkResult(
+      w.name, "native", "", nbInst, nativeRounds,
+      [](double round) { return round * 1e3; }, "ms"));
+  const double native =
+      *std::min_element(nativeRounds.begin(), nativeRounds.end());
+
+  for (QBDI::Options opts :
+       {QBDI::Options::NO_OPT, QBDI::Options::OPT_DISABLE_FPR}) {
+    const char *optsName =
+        (opts == QBDI::Options::NO_OPT) ? "" : "OPT_DISABLE_FPR";
+    for (const VMConfig &config : vmConfigs) {
+      WorkloadVM bench(w, opts);
+      uint64_t data = 0;
+      config.instrument(bench.vm, &data);
+      // fill the cache
+      if (bench.call(w) != expected) {
+        // OPT_DISABLE_FPR breaks the workloads that use the FPU
+        REQUIRE(opts != QBDI::Options::NO_OPT);
+        WARN(w.name << " is broken by " << optsName);
+        continue;
+      }
+      std::vector<double> rounds =
+          measureRounds([] { return 0; }, [&](int) { bench.call(w); });
+      results.push_back(makeBenchmarkResult(
+          w.name, config.name, optsName, nbInst, rounds,
+          [native](double round) { return round / native; }, "x native"));
+    }
+  }
+}
+
+} // namespace
+
+TEST_CASE("Benchmark_Workload") {
+  prepareWorkloads();
+
+  const Workload workloads[] = {
+      {"compression", compressWorkload, 0},
+      {"json parsing", jsonWorkload, 0},
+      {"regex matching", regexWorkload, 0},
+      {"sorting", sortWorkload, 0},
+      {"interpreter", interpreterWorkload, WORKLOAD_INTERPRETER_N},
+  };
+
+  std::vector<BenchmarkResult> results;
+  for (const Workload &w : workloads) {
+    benchWorkload(w, results);
+  }
+  writeBenchmarkReport(BENCH_WORKLOAD_JSON_PATH, results);
+  writeBenchmarkCSV(BENCH_WORKLOAD_CSV_PATH, results);
+}
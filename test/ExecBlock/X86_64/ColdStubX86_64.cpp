@@ -0,0 +1,254 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdint.h>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/MC/MCInst.h"
+
+#include "ExecBlock/ExecBlockTest.h"
+#include "ExecBlock/PatchEmpty.h"
+
+#include "QBDI/Callback.h"
+#include "QBDI/State.h"
+#include "Engine/Engine.h"
+#include "ExecBlock/Context.h"
+#include "ExecBlock/ExecBlock.h"
+#include "ExecBlock/ExecBlockManager.h"
+#include "Patch/InstrRule.h"
+#include "Patch/Patch.h"
+#include "Patch/PatchCondition.h"
+#include "Patch/PatchRuleAssembly.h"
+#include "Patch/RelocatableInst.h"
+#include "Patch/X86_64/Layer2_X86_64.h"
+
+struct ColdStubCallbackData {
+  QBDI::VMAction action;
+  unsigned count;
+};
+
+static QBDI::VMAction coldStubCallback(QBDI::VMInstanceRef vm,
+                                       QBDI::GPRState *gprState,
+                                       QBDI::FPRState *fprState, void *data) {
+  ColdStubCallbackData *info = static_cast<ColdStubCallbackData *>(data);
+  info->count++;
+  return info->action;
+}
+
+// Instrument the code with a PREINST callback on the instructions matched by
+// the condition. Each callback is written in a cold stub.
+static QBDI::Patch::Vec instrument(const QBDI::LLVMCPU &llvmcpu,
+                                   llvm::ArrayRef<uint8_t> code,
+                                   QBDI::PatchConditionUniquePtr &&condition,
+                                   ColdStubCallbackData *data) {
+  const QBDI::rword address = (QBDI::rword)code.data();
+
+  QBDI::PatchRuleAssembly patchRuleAssembly(QBDI::Options::NO_OPT);
+  QBDI::Patch::Vec basicBlock;
+  size_t offset = 0;
+  while (offset < code.size()) {
+    llvm::MCInst inst;
+    uint64_t size;
+    REQUIRE(llvmcpu.getInstruction(inst, size, code.slice(offset),
+                                   address + offset));
+    patchRuleAssembly.generate(inst, address + offset, size, llvmcpu,
+                               basicBlock);
+    offset += size;
+  }
+
+  QBDI::InstrRuleList rules;
+  rules.emplace_back(0, QBDI::InstrRuleBasicCBK::unique(
+                            std::move(condition), coldStubCallback, data,
+                            QBDI::PREINST, true));
+  QBDI::instrumentPatches(basicBlock, basicBlock.size(), rules, llvmcpu,
+                          QBDI::Options::NO_OPT);
+  return basicBlock;
+}
+
+// An empty patch followed by a cold stub of stubSize bytes. The stub is never
+// executed.
+static QBDI::Patch generateColdStubPatch(QBDI::rword address,
+                                         const QBDI::LLVMCPUs &llvmcpus,
+                                         unsigned stubSize) {
+  QBDI::Patch p = generateEmptyPatch(address, llvmcpus);
+  p.append(QBDI::RelocTag::unique(QBDI::RelocTagColdBegin));
+  for (unsigned i = 0; i < stubSize; i++) {
+    p.append(QBDI::NoReloc::unique(QBDI::nop()));
+  }
+  p.append(QBDI::RelocTag::unique(QBDI::RelocTagColdEnd));
+  return p;
+}
+
+// Size of the cold stubs written by a sequence
+static QBDI::rword getColdStubSize(const QBDI::ExecBlock &execBlock,
+                                   QBDI::rword startPC,
+                                   QBDI::rword startAvailable) {
+  QBDI::rword hotSize = execBlock.getCurrentPC() - startPC;
+  return startAvailable - execBlock.getAvailableSize() - hotSize;
+}
+
+// mov %rbx, %rax ; add $1, %rax ; add $1, %rax
+static const uint8_t ADD_CODE[] = {0x48, 0x89, 0xd8, 0x48, 0x83, 0xc0,
+                                   0x01, 0x48, 0x83, 0xc0, 0x01};
+
+TEST_CASE_METHOD(ExecBlockTest, "ExecBlockTest_X86_64-ColdStubVMAction") {
+  const QBDI::LLVMCPU &llvmcpu = getCPU(QBDI::CPUMode::DEFAULT);
+  const QBDI::rword address = (QBDI::rword)ADD_CODE;
+  const QBDI::rword endAddress = address + sizeof(ADD_CODE);
+
+  const struct {
+    QBDI::VMAction action;
+    QBDI::VMAction result;
+    QBDI::rword rax;
+    QBDI::rword pc;
+  } tests[] = {
+      {QBDI::CONTINUE, QBDI::CONTINUE, 0x12, endAddress},
+      {QBDI::SKIP_INST, QBDI::CONTINUE, 0x11, endAddress},
+      {QBDI::SKIP_PATCH, QBDI::CONTINUE, 0x11, endAddress},
+      {QBDI::BREAK_TO_VM, QBDI::BREAK_TO_VM, 0x10, address + 3},
+      {QBDI::STOP, QBDI::STOP, 0x10, address + 3},
+  };
+
+  for (const auto &t : tests) {
+    INFO("VMAction " << t.action);
+    ColdStubCallbackData data{t.action, 0};
+    // callback on the first add
+    QBDI::Patch::Vec basicBlock =
+        instrument(llvmcpu, ADD_CODE, QBDI::AddressIs::unique(address + 3),
+                   &data);
+
+    QBDI::ExecBlock execBlock(*this);
+    QBDI::rword startPC = execBlock.getCurrentPC();
+    QBDI::rword startAvailable = execBlock.getAvailableSize();
+    QBDI::SeqWriteResult res =
+        execBlock.writeSequence(basicBlock.begin(), basicBlock.end());
+    REQUIRE(res.seqID != QBDI::EXEC_BLOCK_FULL);
+    REQUIRE(res.patchWritten == basicBlock.size());
+    // the callback is written in a cold stub
+    CHECK(getColdStubSize(execBlock, startPC, startAvailable) > 0);
+
+    QBDI::GPRState *gprState = &execBlock.getContext()->gprState;
+    gprState->rax = 0;
+    gprState->rbx = 0x10;
+    execBlock.selectSeq(res.seqID);
+    CHECK(execBlock.execute() == t.result);
+    CHECK(data.count == 1);
+    CHECK(gprState->rax == t.rax);
+    CHECK(QBDI_GPR_GET(gprState, QBDI::REG_PC) == t.pc);
+
+    if (t.action == QBDI::BREAK_TO_VM) {
+      // the execution resumes after the jump to the cold stub
+      CHECK(execBlock.execute() == QBDI::CONTINUE);
+      CHECK(data.count == 1);
+      CHECK(gprState->rax == 0x12);
+      CHECK(QBDI_GPR_GET(gprState, QBDI::REG_PC) == endAddress);
+    }
+  }
+}
+
+TEST_CASE_METHOD(ExecBlockTest, "ExecBlockTest_X86_64-ColdStubNotFit") {
+  QBDI::rword available = QBDI::ExecBlock(*this).getAvailableSize();
+  // only one of these stubs fits in an ExecBlock
+  unsigned stubSize = available / 2 + 64;
+
+  QBDI::ExecBlock execBlock(*this);
+  QBDI::Patch::Vec first;
+  first.push_back(generateColdStubPatch(0x42424240, *this, stubSize));
+  QBDI::rword startPC = execBlock.getCurrentPC();
+  QBDI::rword startAvailable = execBlock.getAvailableSize();
+  QBDI::SeqWriteResult res1 =
+      execBlock.writeSequence(first.begin(), first.end());
+  REQUIRE(res1.seqID != QBDI::EXEC_BLOCK_FULL);
+  CHECK(getColdStubSize(execBlock, startPC, startAvailable) == stubSize);
+
+  // the second stub doesn't fit: the hot and cold positions are restored
+  QBDI::Patch::Vec second;
+  second.push_back(generateColdStubPatch(0x42424241, *this, stubSize));
+  QBDI::rword pc = execBlock.getCurrentPC();
+  QBDI::rword availableSize = execBlock.getAvailableSize();
+  QBDI::SeqWriteResult res2 =
+      execBlock.writeSequence(second.begin(), second.end());
+  CHECK(res2.seqID == QBDI::EXEC_BLOCK_FULL);
+  CHECK(res2.patchWritten == 0);
+  CHECK(execBlock.getCurrentPC() == pc);
+  CHECK(execBlock.getAvailableSize() == availableSize);
+
+  // the ExecBlockManager writes the second patch in another ExecBlock
+  QBDI::ExecBlockManager execBlockManager(*this);
+  QBDI::Patch::Vec basicBlock;
+  basicBlock.push_back(generateColdStubPatch(0x42424240, *this, stubSize));
+  basicBlock.push_back(generateColdStubPatch(0x42424241, *this, stubSize));
+  execBlockManager.writeBasicBlock(std::move(basicBlock), 2);
+  const QBDI::ExecBlock *block1 =
+      execBlockManager.getExecBlock(0x42424240, QBDI::CPUMode::DEFAULT);
+  const QBDI::ExecBlock *block2 =
+      execBlockManager.getExecBlock(0x42424241, QBDI::CPUMode::DEFAULT);
+  REQUIRE(block1 != nullptr);
+  REQUIRE(block2 != nullptr);
+  CHECK(block1 != block2);
+}
+
+TEST_CASE_METHOD(ExecBlockTest, "ExecBlockTest_X86_64-ColdStubRollback") {
+  const QBDI::LLVMCPU &llvmcpu = getCPU(QBDI::CPUMode::DEFAULT);
+
+  // 512 x add $1, %rax : too many callbacks for one ExecBlock
+  std::vector<uint8_t> code;
+  for (unsigned i = 0; i < 512; i++) {
+    code.insert(code.end(), {0x48, 0x83, 0xc0, 0x01});
+  }
+  const QBDI::rword address = (QBDI::rword)code.data();
+
+  ColdStubCallbackData data{QBDI::CONTINUE, 0};
+  QBDI::Patch::Vec basicBlock =
+      instrument(llvmcpu, code, QBDI::True::unique(), &data);
+
+  QBDI::ExecBlock execBlock(*this);
+  QBDI::rword startPC = execBlock.getCurrentPC();
+  QBDI::rword startAvailable = execBlock.getAvailableSize();
+  QBDI::SeqWriteResult res =
+      execBlock.writeSequence(basicBlock.begin(), basicBlock.end());
+  REQUIRE(res.seqID != QBDI::EXEC_BLOCK_FULL);
+  REQUIRE(res.patchWritten > 0);
+  REQUIRE(res.patchWritten < basicBlock.size());
+  QBDI::rword coldSize = getColdStubSize(execBlock, startPC, startAvailable);
+
+  // the stub of the rollbacked patch is freed: the cold stubs are the same as
+  // the ones of a sequence of the written patches only
+  QBDI::Patch::Vec written = instrument(
+      llvmcpu, llvm::ArrayRef<uint8_t>(code).take_front(4 * res.patchWritten),
+      QBDI::True::unique(), &data);
+  QBDI::ExecBlock execBlockRef(*this);
+  QBDI::rword refPC = execBlockRef.getCurrentPC();
+  QBDI::rword refAvailable = execBlockRef.getAvailableSize();
+  QBDI::SeqWriteResult resRef =
+      execBlockRef.writeSequence(written.begin(), written.end());
+  REQUIRE(resRef.patchWritten == res.patchWritten);
+  CHECK(getColdStubSize(execBlockRef, refPC, refAvailable) == coldSize);
+
+  // the written patches and their stubs are still executed
+  QBDI::GPRState *gprState = &execBlock.getContext()->gprState;
+  gprState->rax = 0;
+  execBlock.selectSeq(res.seqID);
+  CHECK(execBlock.execute() == QBDI::CONTINUE);
+  CHECK(data.count == res.patchWritten);
+  CHECK(gprState->rax == res.patchWritten);
+  CHECK(QBDI_GPR_GET(gprState, QBDI::REG_PC) ==
+        address + 4 * res.patchWritten);
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdint.h>
+
+#include <catch2/catch.hpp>
+
+#include "AArch64InstrInfo.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/MC/MCInst.h"
+
+#include "ExecBlock/PatchEmpty.h"
+#include "TestSetup/LLVMTestEnv.h"
+
+#include "QBDI/State.h"
+#include "ExecBlock/Context.h"
+#include "ExecBlock/ExecBlock.h"
+#include "Patch/Patch.h"
+#include "Patch/RelocatableInst.h"
+#include "Patch/Types.h"
+
+// X28 is used by the terminator
+static const unsigned LOADIMM_REGS[] = {0, 1, 15, 27};
+
+TEST_CASE_METHOD(LLVMTestEnv, "LoadImm_AARCH64-MovzMovn") {
+  const QBDI::LLVMCPU &llvmcpu = getCPU(QBDI::CPUMode::DEFAULT);
+
+  const struct {
+    QBDI::rword value;
+    unsigned opcode;
+    int64_t imm;
+    int64_t shift;
+  } tests[] = {
+      {0, llvm::AArch64::MOVZXi, 0, 0},
+      {0x1234, llvm::AArch64::MOVZXi, 0x1234, 0},
+      {0x12340000, llvm::AArch64::MOVZXi, 0x1234, 16},
+      {0x123400000000, llvm::AArch64::MOVZXi, 0x1234, 32},
+      {0x1234000000000000, llvm::AArch64::MOVZXi, 0x1234, 48},
+      {0xFFFFFFFFFFFFEDCB, llvm::AArch64::MOVNXi, 0x1234, 0},
+      {0xFFFFEDCBFFFFFFFF, llvm::AArch64::MOVNXi, 0x1234, 32},
+      {0xEDCBFFFFFFFFFFFF, llvm::AArch64::MOVNXi, 0x1234, 48},
+      {0xFFFFFFFFFFFFFFFF, llvm::AArch64::MOVNXi, 0, 0},
+  };
+
+  for (const auto &t : tests) {
+    QBDI::ExecBlock execBlock(*this);
+    for (unsigned reg : LOADIMM_REGS) {
+      INFO("value 0x" << std::hex << t.value << " register " << std::dec
+                      << reg);
+      // a single MOVZ or MOVN doesn't need the ExecBlock
+      QBDI::LoadImm loadImm(QBDI::Reg(reg), t.value);
+      llvm::MCInst inst = loadImm.reloc(nullptr, QBDI::CPUMode::DEFAULT);
+      REQUIRE(inst.getNumOperands() == 3);
+      CHECK(inst.getOpcode() == t.opcode);
+      CHECK(inst.getOperand(1).getImm() == t.imm);
+      CHECK(inst.getOperand(2).getImm() == t.shift);
+
+      llvm::SmallVector<char, 16> stream;
+      llvmcpu.writeInstruction(inst, stream, 0x42424240);
+      CHECK(stream.size() == static_cast<size_t>(loadImm.getSize(llvmcpu)));
+
+      QBDI::Patch::Vec seq;
+      seq.push_back(generateEmptyPatch(0x42424240, *this));
+      seq[0].append(QBDI::LoadImm::unique(QBDI::Reg(reg), t.value));
+      QBDI::SeqWriteResult res =
+          execBlock.writeSequence(seq.begin(), seq.end());
+      REQUIRE(res.seqID != QBDI::EXEC_BLOCK_FULL);
+
+      QBDI::GPRState *gprState = &execBlock.getContext()->gprState;
+      QBDI_GPR_SET(gprState, reg, 0xdeadbeefdeadbeef);
+      execBlock.selectSeq(res.seqID);
+      execBlock.execute();
+      CHECK(QBDI_GPR_GET(gprState, reg) == t.value);
+    }
+  }
+}
+
+TEST_CASE_METHOD(LLVMTestEnv, "LoadImm_AARCH64-Shadow") {
+  QBDI::ExecBlock execBlock(*this);
+
+  // values that need more than one MOVZ or MOVN are loaded from a shadow
+  for (QBDI::rword value :
+       {0x12345678ull, 0x1234000000005678ull, 0xFFFF1234FFFF5678ull}) {
+    INFO("value 0x" << std::hex << value);
+    llvm::MCInst inst = QBDI::LoadImm(QBDI::Reg(0), value)
+                            .reloc(&execBlock, QBDI::CPUMode::DEFAULT);
+    CHECK((inst.getOpcode() == llvm::AArch64::LDRXui or
+           inst.getOpcode() == llvm::AArch64::LDURXi));
+  }
+}
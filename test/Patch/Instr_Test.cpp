@@ -145,3 +145,32 @@ TEST_CASE_METHOD(Instr_Test, "Instr_Test-StackTricks_IC") {
 
   INFO("Took " << count1 << " instructions");
 }
+
+TEST_CASE_METHOD(Instr_Test, "Instr_Test-GPRShuffle_IC_MemoryAccess") {
+  INFO("TEST_SEED=" << seed_random());
+  uint64_t count1 = 0;
+  uint64_t count2 = 0;
+  uint64_t count3 = 0;
+  uint64_t count4 = 0;
+
+  QBDI::Context inputState;
+  initContext(inputState);
+
+  // several instrumentations on each instruction: the backup of the
+  // temporary registers can be shared between them
+  vm.deleteAllInstrumentations();
+  vm.recordMemoryAccess(QBDI::MEMORY_READ_WRITE);
+  vm.addCodeCB(QBDI::PREINST, increment, (void *)&count1);
+  vm.addCodeCB(QBDI::PREINST, increment, (void *)&count2);
+  vm.addCodeCB(QBDI::POSTINST, increment, (void *)&count3);
+  vm.addCodeCB(QBDI::POSTINST, increment, (void *)&count4);
+
+  comparedExec(GPRShuffle_s, inputState, 4096);
+
+  REQUIRE((uint64_t)0 < count1);
+  REQUIRE(count1 == count2);
+  REQUIRE(count1 == count3);
+  REQUIRE(count1 == count4);
+
+  INFO("Took " << count1 << " instructions");
+}
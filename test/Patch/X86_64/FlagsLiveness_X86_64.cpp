@@ -0,0 +1,136 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <iterator>
+#include <stdint.h>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "X86InstrInfo.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/MC/MCInst.h"
+
+#include "TestSetup/LLVMTestEnv.h"
+#include "Engine/Engine.h"
+#include "Patch/InstrRule.h"
+#include "Patch/Patch.h"
+#include "Patch/PatchCondition.h"
+#include "Patch/PatchGenerator.h"
+#include "Patch/PatchRuleAssembly.h"
+#include "Patch/PatchUtils.h"
+#include "Patch/RelocatableInst.h"
+#include "Patch/TempManager.h"
+#include "Patch/X86_64/PatchGenerator_X86_64.h"
+
+// Opcodes of the code generated by SaveFlags and RestoreFlags for a patch
+static std::vector<unsigned> getSaveFlagsOpcodes(QBDI::Patch &patch) {
+  QBDI::TempManager tempManager(patch);
+  QBDI::RelocatableInst::UniquePtrVec insts =
+      QBDI::SaveFlags(QBDI::Temp(0)).generate(patch, tempManager);
+  QBDI::RelocatableInst::UniquePtrVec restore =
+      QBDI::RestoreFlags(QBDI::Temp(0)).generate(patch, tempManager);
+  std::move(restore.begin(), restore.end(), std::back_inserter(insts));
+
+  std::vector<unsigned> opcodes;
+  for (const auto &inst : insts) {
+    opcodes.push_back(
+        inst->reloc(nullptr, QBDI::CPUMode::DEFAULT).getOpcode());
+  }
+  return opcodes;
+}
+
+static const QBDI::PatchGenerator::UniquePtrVec &
+saveRestoreFlags(QBDI::Patch &patch, const QBDI::LLVMCPU &llvmcpu) {
+  static const QBDI::PatchGenerator::UniquePtrVec r =
+      QBDI::conv_unique<QBDI::PatchGenerator>(
+          QBDI::SaveFlags::unique(QBDI::Temp(0)),
+          QBDI::RestoreFlags::unique(QBDI::Temp(0)));
+  return r;
+}
+
+// Instrument the code with a rule that saves the flags before each
+// instruction
+static QBDI::Patch::Vec instrument(const QBDI::LLVMCPU &llvmcpu,
+                                   llvm::ArrayRef<uint8_t> code,
+                                   bool flagsLiveness) {
+  const QBDI::rword address = (QBDI::rword)code.data();
+
+  QBDI::PatchRuleAssembly patchRuleAssembly(QBDI::Options::NO_OPT);
+  QBDI::Patch::Vec basicBlock;
+  size_t offset = 0;
+  while (offset < code.size()) {
+    llvm::MCInst inst;
+    uint64_t size;
+    REQUIRE(llvmcpu.getInstruction(inst, size, code.slice(offset),
+                                   address + offset));
+    patchRuleAssembly.generate(inst, address + offset, size, llvmcpu,
+                               basicBlock);
+    offset += size;
+  }
+
+  QBDI::InstrRuleList rules;
+  rules.emplace_back(0, QBDI::InstrRuleDynamic::unique(
+                            QBDI::True::unique(), saveRestoreFlags,
+                            QBDI::PREINST, false, QBDI::PRIORITY_DEFAULT,
+                            QBDI::RelocTagInvalid, flagsLiveness));
+  QBDI::instrumentPatches(basicBlock, basicBlock.size(), rules, llvmcpu,
+                          QBDI::Options::NO_OPT);
+  return basicBlock;
+}
+
+// mov %rbx, %rax ; cmp %rdx, %rsi ; sete %al ; ret
+static const uint8_t FLAGS_CODE[] = {0x48, 0x89, 0xd8, 0x48, 0x39,
+                                     0xd6, 0x0f, 0x94, 0xc0, 0xc3};
+
+TEST_CASE_METHOD(LLVMTestEnv, "FlagsLiveness_X86_64-SaveFlags") {
+  const QBDI::LLVMCPU &llvmcpu = getCPU(QBDI::CPUMode::DEFAULT);
+
+  QBDI::Patch::Vec basicBlock = instrument(llvmcpu, FLAGS_CODE, true);
+  REQUIRE(basicBlock.size() == 4);
+
+  // the flags are overwritten by the CMP before being read
+  CHECK(basicBlock[0].flagsDead);
+  // the flags are read by the SETE, and live at the end of the sequence
+  CHECK_FALSE(basicBlock[1].flagsDead);
+  CHECK_FALSE(basicBlock[2].flagsDead);
+  CHECK_FALSE(basicBlock[3].flagsDead);
+
+  // no backup of dead flags
+  CHECK(getSaveFlagsOpcodes(basicBlock[0]).empty());
+
+  // the live flags are saved without PUSHF/POPF
+  std::vector<unsigned> opcodes = getSaveFlagsOpcodes(basicBlock[1]);
+  CHECK(std::count(opcodes.begin(), opcodes.end(), llvm::X86::LAHF) == 1);
+  CHECK(std::count(opcodes.begin(), opcodes.end(), llvm::X86::SAHF) == 1);
+  CHECK(std::count(opcodes.begin(), opcodes.end(), llvm::X86::PUSHF64) == 0);
+  CHECK(std::count(opcodes.begin(), opcodes.end(), llvm::X86::POPF64) == 0);
+}
+
+TEST_CASE_METHOD(LLVMTestEnv, "FlagsLiveness_X86_64-NotRequested") {
+  const QBDI::LLVMCPU &llvmcpu = getCPU(QBDI::CPUMode::DEFAULT);
+
+  // without a rule that needs it, the liveness isn't computed and the flags
+  // are considered live
+  QBDI::Patch::Vec basicBlock = instrument(llvmcpu, FLAGS_CODE, false);
+  REQUIRE(basicBlock.size() == 4);
+
+  for (const QBDI::Patch &patch : basicBlock) {
+    CHECK_FALSE(patch.flagsDead);
+  }
+}
@@ -0,0 +1,122 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdint.h>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "X86InstrInfo.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/MC/MCInst.h"
+
+#include "ExecBlock/PatchEmpty.h"
+#include "TestSetup/LLVMTestEnv.h"
+
+#include "QBDI/State.h"
+#include "ExecBlock/Context.h"
+#include "ExecBlock/ExecBlock.h"
+#include "Patch/Patch.h"
+#include "Patch/RelocatableInst.h"
+#include "Patch/Types.h"
+
+// RAX and R8 to R15
+static const unsigned LOADIMM_REGS[] = {0, 6, 7, 8, 9, 10, 11, 12, 13};
+
+// Encode the instruction and check its size against getSize
+static unsigned checkEncodedSize(const QBDI::RelocatableInst &reloc,
+                                 const llvm::MCInst &inst,
+                                 const QBDI::LLVMCPU &llvmcpu) {
+  llvm::SmallVector<char, 16> stream;
+  llvmcpu.writeInstruction(inst, stream, 0x42424240);
+  CHECK(stream.size() == static_cast<size_t>(reloc.getSize(llvmcpu)));
+  return stream.size();
+}
+
+// Write the RelocatableInst in a sequence and execute it. The register is set
+// to a garbage value before the execution.
+static QBDI::rword execute(QBDI::ExecBlock &execBlock,
+                           QBDI::RelocatableInst::UniquePtr &&reloc,
+                           unsigned reg, const QBDI::LLVMCPUs &llvmcpus,
+                           uint16_t *instID = nullptr) {
+  QBDI::Patch::Vec seq;
+  seq.push_back(generateEmptyPatch(0x42424240, llvmcpus));
+  seq[0].append(std::move(reloc));
+  QBDI::SeqWriteResult res = execBlock.writeSequence(seq.begin(), seq.end());
+  REQUIRE(res.seqID != QBDI::EXEC_BLOCK_FULL);
+  if (instID != nullptr) {
+    *instID = execBlock.getSeqStart(res.seqID);
+  }
+
+  QBDI::GPRState *gprState = &execBlock.getContext()->gprState;
+  QBDI_GPR_SET(gprState, reg, 0xdeadbeefdeadbeef);
+  execBlock.selectSeq(res.seqID);
+  execBlock.execute();
+  return QBDI_GPR_GET(gprState, reg);
+}
+
+TEST_CASE_METHOD(LLVMTestEnv, "LoadImm_X86_64-Encoding") {
+  const QBDI::LLVMCPU &llvmcpu = getCPU(QBDI::CPUMode::DEFAULT);
+
+  const struct {
+    QBDI::rword value;
+    unsigned opcode;
+    unsigned size;
+    unsigned sizeR8_R15;
+  } tests[] = {
+      {0x7FFFFFFF, llvm::X86::MOV32ri, 5, 6},
+      {0x80000000, llvm::X86::MOV32ri, 5, 6},
+      {0xFFFFFFFF, llvm::X86::MOV32ri, 5, 6},
+      {0x100000000, llvm::X86::MOV64ri, 10, 10},
+      {static_cast<QBDI::rword>(-1), llvm::X86::MOV64ri32, 7, 7},
+  };
+
+  for (const auto &t : tests) {
+    QBDI::ExecBlock execBlock(*this);
+    for (unsigned reg : LOADIMM_REGS) {
+      INFO("value 0x" << std::hex << t.value << " register " << std::dec
+                      << reg);
+      QBDI::LoadImm loadImm(QBDI::Reg(reg), t.value);
+      llvm::MCInst inst = loadImm.reloc(nullptr, QBDI::CPUMode::DEFAULT);
+      CHECK(inst.getOpcode() == t.opcode);
+      CHECK(checkEncodedSize(loadImm, inst, llvmcpu) ==
+            (reg < 6 ? t.size : t.sizeR8_R15));
+
+      // the 32-bit mov clears the upper half of the register
+      CHECK(execute(execBlock, QBDI::LoadImm::unique(QBDI::Reg(reg), t.value),
+                    reg, *this) == t.value);
+    }
+  }
+}
+
+TEST_CASE_METHOD(LLVMTestEnv, "LoadImm_X86_64-InstId") {
+  const QBDI::LLVMCPU &llvmcpu = getCPU(QBDI::CPUMode::DEFAULT);
+
+  QBDI::ExecBlock execBlock(*this);
+  for (unsigned reg : LOADIMM_REGS) {
+    INFO("register " << reg);
+    QBDI::InstId instId(QBDI::Reg(reg));
+    llvm::MCInst inst = instId.reloc(&execBlock, QBDI::CPUMode::DEFAULT);
+    CHECK(inst.getOpcode() == llvm::X86::MOV32ri);
+    CHECK(checkEncodedSize(instId, inst, llvmcpu) == (reg < 6 ? 5u : 6u));
+
+    uint16_t instID;
+    QBDI::rword value = execute(
+        execBlock, QBDI::InstId::unique(QBDI::Reg(reg)), reg, *this, &instID);
+    CHECK(value == instID);
+  }
+}
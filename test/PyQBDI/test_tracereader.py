@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import os
+import struct
+import tempfile
+import unittest
+
+import pyqbdi
+
+HEADER_FORMAT = "<8sIIQQ"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+
+def generateRecords(numInst):
+    # (pc, [(address, size, type, value), ...]) with backward and large jumps
+    records = []
+    seed = 0x2545F4914F6CDD1D
+    pc = 0x400000
+    for i in range(numInst):
+        seed ^= (seed << 13) & 0xffffffffffffffff
+        seed ^= seed >> 7
+        seed ^= (seed << 17) & 0xffffffffffffffff
+        if seed & 0x7 == 0:
+            pc = 0x400000 + ((seed >> 8) & 0xfff)
+        elif seed & 0x7 == 1:
+            pc = 0xffffffff00000000 + (seed >> 40) if i % 2 else 0x1000
+        else:
+            pc += 1 + ((seed >> 3) & 0x7)
+        accesses = []
+        for j in range((seed >> 20) & 0x3):
+            accessType = pyqbdi.TRACE_ACCESS_WRITE if j % 2 else \
+                pyqbdi.TRACE_ACCESS_READ
+            accesses.append((0x7ffff000 - j * 8, 1 << j, accessType,
+                             seed >> (j * 8)))
+        records.append((pc, accesses))
+    return records
+
+
+class TraceReaderTest(unittest.TestCase):
+
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp(suffix=".trace")
+        os.close(fd)
+        self.records = generateRecords(1000)
+        writer = pyqbdi.TraceWriter(self.path, 32)
+        for pc, accesses in self.records:
+            writer.writeInst(pc)
+            for access in accesses:
+                writer.writeMemoryAccess(*access)
+        self.assertTrue(writer.close())
+        self.numRecords = len(self.expectedRecords())
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def expectedRecords(self):
+        # (type, instCount, address, size, accessType, value)
+        expected = []
+        for instCount, (pc, accesses) in enumerate(self.records):
+            expected.append((pyqbdi.TRACE_RECORD_INST, instCount, pc, 0, 0, 0))
+            for address, size, accessType, value in accesses:
+                expected.append((pyqbdi.TRACE_RECORD_MEMORY, instCount,
+                                 address, size, int(accessType), value))
+        return expected
+
+    def checkRecords(self, records, prefix=False):
+        expected = self.expectedRecords()
+        if prefix:
+            expected = expected[:len(records)]
+        self.assertEqual([(r.type, r.instCount, r.address, r.size,
+                           r.accessType, r.value) for r in records], expected)
+
+    def test_roundtrip(self):
+        reader = pyqbdi.TraceReader(self.path)
+        self.assertEqual(reader.recordCount, self.numRecords)
+        self.assertEqual(reader.instCount, len(self.records))
+        self.assertEqual(reader.indexInterval, 32)
+        self.assertEqual(len(reader.index), (self.numRecords + 31) // 32)
+        self.checkRecords(list(reader))
+
+        cursor = reader.begin()
+        records = []
+        while True:
+            batch = reader.read(cursor, 100)
+            if not batch:
+                break
+            records.extend(batch)
+        self.assertTrue(cursor.atEnd())
+        self.checkRecords(records)
+
+    def test_seek(self):
+        reader = pyqbdi.TraceReader(self.path)
+        for instCount, (pc, _) in enumerate(self.records):
+            cursor = reader.seekToInstCount(instCount)
+            self.assertIsNotNone(cursor)
+            record = reader.next(cursor)
+            self.assertEqual(record.instCount, instCount)
+            self.assertEqual(record.address, pc)
+        self.assertIsNone(reader.seekToInstCount(len(self.records)))
+
+        for pc in (self.records[0][0], self.records[500][0], 0x1000):
+            expected = [i for i, r in enumerate(self.records) if r[0] == pc]
+            found = []
+            cursor = reader.seekToPC(pc)
+            while cursor is not None:
+                record = reader.next(cursor)
+                self.assertEqual(record.address, pc)
+                found.append(record.instCount)
+                cursor = reader.seekToPC(pc, cursor)
+            self.assertEqual(found, expected)
+        self.assertIsNone(reader.seekToPC(0x3))
+
+    def test_truncated(self):
+        with open(self.path, "rb") as f:
+            data = f.read()
+        magic, version, interval, _, indexOffset = struct.unpack_from(
+            HEADER_FORMAT, data)
+        # a trace that wasn't closed, whose last record is cut
+        header = struct.pack(HEADER_FORMAT, magic, version, interval, 0, 0)
+        with open(self.path, "wb") as f:
+            f.write(header + data[HEADER_SIZE:indexOffset - 1])
+
+        reader = pyqbdi.TraceReader(self.path, 16)
+        self.assertLess(reader.recordCount, self.numRecords)
+        self.assertEqual(reader.indexInterval, 16)
+        records = list(reader)
+        self.assertEqual(len(records), reader.recordCount)
+        self.checkRecords(records, prefix=True)
+
+    def test_invalid_index(self):
+        with open(self.path, "rb") as f:
+            data = bytearray(f.read())
+        _, _, _, _, indexOffset = struct.unpack_from(HEADER_FORMAT, data)
+        # wrong number of index entries
+        struct.pack_into("<Q", data, indexOffset, 1)
+        with open(self.path, "wb") as f:
+            f.write(data)
+
+        reader = pyqbdi.TraceReader(self.path)
+        self.assertEqual(reader.recordCount, self.numRecords)
+        self.assertEqual(reader.instCount, len(self.records))
+        self.assertEqual(len(reader.index), (self.numRecords + 31) // 32)
+        self.checkRecords(list(reader))
+
+    def test_not_a_trace(self):
+        with open(self.path, "r+b") as f:
+            f.write(b"X")
+        with self.assertRaises(RuntimeError):
+            pyqbdi.TraceReader(self.path)
+
+
+if __name__ == "__main__":
+    unittest.main()
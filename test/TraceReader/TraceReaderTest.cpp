@@ -0,0 +1,432 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "TraceReader.h"
+#include "TraceWriter.h"
+#include "Varint.h"
+
+using namespace QBDI::Trace;
+
+namespace {
+
+std::string tracePath(const char *name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::vector<uint8_t> readFile(const std::string &path) {
+  std::ifstream f(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(f),
+                              std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &path, const std::vector<uint8_t> &data) {
+  std::ofstream f(path, std::ios::binary | std::ios::trunc);
+  f.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+// Instructions with forward, backward and large jumps, and memory accesses
+// with 64 bits values.
+std::vector<TraceRecord> generateRecords(size_t numInst) {
+  std::vector<TraceRecord> records;
+  uint64_t seed = 0x2545F4914F6CDD1DULL;
+  uint64_t pc = 0x400000;
+  for (uint64_t i = 0; i < numInst; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    switch (seed & 0x7) {
+      case 0:
+        pc = 0x400000 + ((seed >> 8) & 0xfff);
+        break;
+      case 1:
+        pc = (i % 2) ? 0xffffffff00000000ULL + (seed >> 40) : 0x1000;
+        break;
+      default:
+        pc += 1 + ((seed >> 3) & 0x7);
+        break;
+    }
+    records.push_back({TRACE_RECORD_INST, 0, 0, i, pc, 0});
+    for (unsigned j = 0; j < ((seed >> 20) & 0x3); j++) {
+      uint64_t address = (j == 2) ? seed : 0x7ffff000 - ((seed >> 24) & 0xff);
+      records.push_back({TRACE_RECORD_MEMORY,
+                         static_cast<uint8_t>((j % 2) ? TRACE_ACCESS_WRITE
+                                                      : TRACE_ACCESS_READ),
+                         static_cast<uint16_t>(1 << j), i, address,
+                         seed >> (j * 8)});
+    }
+  }
+  return records;
+}
+
+void writeTrace(const std::string &path,
+                const std::vector<TraceRecord> &records,
+                uint32_t indexInterval) {
+  TraceWriter writer;
+  REQUIRE(writer.open(path, indexInterval));
+  for (const TraceRecord &r : records) {
+    if (r.type == TRACE_RECORD_INST) {
+      writer.writeInst(r.address);
+    } else {
+      writer.writeMemoryAccess(r.address, r.size,
+                               static_cast<TraceAccessType>(r.accessType),
+                               r.value);
+    }
+  }
+  REQUIRE(writer.getRecordCount() == records.size());
+  REQUIRE(writer.close());
+}
+
+void checkRecord(const TraceRecord &r, const TraceRecord &expected) {
+  CHECK(r.type == expected.type);
+  CHECK(r.accessType == expected.accessType);
+  CHECK(r.size == expected.size);
+  CHECK(r.instCount == expected.instCount);
+  CHECK(r.address == expected.address);
+  CHECK(r.value == expected.value);
+}
+
+void checkRecords(const TraceReader &reader,
+                  const std::vector<TraceRecord> &expected) {
+  TraceCursor cursor = reader.begin();
+  TraceRecord record;
+  size_t n = 0;
+  while (reader.next(cursor, record)) {
+    REQUIRE(n < expected.size());
+    checkRecord(record, expected[n]);
+    n++;
+  }
+  CHECK(cursor.atEnd());
+  CHECK(n == expected.size());
+}
+
+uint64_t countInst(const std::vector<TraceRecord> &records) {
+  uint64_t n = 0;
+  for (const TraceRecord &r : records) {
+    n += (r.type == TRACE_RECORD_INST) ? 1 : 0;
+  }
+  return n;
+}
+
+} // namespace
+
+TEST_CASE("TraceReaderTest-Varint") {
+  std::vector<uint64_t> values = {0, 1, UINT64_MAX, 1ULL << 63};
+  // each boundary between two encoded lengths (1 to 10 bytes)
+  for (unsigned bits = 7; bits < 64; bits += 7) {
+    values.push_back((1ULL << bits) - 1);
+    values.push_back(1ULL << bits);
+    values.push_back((1ULL << bits) + 1);
+  }
+  uint64_t seed = 0x9E3779B97F4A7C15ULL;
+  for (unsigned i = 0; i < 1000; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    values.push_back(seed >> (i % 64));
+  }
+
+  for (uint64_t v : values) {
+    uint8_t buf[VARINT_MAX_SIZE + 8];
+    memset(buf, 0xff, sizeof(buf));
+    size_t len = encodeVarint(v, buf);
+    REQUIRE(len <= VARINT_MAX_SIZE);
+    size_t expectedLen = 1;
+    for (uint64_t x = v >> 7; x != 0; x >>= 7) {
+      expectedLen++;
+    }
+    CHECK(len == expectedLen);
+
+    // fast path: at least 8 readable bytes after the varint
+    uint64_t fast = 0;
+    CHECK(decodeVarint(buf, buf + sizeof(buf), fast) == buf + len);
+    CHECK(fast == v);
+
+    // slow path: the buffer ends with the varint
+    uint64_t slow = 0;
+    CHECK(decodeVarintSlow(buf, buf + len, slow) == buf + len);
+    CHECK(slow == v);
+    uint64_t endOfBuffer = 0;
+    CHECK(decodeVarint(buf, buf + len, endOfBuffer) == buf + len);
+    CHECK(endOfBuffer == v);
+
+    // truncated varint
+    if (len > 1) {
+      CHECK(decodeVarint(buf, buf + len - 1, slow) == nullptr);
+    }
+  }
+
+  // overlong varint
+  uint8_t overlong[VARINT_MAX_SIZE + 1];
+  memset(overlong, 0x80, sizeof(overlong));
+  uint64_t v;
+  CHECK(decodeVarint(overlong, overlong + sizeof(overlong), v) == nullptr);
+}
+
+TEST_CASE("TraceReaderTest-Zigzag") {
+  CHECK(zigzagEncode(0) == 0u);
+  CHECK(zigzagEncode(-1) == 1u);
+  CHECK(zigzagEncode(1) == 2u);
+  CHECK(zigzagEncode(INT64_MAX) == UINT64_MAX - 1);
+  CHECK(zigzagEncode(INT64_MIN) == UINT64_MAX);
+  for (int64_t v : {int64_t(0), int64_t(-1), int64_t(1), int64_t(-64),
+                    int64_t(64), INT64_MAX, INT64_MIN, INT64_MIN + 1}) {
+    CHECK(zigzagDecode(zigzagEncode(v)) == v);
+  }
+  // deltas between distant addresses wrap around
+  uint64_t from = 0xffffffff00000000ULL;
+  uint64_t to = 0x1000;
+  CHECK(from + static_cast<uint64_t>(zigzagDecode(zigzagEncode(to - from))) ==
+        to);
+}
+
+TEST_CASE("TraceReaderTest-RoundTrip") {
+  std::string path = tracePath("QBDITest_roundtrip.trace");
+  std::vector<TraceRecord> records = generateRecords(2000);
+  writeTrace(path, records, 64);
+
+  TraceReader reader;
+  REQUIRE(reader.open(path));
+  CHECK(reader.getRecordCount() == records.size());
+  CHECK(reader.getInstCount() == countInst(records));
+  CHECK(reader.getIndexInterval() == 64u);
+  CHECK(reader.getIndex().size() == (records.size() + 63) / 64);
+  checkRecords(reader, records);
+
+  // read by batch
+  std::vector<TraceRecord> buffer(100);
+  TraceCursor cursor = reader.begin();
+  size_t n = 0;
+  size_t r;
+  while ((r = reader.read(cursor, buffer.data(), buffer.size())) != 0) {
+    for (size_t i = 0; i < r; i++) {
+      checkRecord(buffer[i], records[n + i]);
+    }
+    n += r;
+  }
+  CHECK(n == records.size());
+
+  reader.close();
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("TraceReaderTest-EmptyTrace") {
+  std::string path = tracePath("QBDITest_empty.trace");
+  writeTrace(path, {}, 16);
+
+  TraceReader reader;
+  REQUIRE(reader.open(path));
+  CHECK(reader.getRecordCount() == 0u);
+  CHECK(reader.getInstCount() == 0u);
+  CHECK(reader.begin().atEnd());
+  TraceCursor cursor;
+  CHECK_FALSE(reader.seekToInstCount(0, cursor));
+
+  reader.close();
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("TraceReaderTest-Seek") {
+  std::string path = tracePath("QBDITest_seek.trace");
+  std::vector<TraceRecord> records = generateRecords(1000);
+  writeTrace(path, records, 32);
+
+  TraceReader reader;
+  REQUIRE(reader.open(path));
+
+  std::vector<size_t> instRecords;
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].type == TRACE_RECORD_INST) {
+      instRecords.push_back(i);
+    }
+  }
+
+  // seekToInstCount on each instruction
+  for (uint64_t i = 0; i < instRecords.size(); i++) {
+    TraceCursor cursor;
+    REQUIRE(reader.seekToInstCount(i, cursor));
+    CHECK(cursor.recordIndex == instRecords[i]);
+    TraceRecord record;
+    REQUIRE(reader.next(cursor, record));
+    checkRecord(record, records[instRecords[i]]);
+  }
+  TraceCursor cursor;
+  CHECK_FALSE(reader.seekToInstCount(instRecords.size(), cursor));
+
+  // seekToPC finds every execution of an address, in order
+  for (uint64_t pc : {records[instRecords[0]].address,
+                      records[instRecords[500]].address, uint64_t(0x1000)}) {
+    std::vector<uint64_t> expected;
+    for (size_t i : instRecords) {
+      if (records[i].address == pc) {
+        expected.push_back(i);
+      }
+    }
+    std::vector<uint64_t> found;
+    TraceCursor c = reader.begin();
+    while (reader.seekToPC(pc, c)) {
+      found.push_back(c.recordIndex);
+      TraceRecord record;
+      REQUIRE(reader.next(c, record));
+      CHECK(record.address == pc);
+    }
+    CHECK(found == expected);
+  }
+  TraceCursor c = reader.begin();
+  CHECK_FALSE(reader.seekToPC(0x3, c));
+
+  reader.close();
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("TraceReaderTest-TruncatedTrace") {
+  std::string path = tracePath("QBDITest_truncated.trace");
+  std::vector<TraceRecord> records = generateRecords(500);
+  writeTrace(path, records, 16);
+  std::vector<uint8_t> data = readFile(path);
+
+  TraceFileHeader header;
+  memcpy(&header, data.data(), sizeof(header));
+  size_t dataSize = header.indexOffset;
+
+  // a trace that wasn't closed: no index, the last record is cut
+  for (size_t cut : {dataSize - 1, dataSize - 7, dataSize / 2,
+                     sizeof(TraceFileHeader) + 1}) {
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + cut);
+    TraceFileHeader openHeader = header;
+    openHeader.recordCount = 0;
+    openHeader.indexOffset = 0;
+    memcpy(truncated.data(), &openHeader, sizeof(openHeader));
+    writeFile(path, truncated);
+
+    TraceReader reader;
+    REQUIRE(reader.open(path));
+    uint64_t count = reader.getRecordCount();
+    CHECK(count < records.size());
+    std::vector<TraceRecord> prefix(records.begin(), records.begin() + count);
+    checkRecords(reader, prefix);
+    CHECK(reader.getInstCount() == countInst(prefix));
+    CHECK(reader.getIndex().size() == (count + 15) / 16);
+
+    if (count > 0) {
+      TraceCursor cursor;
+      uint64_t lastInst = reader.getInstCount() - 1;
+      REQUIRE(reader.seekToInstCount(lastInst, cursor));
+      TraceRecord record;
+      REQUIRE(reader.next(cursor, record));
+      CHECK(record.instCount == lastInst);
+    }
+  }
+
+  // the index is rebuilt with the requested interval
+  {
+    std::vector<uint8_t> unclosed(data.begin(), data.begin() + dataSize);
+    TraceFileHeader openHeader = header;
+    openHeader.recordCount = 0;
+    openHeader.indexOffset = 0;
+    memcpy(unclosed.data(), &openHeader, sizeof(openHeader));
+    writeFile(path, unclosed);
+
+    TraceReader reader;
+    REQUIRE(reader.open(path, 100));
+    CHECK(reader.getRecordCount() == records.size());
+    CHECK(reader.getIndexInterval() == 100u);
+    CHECK(reader.getIndex().size() == (records.size() + 99) / 100);
+    checkRecords(reader, records);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("TraceReaderTest-InvalidIndex") {
+  std::string path = tracePath("QBDITest_index.trace");
+  std::vector<TraceRecord> records = generateRecords(500);
+  writeTrace(path, records, 16);
+  std::vector<uint8_t> data = readFile(path);
+
+  TraceFileHeader header;
+  memcpy(&header, data.data(), sizeof(header));
+  size_t indexOffset = header.indexOffset;
+  size_t firstEntry = indexOffset + sizeof(TraceIndexHeader);
+  uint64_t entryCount = (records.size() + 15) / 16;
+
+  auto checkRebuilt = [&](const std::vector<uint8_t> &corrupted) {
+    writeFile(path, corrupted);
+    TraceReader reader;
+    REQUIRE(reader.open(path));
+    // the records end at the index, even if the index is rejected
+    CHECK(reader.getRecordCount() == records.size());
+    CHECK(reader.getInstCount() == countInst(records));
+    CHECK(reader.getIndex().size() == entryCount);
+    checkRecords(reader, records);
+  };
+
+  // wrong number of entries
+  {
+    std::vector<uint8_t> corrupted = data;
+    uint64_t wrongCount = entryCount - 1;
+    memcpy(&corrupted[indexOffset], &wrongCount, sizeof(wrongCount));
+    checkRebuilt(corrupted);
+  }
+  // entry outside of the records
+  {
+    std::vector<uint8_t> corrupted = data;
+    uint64_t wrongOffset = indexOffset + 1;
+    memcpy(&corrupted[firstEntry + sizeof(TraceIndexEntry)], &wrongOffset,
+           sizeof(wrongOffset));
+    checkRebuilt(corrupted);
+  }
+  // record count that doesn't match the last interval
+  {
+    std::vector<uint8_t> corrupted = data;
+    TraceFileHeader wrongHeader = header;
+    wrongHeader.recordCount = records.size() - 1;
+    memcpy(corrupted.data(), &wrongHeader, sizeof(wrongHeader));
+    checkRebuilt(corrupted);
+  }
+  // index cut by the end of the file
+  {
+    std::vector<uint8_t> corrupted(data.begin(), data.end() - 8);
+    checkRebuilt(corrupted);
+  }
+
+  // not a trace
+  {
+    std::vector<uint8_t> corrupted = data;
+    corrupted[0] = 'X';
+    writeFile(path, corrupted);
+    TraceReader reader;
+    CHECK_FALSE(reader.open(path));
+  }
+  {
+    std::vector<uint8_t> corrupted(data.begin(), data.begin() + 16);
+    writeFile(path, corrupted);
+    TraceReader reader;
+    CHECK_FALSE(reader.open(path));
+  }
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# This file is part of QBDI.
+#
+# Copyright 2017 - 2024 Quarkslab
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+import sys
+import socket
+import platform
+import datetime
+import subprocess
+import argparse
+
+from SQLite import SQLiteDBAdapter
+from BenchmarkResult import load_report
+from Comparison import Comparison
+
+def get_branch_commit():
+    try:
+        out = subprocess.check_output(['git', 'rev-parse', 'HEAD', '--abbrev-ref', 'HEAD'],
+                                      universal_newlines=True)
+    except Exception as e:
+        print('[!] git command error : {}'.format(e))
+        return 'UNKNOWN', 'UNKNOWN'
+    commit, branch = out.split()
+    return commit, branch
+
+def get_host():
+    return '{}-{}'.format(socket.gethostname(), platform.machine())
+
+def load_reports(paths):
+    results = []
+    for path in paths:
+        results += load_report(path)
+    return results
+
+def store(db, args):
+    commit, branch = get_branch_commit()
+    commit = args.commit or commit
+    run_id = db.insert_run(commit, branch, args.host, load_reports(args.reports))
+    print('[+] Stored run {} (commit {} on {})'.format(run_id, commit, args.host))
+    return 0
+
+def list_runs(db, args):
+    for run in db.get_runs(None if args.all_hosts else args.host):
+        date = datetime.datetime.fromtimestamp(run['timestamp'])
+        print('{:>5} {} {:<20} {:<24} {}'.format(run['run_id'], run['commit'],
+              run['branch'], run['host'], date))
+    return 0
+
+def compare(db, args):
+    baseline_run = db.find_run(args.baseline, args.host)
+    if baseline_run == None:
+        print('[!] No run of {} on {}'.format(args.baseline, args.host))
+        return 2
+    baseline = {r.key(): r for r in db.get_results(baseline_run['run_id'])}
+
+    if args.commit:
+        new_run = db.find_run(args.commit, args.host)
+        if new_run == None:
+            print('[!] No run of {} on {}'.format(args.commit, args.host))
+            return 2
+        new_results = db.get_results(new_run['run_id'])
+    else:
+        new_results = load_reports(args.reports)
+
+    print('[+] Baseline: run {} (commit {})'.format(baseline_run['run_id'],
+                                                     baseline_run['commit']))
+    regressions = 0
+    for new in new_results:
+        if new.key() not in baseline:
+            print('{:<12} {}'.format('new', new.name()))
+            continue
+        comparison = Comparison(baseline[new.key()], new, args.alpha,
+                                args.threshold)
+        comparison.print()
+        if comparison.status == 'REGRESSION':
+            regressions += 1
+    print('[+] {} regression(s)'.format(regressions))
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Store and compare the results of QBDIBenchmark')
+    parser.add_argument("-d", "--database", type=str, default="benchmark.db", help="Path of the result database")
+    parser.add_argument("--host", type=str, default=get_host(), help="Host of the runs (default: hostname-machine)")
+    subparsers = parser.add_subparsers(dest="action", required=True)
+
+    store_parser = subparsers.add_parser("store", help="Store the reports of a run")
+    store_parser.add_argument("--commit", type=str, default=None, help="Commit of the run (default: git HEAD)")
+    store_parser.add_argument("reports", type=str, nargs='+', help="JSON reports or Catch2 XML output")
+
+    list_parser = subparsers.add_parser("list", help="List the stored runs")
+    list_parser.add_argument("--all-hosts", action="store_true", help="List the runs of all the hosts")
+
+    compare_parser = subparsers.add_parser("compare", help="Compare a run against a baseline")
+    compare_parser.add_argument("-b", "--baseline", type=str, required=True, help="Commit of the baseline run")
+    compare_parser.add_argument("--commit", type=str, default=None, help="Compare a stored run instead of reports")
+    compare_parser.add_argument("--alpha", type=float, default=0.05, help="Significance level")
+    compare_parser.add_argument("--threshold", type=float, default=1.0, help="Minimal change to report, in percent")
+    compare_parser.add_argument("reports", type=str, nargs='*', help="JSON reports or Catch2 XML output")
+
+    args = parser.parse_args()
+    if args.action == 'compare' and not args.commit and not args.reports:
+        parser.error('compare needs reports or --commit')
+
+    db = SQLiteDBAdapter(args.database)
+    actions = {'store': store, 'list': list_runs, 'compare': compare}
+    sys.exit(actions[args.action](db, args))
@@ -0,0 +1,88 @@
+# This file is part of QBDI.
+#
+# Copyright 2017 - 2024 Quarkslab
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+import os
+import json
+import xml.etree.ElementTree as ET
+
+# Units where a higher value is better. For the other units (ns, ns/event, ms,
+# x native), a lower value is better.
+HIGHER_IS_BETTER = ('inst/s',)
+
+class BenchmarkResult:
+    def __init__(self, report, arch, sample, stage, config, unit, value,
+                 samples=None, lower=None, upper=None, events=0):
+        self.report = report
+        self.arch = arch
+        self.sample = sample
+        self.stage = stage
+        self.config = config
+        self.unit = unit
+        self.value = value
+        # value of each round (QBDIBenchmark JSON reports)
+        self.samples = samples if samples != None else []
+        # confidence interval of the mean (Catch2 XML reports)
+        self.lower = lower
+        self.upper = upper
+        self.events = events
+
+    def key(self):
+        return (self.report, self.sample, self.stage, self.config)
+
+    def name(self):
+        name = '{}: {} / {}'.format(self.report, self.sample, self.stage)
+        if self.config:
+            name += ' [{}]'.format(self.config)
+        return name
+
+    def higher_is_better(self):
+        return self.unit in HIGHER_IS_BETTER
+
+
+def load_json_report(path):
+    # Report written by writeBenchmarkReport (test/Benchmark/BenchmarkReport.h)
+    with open(path, 'r') as f:
+        data = json.load(f)
+    report = os.path.splitext(os.path.basename(path))[0]
+    return [BenchmarkResult(report, data['arch'], r['sample'], r['stage'],
+                            r['config'], r['unit'], r['value'],
+                            samples=r.get('samples', []), events=r['events'])
+            for r in data['results']]
+
+
+def load_catch2_report(path):
+    # Output of "QBDIBenchmark -r xml": the mean and its confidence interval
+    # of each BENCHMARK, in nanoseconds
+    results = []
+    root = ET.parse(path).getroot()
+    for testcase in root.iter('TestCase'):
+        for bench in testcase.iter('BenchmarkResults'):
+            mean = bench.find('mean')
+            if mean == None:
+                continue
+            results.append(BenchmarkResult('catch2', 'UNKNOWN',
+                                           testcase.get('name'),
+                                           bench.get('name'), '', 'ns',
+                                           float(mean.get('value')),
+                                           lower=float(mean.get('lowerBound')),
+                                           upper=float(mean.get('upperBound'))))
+    return results
+
+
+def load_report(path):
+    if path.endswith('.xml'):
+        return load_catch2_report(path)
+    return load_json_report(path)
@@ -0,0 +1,105 @@
+# This file is part of QBDI.
+#
+# Copyright 2017 - 2024 Quarkslab
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+import math
+import statistics
+from functools import lru_cache
+
+# Above this number of samples, the normal approximation is used instead of
+# the exact distribution of U
+EXACT_LIMIT = 50
+
+@lru_cache(maxsize=None)
+def u_count(u, m, n):
+    # Number of orderings of m and n samples (without ties) with a U statistic
+    # of u
+    if u < 0 or u > m * n:
+        return 0
+    if m == 0 or n == 0:
+        return 1 if u == 0 else 0
+    return u_count(u - n, m - 1, n) + u_count(u, m, n - 1)
+
+def mann_whitney(a, b):
+    # Two-sided p-value of the Mann-Whitney U test
+    m, n = len(a), len(b)
+    values = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    # rank with the average rank of the ties
+    ranks = [0.0] * len(values)
+    ties = []
+    i = 0
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        ties.append(j - i + 1)
+        i = j + 1
+    rank_a = sum(r for r, (_, src) in zip(ranks, values) if src == 0)
+    u = rank_a - m * (m + 1) / 2
+    u = min(u, m * n - u)
+
+    if m + n <= EXACT_LIMIT and all(t == 1 for t in ties):
+        total = math.comb(m + n, m)
+        tail = sum(u_count(k, m, n) for k in range(int(u) + 1))
+        return min(1.0, 2 * tail / total)
+
+    mean = m * n / 2
+    tie_term = sum(t ** 3 - t for t in ties) / ((m + n) * (m + n - 1))
+    sigma = math.sqrt(m * n / 12 * ((m + n + 1) - tie_term))
+    if sigma == 0:
+        return 1.0
+    z = (abs(u - mean) - 0.5) / sigma
+    return min(1.0, math.erfc(max(z, 0) / math.sqrt(2)))
+
+class Comparison:
+    def __init__(self, baseline, new, alpha, threshold):
+        self.baseline = baseline
+        self.new = new
+        self.pvalue = None
+        if len(baseline.samples) >= 2 and len(new.samples) >= 2:
+            base_value = statistics.median(baseline.samples)
+            new_value = statistics.median(new.samples)
+            self.pvalue = mann_whitney(baseline.samples, new.samples)
+            significant = self.pvalue < alpha
+        elif baseline.lower != None and new.lower != None:
+            # only the confidence intervals of the means are known
+            base_value = baseline.value
+            new_value = new.value
+            significant = new.lower > baseline.upper or \
+                          new.upper < baseline.lower
+        else:
+            base_value = baseline.value
+            new_value = new.value
+            significant = False
+
+        # median of the rounds, or mean of the Catch2 benchmark
+        self.base_value = base_value
+        self.new_value = new_value
+        self.change = (new_value / base_value - 1) * 100 if base_value else 0
+        worse = (self.change < 0) if new.higher_is_better() else (self.change > 0)
+        if not significant or abs(self.change) < threshold:
+            self.status = 'same'
+        elif worse:
+            self.status = 'REGRESSION'
+        else:
+            self.status = 'improvement'
+
+    def print(self):
+        pvalue = '{:.4f}'.format(self.pvalue) if self.pvalue != None else '-'
+        print('{:<12} {:>+8.2f}% p={:<7} {:>14.3f} -> {:<14.3f} {:<9} {}'.format(
+              self.status, self.change, pvalue, self.base_value,
+              self.new_value, self.new.unit, self.new.name()))
@@ -0,0 +1,99 @@
+# This file is part of QBDI.
+#
+# Copyright 2017 - 2024 Quarkslab
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+import json
+import time
+import sqlite3
+
+from BenchmarkResult import BenchmarkResult
+
+class SQLiteDBAdapter:
+    def __init__(self, db_path):
+        self.connection = sqlite3.connect(db_path)
+        self.connection.row_factory = sqlite3.Row
+        self.setup_db()
+
+    def setup_db(self):
+        cursor = self.connection.cursor()
+        cursor.execute('''CREATE TABLE IF NOT EXISTS Runs (
+                            run_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                            "commit" TEXT,
+                            branch TEXT,
+                            host TEXT,
+                            timestamp INTEGER);''')
+        cursor.execute('''CREATE TABLE IF NOT EXISTS Results (
+                            result_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                            run_id INTEGER,
+                            report TEXT,
+                            arch TEXT,
+                            sample TEXT,
+                            stage TEXT,
+                            config TEXT,
+                            unit TEXT,
+                            events INTEGER,
+                            value REAL,
+                            lower REAL,
+                            upper REAL,
+                            samples TEXT);''')
+        cursor.execute('''CREATE INDEX IF NOT EXISTS RunIdx ON Runs
+                            ("commit", host);''')
+        cursor.execute('''CREATE INDEX IF NOT EXISTS ResultIdx ON Results
+                            (run_id);''')
+        self.connection.commit()
+
+    def insert_run(self, commit, branch, host, results):
+        cursor = self.connection.cursor()
+        cursor.execute('''INSERT INTO Runs ("commit", branch, host, timestamp)
+                          VALUES (?, ?, ?, ?)''',
+                       (commit, branch, host, int(time.time())))
+        run_id = cursor.lastrowid
+        for r in results:
+            cursor.execute('''INSERT INTO Results (run_id, report, arch, sample,
+                              stage, config, unit, events, value, lower, upper,
+                              samples) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?,
+                              ?)''',
+                           (run_id, r.report, r.arch, r.sample, r.stage,
+                            r.config, r.unit, r.events, r.value, r.lower,
+                            r.upper, json.dumps(r.samples)))
+        self.connection.commit()
+        return run_id
+
+    def get_runs(self, host=None):
+        cursor = self.connection.cursor()
+        if host == None:
+            cursor.execute('SELECT * FROM Runs ORDER BY run_id')
+        else:
+            cursor.execute('SELECT * FROM Runs WHERE host = ? ORDER BY run_id',
+                           (host,))
+        return cursor.fetchall()
+
+    def find_run(self, commit, host):
+        # The last run of a commit (or of a commit prefix) on the host
+        cursor = self.connection.cursor()
+        cursor.execute('''SELECT * FROM Runs WHERE "commit" LIKE ? AND host = ?
+                          ORDER BY run_id DESC LIMIT 1''',
+                       (commit + '%', host))
+        return cursor.fetchone()
+
+    def get_results(self, run_id):
+        cursor = self.connection.cursor()
+        cursor.execute('SELECT * FROM Results WHERE run_id = ?', (run_id,))
+        return [BenchmarkResult(r['report'], r['arch'], r['sample'],
+                                r['stage'], r['config'], r['unit'], r['value'],
+                                samples=json.loads(r['samples']),
+                                lower=r['lower'], upper=r['upper'],
+                                events=r['events'])
+                for r in cursor.fetchall()]
@@ -276,6 +276,10 @@ var QBDI_C = Object.freeze({
     terminateVM: _qbdibinder.bind('qbdi_terminateVM', 'void', ['pointer']),
     getOptions: _qbdibinder.bind('qbdi_getOptions', rword, ['pointer']),
     setOptions: _qbdibinder.bind('qbdi_setOptions', 'void', ['pointer', rword]),
+    setInstructionBudget: _qbdibinder.bind('qbdi_setInstructionBudget', 'void', ['pointer', 'uint64']),
+    removeInstructionBudget: _qbdibinder.bind('qbdi_removeInstructionBudget', 'void', ['pointer']),
+    isInstructionBudgetEnabled: _qbdibinder.bind('qbdi_isInstructionBudgetEnabled', 'uchar', ['pointer']),
+    getInstructionBudget: _qbdibinder.bind('qbdi_getInstructionBudget', 'uint64', ['pointer']),
     addInstrumentedRange: _qbdibinder.bind('qbdi_addInstrumentedRange', 'void', ['pointer', rword, rword]),
     addInstrumentedModule: _qbdibinder.bind('qbdi_addInstrumentedModule', 'uchar', ['pointer', 'pointer']),
     addInstrumentedModuleFromAddr: _qbdibinder.bind('qbdi_addInstrumentedModuleFromAddr', 'uchar', ['pointer', rword]),
@@ -531,7 +535,11 @@ export var VMEvent = Object.freeze({
     /**
      * Not implemented.
      */
-    SIGNAL: 1 << 9
+    SIGNAL: 1 << 9,
+    /**
+     * Triggered when the instruction budget doesn't cover the next sequence.
+     */
+    BUDGET_EXHAUSTED: 1 << 10
 });
 
 /**
@@ -795,6 +803,17 @@ export var Options = {
      * execblock doesn't used FPR.
      */
     OPT_DISABLE_OPTIONAL_FPR: 1 << 1,
+    /**
+     * Use a liveness analysis to let the instrumentation use dead registers
+     * without backup. The value of a dead register in the GPRState may be
+     * wrong in VMEvent callback.
+     */
+    OPT_ENABLE_REG_LIVENESS: 1 << 2,
+    /**
+     * Merge the contiguous accesses of the same type in getBBMemoryAccess.
+     * The value of a merged access is unknown.
+     */
+    OPT_MERGE_MEMORY_ACCESS: 1 << 3,
 };
 if (Process.arch === 'x64') {
     /**
@@ -807,8 +826,14 @@ if (Process.arch === 'x64') {
      * supported by the operating system.
      */
     Options.OPT_ENABLE_FS_GS = 1 << 25;
+    /**
+     * Record the value of the memory accesses up to 64 bytes.
+     * The accesses larger than a rword are split in rword.
+     */
+    Options.OPT_RECORD_LARGE_MEMORY_VALUE = 1 << 26;
 } else if (Process.arch === 'ia32') {
     Options.OPT_ATT_SYNTAX = 1 << 24;
+    Options.OPT_RECORD_LARGE_MEMORY_VALUE = 1 << 26;
 } else if (Process.arch === 'arm64') {
     /**
      * Disable the emulation of the local monitor by QBDI
@@ -845,6 +870,43 @@ if (Process.arch === 'x64') {
 
 Options = Object.freeze(Options);
 
+/**
+ * Type of the records of an :js:class:`EventBatch`
+ *
+ * @enum {number}
+ * @readonly
+ */
+export var BatchRecordType = Object.freeze({
+    /**
+     * The entry of a basic block (address: start of the basic block, instAddress: end of the basic block).
+     */
+    BATCH_RECORD_BB: 1,
+    /**
+     * An executed instruction (address and instAddress: address of the instruction).
+     */
+    BATCH_RECORD_INST: 1 << 1,
+    /**
+     * A memory access (address: address of the access, instAddress: address of the instruction).
+     */
+    BATCH_RECORD_MEMORY: 1 << 2
+});
+
+/**
+ * Offsets (in bytes) of the fields of an :js:class:`EventBatch` record and size of a record.
+ * The type is a uint32, accessType and size are uint16 and the other fields are rword.
+ *
+ * @readonly
+ */
+export var BatchRecordLayout = Object.freeze({
+    type: 0,
+    accessType: 4,
+    size: 6,
+    address: 8,
+    instAddress: 8 + Process.pointerSize,
+    value: 8 + 2 * Process.pointerSize,
+    recordSize: 8 + 3 * Process.pointerSize
+});
+
 export class InstrRuleDataCBK {
     /**
      * Object to define an :js:func:`InstCallback` in an :js:func:`InstrRuleCallback`
@@ -1137,6 +1199,43 @@ export class VM {
         QBDI_C.setOptions(this.#vm, options);
     }
 
+    /**
+     * Set the number of instructions that the next runs can execute. The budget is checked at the entry
+     * of each sequence: when it doesn't cover the next sequence, a BUDGET_EXHAUSTED event is triggered and
+     * the execution stops, unless the callback increases the budget. The whole size of a sequence is
+     * charged, even when the execution enters it after its first instruction or leaves it before its end.
+     *
+     * @param  {Number|UInt64}  budget  The number of instructions. A budget of 0 stops the execution at the next sequence.
+     */
+    setInstructionBudget(budget) {
+        QBDI_C.setInstructionBudget(this.#vm, budget);
+    }
+
+    /**
+     * Remove the instruction budget. The next runs aren't limited.
+     */
+    removeInstructionBudget() {
+        QBDI_C.removeInstructionBudget(this.#vm);
+    }
+
+    /**
+     * Check if an instruction budget limits the runs
+     *
+     * @return  {bool}  True if a budget was set and wasn't removed since.
+     */
+    isInstructionBudgetEnabled() {
+        return QBDI_C.isInstructionBudgetEnabled(this.#vm) == true;
+    }
+
+    /**
+     * Get the remaining instruction budget
+     *
+     * @return  {UInt64}  The number of instructions left (0 without budget, see isInstructionBudgetEnabled).
+     */
+    getInstructionBudget() {
+        return QBDI_C.getInstructionBudget(this.#vm);
+    }
+
     /**
      * Add an address range to the set of instrumented address ranges.
      *
@@ -1775,6 +1874,45 @@ export class VM {
         return new NativeCallback(jcbk, 'int', ['pointer', 'pointer', 'pointer', 'pointer', 'pointer']);
     }
 
+    /**
+     * This callback is displayed as part of the Requester class.
+     * @callback EventBatchCallbackRaw
+     * @param {VM} vm
+     * @param {ArrayBuffer} records
+     * @param {Number} count
+     * @param {*} data
+     */
+
+    /**
+     * Create an :js:class:`EventBatch` that records the events of the VM in a native buffer
+     * and gives them to a JS function by batch.
+     *
+     * Example:
+     *       >>> var batch = vm.newEventBatch(4096, function(vm, records, count, data) {
+     *       >>>   var view = new DataView(records);
+     *       >>>   for (var i = 0; i < count; i++) {
+     *       >>>     var r = i * BatchRecordLayout.recordSize;
+     *       >>>     if (view.getUint32(r + BatchRecordLayout.type, true) == BatchRecordType.BATCH_RECORD_BB) {
+     *       >>>       data.bb++;
+     *       >>>     }
+     *       >>>   }
+     *       >>>   return VMAction.CONTINUE;
+     *       >>> }, {bb: 0});
+     *       >>> batch.attach(BatchRecordType.BATCH_RECORD_BB);
+     *
+     * @param {Number}                capacity  Number of records of a batch.
+     * @param {EventBatchCallbackRaw} cbk       a batch callback (ex: function(vm, records, count, data) {};)
+     * @param {Object|null}           data      User defined data passed to the callback.
+     *
+     * @return {EventBatch} a new EventBatch
+     */
+    newEventBatch(capacity, cbk, data) {
+        if (typeof (cbk) !== 'function' || cbk.length !== 4 || !(capacity > 0)) {
+            return undefined;
+        }
+        return new EventBatch(this, capacity, cbk, data, this.#memoryAccessDesc, this.#vmStateStructDesc);
+    }
+
     /**
      * Call a function by its address (or through a Frida ``NativePointer``).
      *
@@ -2207,3 +2345,151 @@ export class VM {
 
 };
 
+export class EventBatch {
+    /**
+     * Record the events of a VM in a native buffer and give them to a JS callback by
+     * batch. The records are written by a ``CModule``: the events don't call JS until
+     * the buffer is full. Use :js:func:`VM.newEventBatch` to create a batch.
+     *
+     * The callback receives an ``ArrayBuffer`` on the native records (see
+     * :js:data:`BatchRecordLayout`). The records are only valid during the callback.
+     */
+    constructor(vm, capacity, cbk, data, memoryAccessDesc, vmStateStructDesc) {
+        var recordSize = BatchRecordLayout.recordSize;
+        this.vm = vm;
+        this.capacity = capacity;
+        this.records = Memory.alloc(capacity * recordSize);
+        // struct { BatchRecord *records; guint32 capacity; guint32 count; guint32 memoryType; }
+        this.header = Memory.alloc(Process.pointerSize + 12);
+        this.header.writePointer(this.records);
+        this.header.add(Process.pointerSize).writeU32(capacity);
+        this.countPtr = this.header.add(Process.pointerSize + 4);
+        this.countPtr.writeU32(0);
+        this.memoryTypePtr = this.header.add(Process.pointerSize + 8);
+        this.memoryTypePtr.writeU32(MemoryAccessType.MEMORY_READ_WRITE);
+
+        var that = this;
+        this.onBatch = new NativeCallback(function (vmPtr) {
+            return that._deliver();
+        }, 'int', ['pointer']);
+        this.cbk = cbk;
+        this.data = data;
+
+        var source = [
+            '#include <glib.h>',
+            '#define BB_START_OFFSET ' + vmStateStructDesc.offsets[3],
+            '#define BB_END_OFFSET ' + vmStateStructDesc.offsets[4],
+            '#define MA_SIZE ' + memoryAccessDesc.size,
+            '#define MA_INST_OFFSET ' + memoryAccessDesc.offsets[0],
+            '#define MA_ADDR_OFFSET ' + memoryAccessDesc.offsets[1],
+            '#define MA_VALUE_OFFSET ' + memoryAccessDesc.offsets[2],
+            '#define MA_SIZE_OFFSET ' + memoryAccessDesc.offsets[3],
+            '#define MA_TYPE_OFFSET ' + memoryAccessDesc.offsets[4],
+            '#define REG_PC_ID ' + GPR_NAMES.indexOf(REG_PC),
+            'typedef struct { guint32 type; guint16 accessType; guint16 size;',
+            '  guintptr address; guintptr instAddress; guintptr value; } BatchRecord;',
+            'typedef struct { BatchRecord *records; guint32 capacity; guint32 count;',
+            '  guint32 memoryType; } EventBatch;',
+            'extern void *qbdi_getInstMemoryAccess(void *vm, gsize *size);',
+            'extern guintptr qbdi_getGPR(void *gprState, guint32 rid);',
+            'extern void qbdi_free(void *ptr);',
+            'extern int onBatch(void *vm);',
+            'static BatchRecord *reserve(void *vm, EventBatch *batch, int *action) {',
+            '  if (batch->count == batch->capacity) {',
+            '    int res = onBatch(vm);',
+            '    if (res > *action) *action = res;',
+            '  }',
+            '  return &batch->records[batch->count++];',
+            '}',
+            'int recordBB(void *vm, guint8 *state, void *gpr, void *fpr, EventBatch *batch) {',
+            '  int action = 0;',
+            '  BatchRecord *r = reserve(vm, batch, &action);',
+            '  r->type = 1; r->accessType = 0; r->size = 0; r->value = 0;',
+            '  r->address = *(guintptr *)(state + BB_START_OFFSET);',
+            '  r->instAddress = *(guintptr *)(state + BB_END_OFFSET);',
+            '  return action;',
+            '}',
+            'int recordInst(void *vm, void *gpr, void *fpr, EventBatch *batch) {',
+            '  int action = 0;',
+            '  BatchRecord *r = reserve(vm, batch, &action);',
+            '  r->type = 2; r->accessType = 0; r->size = 0; r->value = 0;',
+            '  r->address = r->instAddress = qbdi_getGPR(gpr, REG_PC_ID);',
+            '  return action;',
+            '}',
+            'int recordMemory(void *vm, void *gpr, void *fpr, EventBatch *batch) {',
+            '  int action = 0;',
+            '  gsize i, size = 0;',
+            '  guint8 *accesses = qbdi_getInstMemoryAccess(vm, &size);',
+            '  for (i = 0; i < size; i++) {',
+            '    guint8 *a = accesses + i * MA_SIZE;',
+            '    guint8 type = *(guint8 *)(a + MA_TYPE_OFFSET);',
+            '    BatchRecord *r;',
+            '    // the accesses of the other type of the instruction are also returned',
+            '    if ((type & batch->memoryType) == 0) continue;',
+            '    r = reserve(vm, batch, &action);',
+            '    r->type = 4;',
+            '    r->accessType = type;',
+            '    r->size = *(guint16 *)(a + MA_SIZE_OFFSET);',
+            '    r->address = *(guintptr *)(a + MA_ADDR_OFFSET);',
+            '    r->instAddress = *(guintptr *)(a + MA_INST_OFFSET);',
+            '    r->value = *(guintptr *)(a + MA_VALUE_OFFSET);',
+            '  }',
+            '  if (accesses != NULL) qbdi_free(accesses);',
+            '  return action;',
+            '}'
+        ].join('\n');
+        this.cmodule = new CModule(source, {
+            qbdi_getInstMemoryAccess: Module.findExportByName(_qbdibinder.QBDI_LIB, 'qbdi_getInstMemoryAccess'),
+            qbdi_getGPR: Module.findExportByName(_qbdibinder.QBDI_LIB, 'qbdi_getGPR'),
+            qbdi_free: Module.findExportByName(null, 'free'),
+            onBatch: this.onBatch
+        });
+    }
+
+    // Give the pending records to the callback and empty the batch.
+    _deliver() {
+        var count = this.countPtr.readU32();
+        if (count === 0) {
+            return VMAction.CONTINUE;
+        }
+        var records = ArrayBuffer.wrap(this.records, count * BatchRecordLayout.recordSize);
+        var res = this.cbk(this.vm, records, count, this.data);
+        this.countPtr.writeU32(0);
+        return res;
+    }
+
+    /**
+     * Register the callbacks that record the selected events in the VM. The batch must stay
+     * alive while its callbacks are registered.
+     *
+     * @param {BatchRecordType}  types        A bitfield of the events to record.
+     * @param {MemoryAccessType} [memoryType] The memory accesses to record (default to MEMORY_READ_WRITE).
+     *
+     * @return {Number[]} The ids of the registered instrumentations.
+     */
+    attach(types, memoryType) {
+        memoryType = memoryType || MemoryAccessType.MEMORY_READ_WRITE;
+        var vm = this.vm.ptr;
+        var ids = [];
+        if (types & BatchRecordType.BATCH_RECORD_BB) {
+            ids.push(QBDI_C.addVMEventCB(vm, VMEvent.BASIC_BLOCK_ENTRY, this.cmodule.recordBB, this.header));
+        }
+        if (types & BatchRecordType.BATCH_RECORD_INST) {
+            ids.push(QBDI_C.addCodeCB(vm, InstPosition.PREINST, this.cmodule.recordInst, this.header,
+                CallbackPriority.PRIORITY_DEFAULT));
+        }
+        if (types & BatchRecordType.BATCH_RECORD_MEMORY) {
+            this.memoryTypePtr.writeU32(memoryType);
+            ids.push(QBDI_C.addMemAccessCB(vm, memoryType, this.cmodule.recordMemory, this.header,
+                CallbackPriority.PRIORITY_DEFAULT));
+        }
+        return ids;
+    }
+
+    /**
+     * Give the records that aren't delivered yet to the callback. Must be called after the run of the VM.
+     */
+    flush() {
+        this._deliver();
+    }
+}
@@ -86,6 +86,9 @@ void init_binding_Callback(py::module_ &m) {
       .value(
           "EXEC_TRANSFER_RETURN", VMEvent::EXEC_TRANSFER_RETURN,
           "Triggered when the ExecBroker returns from an execution transfer.")
+      .value("BUDGET_EXHAUSTED", VMEvent::BUDGET_EXHAUSTED,
+             "Triggered when the instruction budget doesn't cover the next "
+             "sequence.")
       .export_values()
       .def_invert()
       .def_repr_str();
@@ -0,0 +1,270 @@
+/*
+ * This file is part of pyQBDI (python binding for QBDI).
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "Enum.hpp"
+#include "pyqbdi.hpp"
+
+namespace QBDI {
+namespace pyQBDI {
+
+namespace {
+
+enum BatchRecordType : uint32_t {
+  BATCH_RECORD_BB = 1,
+  BATCH_RECORD_INST = 1 << 1,
+  BATCH_RECORD_MEMORY = 1 << 2,
+};
+
+// A record of the batch. The layout is exported through the buffer protocol
+// and must stay without padding.
+struct BatchRecord {
+  uint32_t type;
+  // MemoryAccessType of a BATCH_RECORD_MEMORY
+  uint16_t accessType;
+  // size of the access of a BATCH_RECORD_MEMORY
+  uint16_t size;
+  // start of the basic block, address of the instruction or of the access
+  rword address;
+  // end of the basic block or address of the instruction
+  rword instAddress;
+  // value of the access of a BATCH_RECORD_MEMORY
+  rword value;
+};
+
+static_assert(sizeof(BatchRecord) == 8 + 3 * sizeof(rword),
+              "BatchRecord must not have any padding");
+
+// Record the events in a preallocated buffer and give them to python by
+// batch. The python callback is the only part of the instrumentation that
+// acquires python objects.
+class EventBatch {
+  std::vector<BatchRecord> records;
+  size_t count;
+  py::function cbk;
+  py::object data;
+  // the VM of the batch, used by flush. Cleared when the VM is destroyed.
+  VMInstanceRef attachedVM;
+  py::weakref attachedVMRef;
+  std::vector<uint32_t> instrumentIDs;
+  // the memory accesses to record
+  MemoryAccessType memoryType;
+
+  BatchRecord *reserve(VMInstanceRef vm, VMAction *action) {
+    if (count == records.size()) {
+      *action = deliver(py::cast(vm, py::return_value_policy::reference));
+    }
+    return &records[count++];
+  }
+
+  // vm is None when the batch isn't attached to a VM anymore
+  VMAction deliver(const py::object &vm) {
+    if (count == 0) {
+      return VMAction::CONTINUE;
+    }
+    VMAction res;
+    try {
+      res = cbk(vm, py::cast(this, py::return_value_policy::reference), data)
+                .cast<VMAction>();
+    } catch (const std::exception &e) {
+      std::cerr << "Error during EventBatch callback : " << e.what()
+                << std::endl;
+      exit(1);
+    }
+    count = 0;
+    return res;
+  }
+
+  static VMAction recordBB(VMInstanceRef vm, const VMState *vmState,
+                           GPRState *, FPRState *, void *data) {
+    EventBatch *batch = static_cast<EventBatch *>(data);
+    VMAction action = VMAction::CONTINUE;
+    BatchRecord *r = batch->reserve(vm, &action);
+    *r = {BATCH_RECORD_BB, 0, 0, vmState->basicBlockStart,
+          vmState->basicBlockEnd, 0};
+    return action;
+  }
+
+  static VMAction recordInst(VMInstanceRef vm, GPRState *gprState, FPRState *,
+                             void *data) {
+    EventBatch *batch = static_cast<EventBatch *>(data);
+    VMAction action = VMAction::CONTINUE;
+    BatchRecord *r = batch->reserve(vm, &action);
+    rword pc = QBDI_GPR_GET(gprState, REG_PC);
+    *r = {BATCH_RECORD_INST, 0, 0, pc, pc, 0};
+    return action;
+  }
+
+  static VMAction recordMemory(VMInstanceRef vm, GPRState *, FPRState *,
+                               void *data) {
+    EventBatch *batch = static_cast<EventBatch *>(data);
+    VMAction action = VMAction::CONTINUE;
+    for (const MemoryAccess &acc : vm->getInstMemoryAccess()) {
+      // the accesses of the other type of the instruction are also returned
+      if ((acc.type & batch->memoryType) == 0) {
+        continue;
+      }
+      VMAction res = VMAction::CONTINUE;
+      BatchRecord *r = batch->reserve(vm, &res);
+      *r = {BATCH_RECORD_MEMORY,
+            static_cast<uint16_t>(acc.type),
+            acc.size,
+            acc.accessAddress,
+            acc.instAddress,
+            acc.value};
+      action = std::max(action, res);
+    }
+    return action;
+  }
+
+public:
+  EventBatch(size_t capacity, const py::function &cbk, const py::object &data)
+      : records(capacity), count(0), cbk(cbk), data(data),
+        attachedVM(nullptr), memoryType(MemoryAccessType::MEMORY_READ_WRITE) {
+    if (capacity == 0) {
+      throw std::invalid_argument("The capacity of an EventBatch cannot be 0");
+    }
+  }
+
+  size_t size() const { return count; }
+
+  size_t capacity() const { return records.size(); }
+
+  std::vector<uint32_t> attach(const py::object &vmObj, BatchRecordType types,
+                               MemoryAccessType memoryType) {
+    if (attachedVM != nullptr) {
+      throw std::runtime_error("The EventBatch is already attached to a VM");
+    }
+    VMInstanceRef vm = vmObj.cast<VMInstanceRef>();
+    // The VM keeps the batch alive (keep_alive), but the batch may outlive
+    // the VM.
+    attachedVMRef = py::weakref(vmObj, py::cpp_function([this](py::handle) {
+                                  attachedVM = nullptr;
+                                  instrumentIDs.clear();
+                                  deliver(py::none());
+                                }));
+    attachedVM = vm;
+    this->memoryType = memoryType;
+    if ((types & BATCH_RECORD_BB) != 0) {
+      instrumentIDs.push_back(
+          vm->addVMEventCB(VMEvent::BASIC_BLOCK_ENTRY, recordBB, this));
+    }
+    if ((types & BATCH_RECORD_INST) != 0) {
+      instrumentIDs.push_back(
+          vm->addCodeCB(InstPosition::PREINST, recordInst, this));
+    }
+    if ((types & BATCH_RECORD_MEMORY) != 0) {
+      instrumentIDs.push_back(
+          vm->addMemAccessCB(memoryType, recordMemory, this));
+    }
+    return instrumentIDs;
+  }
+
+  void detach() {
+    if (attachedVM == nullptr) {
+      return;
+    }
+    for (uint32_t id : instrumentIDs) {
+      attachedVM->deleteInstrumentation(id);
+    }
+    instrumentIDs.clear();
+    // the pending records belong to this VM
+    deliver(py::cast(attachedVM, py::return_value_policy::reference));
+    attachedVM = nullptr;
+    attachedVMRef = py::weakref();
+  }
+
+  void flush() {
+    if (attachedVM != nullptr) {
+      deliver(py::cast(attachedVM, py::return_value_policy::reference));
+    } else {
+      deliver(py::none());
+    }
+  }
+
+  py::buffer_info getBuffer() {
+    static const std::string format =
+        std::string("T{I:type:H:accessType:H:size:") +
+        py::format_descriptor<rword>::format() + ":address:" +
+        py::format_descriptor<rword>::format() + ":instAddress:" +
+        py::format_descriptor<rword>::format() + ":value:}";
+
+    py::ssize_t itemsize = sizeof(BatchRecord);
+    return py::buffer_info(records.data(), itemsize, format, 1,
+                           {static_cast<py::ssize_t>(count)}, {itemsize},
+                           true);
+  }
+};
+
+} // namespace
+
+void init_binding_EventBatch(py::module_ &m) {
+
+  enum_int_flag_<BatchRecordType>(m, "BatchRecordType",
+                                  "EventBatch record type", py::arithmetic())
+      .value("BATCH_RECORD_BB", BATCH_RECORD_BB,
+             "The entry of a basic block (address: start of the basic "
+             "block, instAddress: end of the basic block)")
+      .value("BATCH_RECORD_INST", BATCH_RECORD_INST,
+             "An executed instruction (address and instAddress: address of "
+             "the instruction)")
+      .value("BATCH_RECORD_MEMORY", BATCH_RECORD_MEMORY,
+             "A memory access (address: address of the access, instAddress: "
+             "address of the instruction)")
+      .export_values()
+      .def_invert()
+      .def_repr_str();
+
+  py::class_<EventBatch>(m, "EventBatch", py::buffer_protocol(),
+                         "Record the events of the VM in a preallocated "
+                         "buffer and give them to a callback by batch.\n"
+                         "The batch exports its records through the buffer "
+                         "protocol (``numpy.asarray(batch)`` gives a "
+                         "structured array without any copy). The records "
+                         "are only valid during the callback.")
+      .def(py::init<size_t, const py::function &, const py::object &>(),
+           "Create a batch of capacity records. cbk(vm, batch, data) is "
+           "called with each full batch and must return a VMAction.",
+           "capacity"_a, "cbk"_a, "data"_a = py::none())
+      .def_buffer(&EventBatch::getBuffer)
+      .def("__len__", &EventBatch::size)
+      .def_property_readonly("capacity", &EventBatch::capacity,
+                             "Number of records of a full batch")
+      .def("attach", &EventBatch::attach,
+           "Register the callbacks that record the selected events (a "
+           "BatchRecordType bitfield) in the VM. Return the ID of the "
+           "instrumentations. A batch can only be attached to one VM at a "
+           "time.",
+           "vm"_a, "types"_a,
+           "memoryType"_a = MemoryAccessType::MEMORY_READ_WRITE,
+           py::keep_alive<2, 1>())
+      .def("detach", &EventBatch::detach,
+           "Remove the callbacks of the batch from its VM, and give the "
+           "records that aren't delivered yet to the callback. The records "
+           "pending when the VM is destroyed are given with None as vm.")
+      .def("flush", &EventBatch::flush,
+           "Give the records that aren't delivered yet to the callback. Must "
+           "be called after the run of the VM. The vm argument of the "
+           "callback is None if the batch isn't attached.");
+}
+
+} // namespace pyQBDI
+} // namespace QBDI
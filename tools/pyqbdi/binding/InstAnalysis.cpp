@@ -16,6 +16,10 @@
  * limitations under the License.
  */
 
+#include <list>
+#include <unordered_map>
+#include <utility>
+
 #include "Enum.hpp"
 #include "pyqbdi.hpp"
 
@@ -43,6 +47,155 @@ py::object get_InstAnalysis_member(const InstAnalysis &obj,
   }
 }
 
+// The python objects of the InstAnalysis given by the VMs. Each wrapper owns a
+// copy of the analysis and memoizes the python objects of its strings and
+// operands. The wrappers of a VM are dropped when its cache generation changes
+// (the analyses may have been freed and their address reused). A wrapper is
+// also replaced when a new analysis type adds some fields to an analysis. When
+// too many wrappers are kept, the least recently used one is dropped.
+namespace {
+
+enum MemoField {
+  MEMO_MNEMONIC,
+  MEMO_DISASSEMBLY,
+  MEMO_OPERANDS,
+  MEMO_SYMBOL,
+  MEMO_MODULE,
+  MEMO_COUNT,
+};
+
+// The VM and the analysis source of a wrapper
+using CacheKey = std::pair<const VM *, const InstAnalysis *>;
+
+struct CachedInstAnalysis {
+  py::object wrapper;
+  const InstAnalysis *copy;
+  py::object fields[MEMO_COUNT];
+  std::list<CacheKey>::iterator lruPos;
+};
+
+struct InstAnalysisCache {
+  uint64_t generation = 0;
+  std::unordered_map<const InstAnalysis *, CachedInstAnalysis> bySource;
+};
+
+// Maximal number of wrappers kept for all the VMs
+constexpr size_t MAX_CACHED_INST_ANALYSIS = 1 << 16;
+
+} // namespace
+
+static std::unordered_map<const VM *, InstAnalysisCache> cacheByVM;
+static std::unordered_map<const InstAnalysis *, CachedInstAnalysis *>
+    cacheByCopy;
+// The wrappers of all the VMs, from the most to the least recently used. The
+// wrappers of a deleted VM are dropped when they are the least recently used.
+static std::list<CacheKey> cacheLRU;
+
+static void eraseEntry(
+    InstAnalysisCache &cache,
+    std::unordered_map<const InstAnalysis *, CachedInstAnalysis>::iterator it) {
+  cacheByCopy.erase(it->second.copy);
+  cacheLRU.erase(it->second.lruPos);
+  cache.bySource.erase(it);
+}
+
+static void clearCache(InstAnalysisCache &cache) {
+  for (const auto &it : cache.bySource) {
+    cacheByCopy.erase(it.second.copy);
+    cacheLRU.erase(it.second.lruPos);
+  }
+  cache.bySource.clear();
+}
+
+static void evictLeastRecentlyUsed() {
+  const CacheKey key = cacheLRU.back();
+  auto vmIt = cacheByVM.find(key.first);
+  eraseEntry(vmIt->second, vmIt->second.bySource.find(key.second));
+  if (vmIt->second.bySource.empty()) {
+    cacheByVM.erase(vmIt);
+  }
+}
+
+static bool sameAnalysis(const InstAnalysis &a, const InstAnalysis &b) {
+  return a.address == b.address and a.instSize == b.instSize and
+         a.analysisType == b.analysisType and a.mnemonic == b.mnemonic and
+         a.disassembly == b.disassembly and a.operands == b.operands and
+         a.numOperands == b.numOperands and a.symbolName == b.symbolName and
+         a.moduleName == b.moduleName;
+}
+
+py::object castInstAnalysis(const VM &vm, const InstAnalysis *analysis) {
+  if (analysis == nullptr) {
+    return py::none();
+  }
+  // may drop the cache of a VM, before taking a reference on it
+  while (cacheLRU.size() >= MAX_CACHED_INST_ANALYSIS) {
+    evictLeastRecentlyUsed();
+  }
+  InstAnalysisCache &cache = cacheByVM[&vm];
+  // the generation is unique among the VMs: a new VM at the address of a
+  // deleted one doesn't reuse its cache
+  uint64_t generation = vm.getCacheGeneration();
+  if (cache.generation != generation) {
+    clearCache(cache);
+    cache.generation = generation;
+  }
+  auto it = cache.bySource.find(analysis);
+  if (it != cache.bySource.end()) {
+    if (sameAnalysis(*it->second.copy, *analysis)) {
+      cacheLRU.splice(cacheLRU.begin(), cacheLRU, it->second.lruPos);
+      return it->second.wrapper;
+    }
+    eraseEntry(cache, it);
+  }
+  CachedInstAnalysis &entry = cache.bySource[analysis];
+  entry.wrapper = py::cast(*analysis, py::return_value_policy::copy);
+  entry.copy = entry.wrapper.cast<const InstAnalysis *>();
+  entry.lruPos = cacheLRU.emplace(cacheLRU.begin(), &vm, analysis);
+  cacheByCopy[entry.copy] = &entry;
+  return entry.wrapper;
+}
+
+void clearInstAnalysisCache() {
+  cacheByCopy.clear();
+  cacheLRU.clear();
+  cacheByVM.clear();
+}
+
+template <typename F>
+static py::object memoize(const InstAnalysis &obj, MemoField field,
+                          F compute) {
+  auto it = cacheByCopy.find(&obj);
+  if (it == cacheByCopy.end()) {
+    return compute(obj);
+  }
+  py::object &value = it->second->fields[field];
+  if (!value) {
+    value = compute(obj);
+  }
+  return value;
+}
+
+template <class T>
+static py::object memoizeMember(const InstAnalysis &obj, MemoField field,
+                                T InstAnalysis::*member, uint32_t v) {
+  return memoize(obj, field, [member, v](const InstAnalysis &analysis) {
+    return get_InstAnalysis_member(analysis, member, v);
+  });
+}
+
+static py::object getOperands(const InstAnalysis &obj) {
+  if (obj.analysisType & ANALYSIS_OPERANDS) {
+    std::vector<OperandAnalysis *> operandslist;
+    for (int i = 0; i < obj.numOperands; i++) {
+      operandslist.push_back(&(obj.operands[i]));
+    }
+    return py::tuple(py::cast(operandslist));
+  } else {
+    return py::none();
+  }
+}
+
 void init_binding_InstAnalysis(py::module_ &m) {
 
   enum_int_flag_<RegisterAccessType>(
@@ -157,8 +310,8 @@ void init_binding_InstAnalysis(py::module_ &m) {
       .def_property_readonly(
           "mnemonic",
           [](const InstAnalysis &obj) {
-            return get_InstAnalysis_member(obj, &InstAnalysis::mnemonic,
-                                           ANALYSIS_INSTRUCTION);
+            return memoizeMember(obj, MEMO_MNEMONIC, &InstAnalysis::mnemonic,
+                                 ANALYSIS_INSTRUCTION);
           },
           "LLVM mnemonic (if ANALYSIS_INSTRUCTION)")
       .def_property_readonly(
@@ -267,8 +420,9 @@ void init_binding_InstAnalysis(py::module_ &m) {
       .def_property_readonly(
           "disassembly",
           [](const InstAnalysis &obj) {
-            return get_InstAnalysis_member(obj, &InstAnalysis::disassembly,
-                                           ANALYSIS_DISASSEMBLY);
+            return memoizeMember(obj, MEMO_DISASSEMBLY,
+                                 &InstAnalysis::disassembly,
+                                 ANALYSIS_DISASSEMBLY);
           },
           "Instruction disassembly (if ANALYSIS_DISASSEMBLY)")
       // ANALYSIS_OPERANDS
@@ -289,15 +443,7 @@ void init_binding_InstAnalysis(py::module_ &m) {
       .def_property_readonly(
           "operands",
           [](const InstAnalysis &obj) {
-            if (obj.analysisType & ANALYSIS_OPERANDS) {
-              std::vector<OperandAnalysis *> operandslist;
-              for (int i = 0; i < obj.numOperands; i++) {
-                operandslist.push_back(&(obj.operands[i]));
-              }
-              return static_cast<py::object>(py::tuple(py::cast(operandslist)));
-            } else {
-              return static_cast<py::object>(py::none());
-            }
+            return memoize(obj, MEMO_OPERANDS, getOperands);
           },
           "Structure containing analysis results of an operand provided by the "
           "VM (if ANALYSIS_OPERANDS)")
@@ -305,8 +451,8 @@ void init_binding_InstAnalysis(py::module_ &m) {
       .def_property_readonly(
           "symbolName",
           [](const InstAnalysis &obj) {
-            return get_InstAnalysis_member(obj, &InstAnalysis::symbolName,
-                                           ANALYSIS_SYMBOL);
+            return memoizeMember(obj, MEMO_SYMBOL, &InstAnalysis::symbolName,
+                                 ANALYSIS_SYMBOL);
           },
           "Instruction symbol (if ANALYSIS_SYMBOL and found)")
       .def_property_readonly(
@@ -319,23 +465,23 @@ void init_binding_InstAnalysis(py::module_ &m) {
       .def_property_readonly(
           "moduleName",
           [](const InstAnalysis &obj) {
-            return get_InstAnalysis_member(obj, &InstAnalysis::moduleName,
-                                           ANALYSIS_SYMBOL);
+            return memoizeMember(obj, MEMO_MODULE, &InstAnalysis::moduleName,
+                                 ANALYSIS_SYMBOL);
           },
           "Instruction module name (if ANALYSIS_SYMBOL and found)")
       // deprecated Name
       .def_property_readonly(
           "symbol",
           [](const InstAnalysis &obj) {
-            return get_InstAnalysis_member(obj, &InstAnalysis::symbolName,
-                                           ANALYSIS_SYMBOL);
+            return memoizeMember(obj, MEMO_SYMBOL, &InstAnalysis::symbolName,
+                                 ANALYSIS_SYMBOL);
           },
           "Instruction symbol (if ANALYSIS_SYMBOL and found) (deprecated)")
       .def_property_readonly(
           "module",
           [](const InstAnalysis &obj) {
-            return get_InstAnalysis_member(obj, &InstAnalysis::moduleName,
-                                           ANALYSIS_SYMBOL);
+            return memoizeMember(obj, MEMO_MODULE, &InstAnalysis::moduleName,
+                                 ANALYSIS_SYMBOL);
           },
           "Instruction module name (if ANALYSIS_SYMBOL and found) "
           "(deprecated)");
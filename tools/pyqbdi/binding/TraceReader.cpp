@@ -0,0 +1,219 @@
+/*
+ * This file is part of pyQBDI (python binding for QBDI).
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pyqbdi.hpp"
+
+#include "TraceReader.h"
+#include "TraceWriter.h"
+
+namespace QBDI {
+namespace pyQBDI {
+
+namespace {
+
+// Iterate over the records of a trace. The iterator keeps the reader alive
+// (the cursor points inside the mapping of the reader).
+struct TraceIterator {
+  const Trace::TraceReader &reader;
+  Trace::TraceCursor cursor;
+};
+
+} // namespace
+
+void init_binding_TraceReader(py::module_ &m) {
+
+  py::enum_<Trace::TraceRecordType>(m, "TraceRecordType", "Trace record type")
+      .value("TRACE_RECORD_INST", Trace::TRACE_RECORD_INST,
+             "An executed instruction")
+      .value("TRACE_RECORD_MEMORY", Trace::TRACE_RECORD_MEMORY,
+             "A memory access of the previous instruction")
+      .export_values();
+
+  py::enum_<Trace::TraceAccessType>(m, "TraceAccessType",
+                                    "Trace memory access type")
+      .value("TRACE_ACCESS_READ", Trace::TRACE_ACCESS_READ,
+             "Memory read access")
+      .value("TRACE_ACCESS_WRITE", Trace::TRACE_ACCESS_WRITE,
+             "Memory write access")
+      .export_values();
+
+  py::class_<Trace::TraceRecord>(m, "TraceRecord")
+      .def_readonly("type", &Trace::TraceRecord::type, "Type of the record")
+      .def_property_readonly(
+          "accessType",
+          [](const Trace::TraceRecord &r) {
+            return static_cast<Trace::TraceAccessType>(r.accessType);
+          },
+          "Memory access type (TRACE_RECORD_MEMORY only)")
+      .def_readonly("size", &Trace::TraceRecord::size,
+                    "Size of the memory access (TRACE_RECORD_MEMORY only)")
+      .def_readonly("instCount", &Trace::TraceRecord::instCount,
+                    "Index of the instruction (or of the instruction that "
+                    "performs the memory access) in the trace")
+      .def_readonly("address", &Trace::TraceRecord::address,
+                    "Address of the instruction or of the memory access")
+      .def_readonly("value", &Trace::TraceRecord::value,
+                    "Value of the memory access (TRACE_RECORD_MEMORY only)")
+      .def("__repr__", [](const Trace::TraceRecord &r) {
+        std::ostringstream oss;
+        oss << std::hex << std::setfill('0');
+        if (r.type == Trace::TRACE_RECORD_INST) {
+          oss << "<TraceRecord inst #" << std::dec << r.instCount << std::hex
+              << " 0x" << r.address << ">";
+        } else {
+          oss << "<TraceRecord memory 0x" << r.address << " size " << std::dec
+              << r.size << " value 0x" << std::hex << r.value << ">";
+        }
+        return oss.str();
+      });
+
+  py::class_<Trace::TraceIndexEntry>(m, "TraceIndexEntry")
+      .def_readonly("offset", &Trace::TraceIndexEntry::offset,
+                    "File offset of the first record of the interval")
+      .def_readonly("recordIndex", &Trace::TraceIndexEntry::recordIndex,
+                    "Number of records before the entry")
+      .def_readonly("instCount", &Trace::TraceIndexEntry::instCount,
+                    "Number of instructions before the entry")
+      .def_readonly("pcMin", &Trace::TraceIndexEntry::pcMin,
+                    "Lowest address executed in the interval")
+      .def_readonly("pcMax", &Trace::TraceIndexEntry::pcMax,
+                    "Highest address executed in the interval");
+
+  py::class_<Trace::TraceCursor>(m, "TraceCursor")
+      .def_readonly("recordIndex", &Trace::TraceCursor::recordIndex,
+                    "Index of the next record")
+      .def_readonly("instCount", &Trace::TraceCursor::instCount,
+                    "Number of instructions before the next record")
+      .def("atEnd", &Trace::TraceCursor::atEnd,
+           "Return True if no more records can be decoded")
+      .def("__copy__",
+           [](const Trace::TraceCursor &c) -> Trace::TraceCursor { return c; });
+
+  py::class_<TraceIterator>(m, "_TraceIterator")
+      .def("__iter__", [](TraceIterator &it) -> TraceIterator & { return it; })
+      .def("__next__", [](TraceIterator &it) {
+        Trace::TraceRecord record;
+        if (!it.reader.next(it.cursor, record)) {
+          throw py::stop_iteration();
+        }
+        return record;
+      });
+
+  py::class_<Trace::TraceReader>(m, "TraceReader")
+      .def(py::init([](const std::string &path, uint32_t indexInterval) {
+             std::unique_ptr<Trace::TraceReader> reader(
+                 new Trace::TraceReader());
+             if (!reader->open(path, indexInterval)) {
+               throw std::runtime_error("Cannot open trace " + path);
+             }
+             return reader;
+           }),
+           "Map a trace in memory and load (or rebuild) its seek index.",
+           "path"_a, "indexInterval"_a = 0)
+      .def_property_readonly("recordCount",
+                             &Trace::TraceReader::getRecordCount,
+                             "Number of records of the trace")
+      .def_property_readonly("instCount", &Trace::TraceReader::getInstCount,
+                             "Number of instructions of the trace")
+      .def_property_readonly("indexInterval",
+                             &Trace::TraceReader::getIndexInterval,
+                             "Number of records between two index entries")
+      .def_property_readonly("index", &Trace::TraceReader::getIndex,
+                             "Seek index of the trace")
+      .def("begin", &Trace::TraceReader::begin,
+           "Return a cursor on the first record.", py::keep_alive<0, 1>())
+      .def(
+          "next",
+          [](const Trace::TraceReader &reader, Trace::TraceCursor &cursor) {
+            Trace::TraceRecord record;
+            if (!reader.next(cursor, record)) {
+              return static_cast<py::object>(py::none());
+            }
+            return static_cast<py::object>(py::cast(record));
+          },
+          "Decode the record at the cursor and move the cursor after it.\n"
+          "Return None at the end of the trace.",
+          "cursor"_a)
+      .def(
+          "read",
+          [](const Trace::TraceReader &reader, Trace::TraceCursor &cursor,
+             size_t count) {
+            std::vector<Trace::TraceRecord> records(count);
+            records.resize(reader.read(cursor, records.data(), count));
+            return records;
+          },
+          "Decode up to count records from the cursor.", "cursor"_a,
+          "count"_a)
+      .def(
+          "seekToInstCount",
+          [](const Trace::TraceReader &reader, uint64_t instCount) {
+            Trace::TraceCursor cursor;
+            if (!reader.seekToInstCount(instCount, cursor)) {
+              return static_cast<py::object>(py::none());
+            }
+            return static_cast<py::object>(py::cast(cursor));
+          },
+          "Return a cursor on the instruction with the given index, or None "
+          "if the trace is shorter.",
+          "instCount"_a, py::keep_alive<0, 1>())
+      .def(
+          "seekToPC",
+          [](const Trace::TraceReader &reader, uint64_t pc,
+             py::object start) {
+            Trace::TraceCursor cursor = start.is_none()
+                                            ? reader.begin()
+                                            : start.cast<Trace::TraceCursor>();
+            if (!reader.seekToPC(pc, cursor)) {
+              return static_cast<py::object>(py::none());
+            }
+            return static_cast<py::object>(py::cast(cursor));
+          },
+          "Return a cursor on the next execution of an address after the "
+          "start cursor (the beginning of the trace by default), or None if "
+          "the address isn't executed.",
+          "pc"_a, "start"_a = py::none(), py::keep_alive<0, 1>())
+      .def(
+          "__iter__",
+          [](const Trace::TraceReader &reader) {
+            return TraceIterator{reader, reader.begin()};
+          },
+          py::keep_alive<0, 1>());
+
+  py::class_<Trace::TraceWriter>(m, "TraceWriter")
+      .def(py::init([](const std::string &path, uint32_t indexInterval) {
+             std::unique_ptr<Trace::TraceWriter> writer(
+                 new Trace::TraceWriter());
+             if (!writer->open(path, indexInterval)) {
+               throw std::runtime_error("Cannot create trace " + path);
+             }
+             return writer;
+           }),
+           "Create a new trace.", "path"_a,
+           "indexInterval"_a = Trace::TRACE_DEFAULT_INDEX_INTERVAL)
+      .def("writeInst", &Trace::TraceWriter::writeInst,
+           "Append an executed instruction.", "pc"_a)
+      .def("writeMemoryAccess", &Trace::TraceWriter::writeMemoryAccess,
+           "Append a memory access of the last written instruction.",
+           "address"_a, "size"_a, "type"_a, "value"_a)
+      .def("close", &Trace::TraceWriter::close,
+           "Write the seek index and close the trace. Return False on an IO "
+           "error.");
+}
+
+} // namespace pyQBDI
+} // namespace QBDI
@@ -68,6 +68,7 @@ static void clearTrampDataMap() {
   VMCallbackMap.clear();
   InstrRuleCallbackMap.clear();
   InstrumentInstCallbackMap.clear();
+  clearInstAnalysisCache();
 }
 
 // QBDI trampoline for python callback
@@ -106,7 +107,7 @@ trampoline_InstrRuleCallback(VMInstanceRef vm, const InstAnalysis *analysis,
       static_cast<TrampData<PyInstrRuleCallback> *>(data);
   std::vector<InstrRuleDataCBKPython> resCB;
   try {
-    resCB = cbk->cbk(vm, analysis, cbk->obj);
+    resCB = cbk->cbk(vm, castInstAnalysis(*vm, analysis), cbk->obj);
   } catch (const std::exception &e) {
     std::cerr << "Error during InstrRuleCallback : " << e.what() << std::endl;
     exit(1);
@@ -135,6 +136,16 @@ trampoline_InstrRuleCallback(VMInstanceRef vm, const InstAnalysis *analysis,
   return res;
 }
 
+// A native callback given by its address (ctypes, cffi or numba). The
+// callback is registered as is and doesn't use python during the execution.
+template <typename T>
+static T nativeCallback(rword address) {
+  if (address == 0) {
+    throw std::invalid_argument("The address of the callback cannot be 0");
+  }
+  return reinterpret_cast<T>(address);
+}
+
 void init_binding_VM(py::module_ &m) {
 
   py::module_ atexit = py::module_::import("atexit");
@@ -148,6 +159,24 @@ void init_binding_VM(py::module_ &m) {
            "options"_a = NO_OPT)
       .def_property("options", &VM::getOptions, &VM::setOptions,
                     "Options of the VM")
+      .def_property(
+          "instructionBudget",
+          [](const VM &vm) -> py::object {
+            if (not vm.isInstructionBudgetEnabled()) {
+              return py::none();
+            }
+            return py::int_(vm.getInstructionBudget());
+          },
+          [](VM &vm, const py::object &budget) {
+            if (budget.is_none()) {
+              vm.removeInstructionBudget();
+            } else {
+              vm.setInstructionBudget(budget.cast<uint64_t>());
+            }
+          },
+          "Number of instructions that the next runs can execute (None "
+          "without budget). The whole size of a sequence is charged at its "
+          "entry.")
       .def("getGPRState", &VM::getGPRState,
            py::return_value_policy::reference_internal,
            "Obtain the current general purpose register state.")
@@ -253,6 +282,15 @@ void init_binding_VM(py::module_ &m) {
           },
           "Register a callback event for every instruction executed.", "pos"_a,
           "cbk"_a, "data"_a, "priority"_a = PRIORITY_DEFAULT)
+      .def(
+          "addCodeCB",
+          [](VM &vm, InstPosition pos, rword cbk, rword data, int priority) {
+            return vm.addCodeCB(pos, nativeCallback<InstCallback>(cbk),
+                                reinterpret_cast<void *>(data), priority);
+          },
+          "Register a native callback (the address of a C InstCallback) "
+          "event for every instruction executed.",
+          "pos"_a, "cbk"_a, "data"_a = 0, "priority"_a = PRIORITY_DEFAULT)
       .def(
           "addCodeAddrCB",
           [](VM &vm, rword address, InstPosition pos, PyInstCallback &cbk,
@@ -298,6 +336,17 @@ void init_binding_VM(py::module_ &m) {
           "Register a callback event for every memory access matching the type "
           "bitfield made by the instructions.",
           "type"_a, "cbk"_a, "data"_a, "priority"_a = PRIORITY_DEFAULT)
+      .def(
+          "addMemAccessCB",
+          [](VM &vm, MemoryAccessType type, rword cbk, rword data,
+             int priority) {
+            return vm.addMemAccessCB(type, nativeCallback<InstCallback>(cbk),
+                                     reinterpret_cast<void *>(data), priority);
+          },
+          "Register a native callback (the address of a C InstCallback) "
+          "event for every memory access matching the type bitfield made by "
+          "the instructions.",
+          "type"_a, "cbk"_a, "data"_a = 0, "priority"_a = PRIORITY_DEFAULT)
       .def(
           "addMemAddrCB",
           [](VM &vm, rword address, MemoryAccessType type, PyInstCallback &cbk,
@@ -347,6 +396,15 @@ void init_binding_VM(py::module_ &m) {
           },
           "Register a callback event for a specific VM event.", "mask"_a,
           "cbk"_a, "data"_a)
+      .def(
+          "addVMEventCB",
+          [](VM &vm, VMEvent mask, rword cbk, rword data) {
+            return vm.addVMEventCB(mask, nativeCallback<VMCallback>(cbk),
+                                   reinterpret_cast<void *>(data));
+          },
+          "Register a native callback (the address of a C VMCallback) event "
+          "for a specific VM event.",
+          "mask"_a, "cbk"_a, "data"_a = 0)
       .def(
           "deleteInstrumentation",
           [](VM &vm, uint32_t id) {
@@ -367,7 +425,7 @@ void init_binding_VM(py::module_ &m) {
       .def(
           "getInstAnalysis",
           [](const VM &vm, AnalysisType type) {
-            return vm.getInstAnalysis(type);
+            return castInstAnalysis(vm, vm.getInstAnalysis(type));
           },
           "Obtain the analysis of the current instruction. Analysis results "
           "are cached in the VM.",
@@ -375,12 +433,12 @@ void init_binding_VM(py::module_ &m) {
                     AnalysisType::ANALYSIS_INSTRUCTION |
                         AnalysisType::ANALYSIS_DISASSEMBLY,
                     "AnalysisType.ANALYSIS_INSTRUCTION|AnalysisType.ANALYSIS_"
-                    "DISASSEMBLY"),
-          py::return_value_policy::copy)
+                    "DISASSEMBLY"))
       .def(
           "getCachedInstAnalysis",
           [](const VM &vm, rword address, AnalysisType type) {
-            return vm.getCachedInstAnalysis(address, type);
+            return castInstAnalysis(vm,
+                                    vm.getCachedInstAnalysis(address, type));
           },
           "Obtain the analysis of a cached instruction. Analysis results are "
           "cached in the VM.",
@@ -389,8 +447,7 @@ void init_binding_VM(py::module_ &m) {
                     AnalysisType::ANALYSIS_INSTRUCTION |
                         AnalysisType::ANALYSIS_DISASSEMBLY,
                     "AnalysisType.ANALYSIS_INSTRUCTION|AnalysisType.ANALYSIS_"
-                    "DISASSEMBLY"),
-          py::return_value_policy::copy)
+                    "DISASSEMBLY"))
       .def("recordMemoryAccess", &VM::recordMemoryAccess,
            "Add instrumentation rules to log memory access using inline "
            "instrumentation and instruction shadows.",
@@ -407,7 +464,10 @@ void init_binding_VM(py::module_ &m) {
            "Clear a specific address range from the translation cache.",
            "start"_a, "end"_a)
       .def("clearAllCache", &VM::clearAllCache,
-           "Clear the entire translation cache.");
+           "Clear the entire translation cache.")
+      .def("getCacheGeneration", &VM::getCacheGeneration,
+           "Get the generation of the translation cache. It changes each time "
+           "the cache is flushed.");
 }
 
 } // namespace pyQBDI
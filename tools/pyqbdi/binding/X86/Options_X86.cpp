@@ -32,8 +32,19 @@ void init_binding_Options(py::module_ &m) {
       .value("OPT_DISABLE_OPTIONAL_FPR", Options::OPT_DISABLE_OPTIONAL_FPR,
              "Disable context switch optimisation when the target execblock "
              "doesn't used FPR")
+      .value("OPT_ENABLE_REG_LIVENESS", Options::OPT_ENABLE_REG_LIVENESS,
+             "Use a liveness analysis to let the instrumentation use dead "
+             "registers without backup. The value of a dead register in the "
+             "GPRState may be wrong in VMEvent callback.")
+      .value("OPT_MERGE_MEMORY_ACCESS", Options::OPT_MERGE_MEMORY_ACCESS,
+             "Merge the contiguous accesses of the same type in "
+             "getBBMemoryAccess. The value of a merged access is unknown.")
       .value("OPT_ATT_SYNTAX", Options::OPT_ATT_SYNTAX,
              "Used the AT&T syntax for instruction disassembly")
+      .value("OPT_RECORD_LARGE_MEMORY_VALUE",
+             Options::OPT_RECORD_LARGE_MEMORY_VALUE,
+             "Record the value of the memory accesses up to 64 bytes. The "
+             "accesses larger than a rword are split in rword.")
       .export_values()
       .def_invert()
       .def_repr_str();
@@ -40,8 +40,9 @@ struct InstrRuleDataCBKPython {
       : cbk(cbk), data(data), position(position), priority(priority) {}
 };
 
+// The InstAnalysis is given as its cached python object
 using PyInstrRuleCallback = std::function<std::vector<InstrRuleDataCBKPython>(
-    VMInstanceRef, const InstAnalysis *, py::object &)>;
+    VMInstanceRef, const py::object &, py::object &)>;
 
 } // namespace pyQBDI
 } // namespace QBDI
@@ -43,17 +43,24 @@ namespace pyQBDI {
 
 void init_binding_Callback(py::module_ &m);
 void init_binding_Errors(py::module_ &m);
+void init_binding_EventBatch(py::module_ &m);
 void init_binding_InstAnalysis(py::module_ &m);
 void init_binding_Logs(py::module_ &m);
 void init_binding_Memory(py::module_ &m);
 void init_binding_Options(py::module_ &m);
 void init_binding_Range(py::module_ &m);
 void init_binding_State(py::module_ &m);
+void init_binding_TraceReader(py::module_ &m);
 void init_binding_VM(py::module_ &m);
 
 void init_utils_Memory(py::module_ &m);
 void init_utils_Float(py::module_ &m);
 
+// Return the cached python object of an InstAnalysis of the VM
+py::object castInstAnalysis(const VM &vm, const InstAnalysis *analysis);
+// Drop the cached python objects of all the VMs
+void clearInstAnalysisCache();
+
 } // namespace pyQBDI
 } // namespace QBDI
 
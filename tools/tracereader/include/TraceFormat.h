@@ -0,0 +1,100 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef QBDI_TRACEFORMAT_H
+#define QBDI_TRACEFORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A trace file is composed of:
+ *
+ *  - a fixed size header (TraceFileHeader), stored in little endian
+ *  - a stream of variable length records. Each record starts with a tag byte
+ *    (the record type in the lower nibble, the access type for memory records
+ *    in the upper nibble) followed by LEB128 varints:
+ *
+ *      TRACE_RECORD_INST:   zigzag(pc - previousPC)
+ *      TRACE_RECORD_MEMORY: zigzag(address - previousAddress), size, value
+ *
+ *  - an optional seek index (TraceIndexHeader followed by TraceIndexEntry),
+ *    written by TraceWriter when the trace is closed. When the index is
+ *    missing (truncated trace), the reader rebuilds it with a single scan.
+ *
+ * Each index entry holds the whole decoder state at a record boundary, so that
+ * decoding can restart from any entry without reading the previous records.
+ */
+
+namespace QBDI {
+namespace Trace {
+
+static const char TRACE_MAGIC[8] = {'Q', 'B', 'D', 'I', 'T', 'R', 'C', '\0'};
+static const uint32_t TRACE_VERSION = 1;
+
+/*! Default number of records between two seek index entries */
+static const uint32_t TRACE_DEFAULT_INDEX_INTERVAL = 4096;
+
+enum TraceRecordType : uint8_t {
+  TRACE_RECORD_INST = 0,   /*!< An executed instruction */
+  TRACE_RECORD_MEMORY = 1, /*!< A memory access of the previous instruction */
+};
+
+enum TraceAccessType : uint8_t {
+  TRACE_ACCESS_READ = 1,  /*!< Memory read access */
+  TRACE_ACCESS_WRITE = 2, /*!< Memory write access */
+};
+
+struct TraceFileHeader {
+  char magic[8];          /*!< TRACE_MAGIC */
+  uint32_t version;       /*!< TRACE_VERSION */
+  uint32_t indexInterval; /*!< Number of records between two index entries */
+  uint64_t recordCount;   /*!< Number of records (0 if not closed) */
+  uint64_t indexOffset;   /*!< Offset of the seek index (0 if none) */
+};
+static_assert(sizeof(TraceFileHeader) == 32, "Unexpected trace header size");
+
+struct TraceIndexHeader {
+  uint64_t entryCount; /*!< Number of TraceIndexEntry following the header */
+  uint64_t reserved;
+};
+static_assert(sizeof(TraceIndexHeader) == 16, "Unexpected index header size");
+
+struct TraceIndexEntry {
+  uint64_t offset;      /*!< File offset of the first record of the interval */
+  uint64_t recordIndex; /*!< Number of records before this entry */
+  uint64_t instCount;   /*!< Number of instructions before this entry */
+  uint64_t pc;          /*!< Last decoded PC (delta base) */
+  uint64_t address;     /*!< Last decoded memory address (delta base) */
+  uint64_t pcMin;       /*!< Lowest PC executed in the interval */
+  uint64_t pcMax;       /*!< Highest PC executed in the interval */
+};
+static_assert(sizeof(TraceIndexEntry) == 56, "Unexpected index entry size");
+
+struct TraceRecord {
+  TraceRecordType type;
+  uint8_t accessType; /*!< TraceAccessType for memory records */
+  uint16_t size;      /*!< Size of the memory access */
+  uint64_t instCount; /*!< Index of the (owning) instruction in the trace */
+  uint64_t address;   /*!< PC of the instruction or address of the access */
+  uint64_t value;     /*!< Value of the memory access */
+};
+
+} // namespace Trace
+} // namespace QBDI
+
+#endif // QBDI_TRACEFORMAT_H
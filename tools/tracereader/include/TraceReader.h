@@ -0,0 +1,141 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef QBDI_TRACEREADER_H
+#define QBDI_TRACEREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "TraceFormat.h"
+
+namespace QBDI {
+namespace Trace {
+
+/*! Decoding position in a trace. A cursor is a small value object: it can be
+ * copied freely to remember a position. It is valid as long as the TraceReader
+ * that created it stays open.
+ */
+struct TraceCursor {
+  const uint8_t *pos = nullptr;
+  const uint8_t *end = nullptr;
+  uint64_t recordIndex = 0;
+  uint64_t instCount = 0;
+  uint64_t pc = 0;
+  uint64_t address = 0;
+
+  /*! Return true if no more records can be decoded */
+  bool atEnd() const { return pos >= end; }
+};
+
+class TraceReader {
+public:
+  TraceReader() = default;
+  ~TraceReader();
+
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  /*! Map a trace file in memory and load (or rebuild) its seek index.
+   *
+   * @param[in] path           Path of the trace
+   * @param[in] indexInterval  Number of records between two index entries
+   *                           when the index must be rebuilt (0 to use the
+   *                           interval of the header)
+   *
+   * @return true on success
+   */
+  bool open(const std::string &path, uint32_t indexInterval = 0);
+
+  /*! Unmap the trace. All cursors become invalid.
+   */
+  void close();
+
+  bool isOpen() const { return base != nullptr; }
+
+  /*! Number of records of the trace */
+  uint64_t getRecordCount() const { return recordCount; }
+
+  /*! Number of instruction records of the trace */
+  uint64_t getInstCount() const { return instCount; }
+
+  /*! Seek index (one entry every getIndexInterval() records) */
+  const std::vector<TraceIndexEntry> &getIndex() const { return index; }
+
+  uint32_t getIndexInterval() const { return indexInterval; }
+
+  /*! Return a cursor on the first record */
+  TraceCursor begin() const;
+
+  /*! Decode the next record.
+   *
+   * @param[in,out] cursor  Position to decode, moved after the record
+   * @param[out]    record  The decoded record
+   *
+   * @return false at the end of the trace or on a malformed record
+   */
+  bool next(TraceCursor &cursor, TraceRecord &record) const;
+
+  /*! Decode up to count records in a buffer.
+   *
+   * @return the number of decoded records
+   */
+  size_t read(TraceCursor &cursor, TraceRecord *records, size_t count) const;
+
+  /*! Return a cursor on the instruction record with the given instCount.
+   * Only the records since the nearest index entry are decoded.
+   *
+   * @param[in]  instCount  Index of the instruction in the trace
+   * @param[out] cursor     The position of the instruction record
+   *
+   * @return false if the trace has less than instCount + 1 instructions
+   */
+  bool seekToInstCount(uint64_t instCount, TraceCursor &cursor) const;
+
+  /*! Return a cursor on the next execution of an address. The index intervals
+   * whose PC range doesn't contain pc are skipped without decoding.
+   *
+   * @param[in]     pc      Address of the instruction
+   * @param[in,out] cursor  Start position of the search. Updated with the
+   *                        position of the instruction record on success.
+   *
+   * @return false if the address isn't executed after the cursor
+   */
+  bool seekToPC(uint64_t pc, TraceCursor &cursor) const;
+
+private:
+  bool loadIndex();
+  bool buildIndex(uint32_t interval);
+  TraceCursor cursorAt(const TraceIndexEntry &entry) const;
+
+  const uint8_t *base = nullptr;
+  size_t size = 0;
+  const uint8_t *dataEnd = nullptr;
+  void *mapHandle = nullptr;
+
+  uint64_t recordCount = 0;
+  uint64_t instCount = 0;
+  uint32_t indexInterval = 0;
+  std::vector<TraceIndexEntry> index;
+};
+
+} // namespace Trace
+} // namespace QBDI
+
+#endif // QBDI_TRACEREADER_H
@@ -0,0 +1,82 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef QBDI_TRACEWRITER_H
+#define QBDI_TRACEWRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "TraceFormat.h"
+
+namespace QBDI {
+namespace Trace {
+
+/*! Produce a trace file readable by TraceReader. The seek index is written when
+ * the trace is closed.
+ */
+class TraceWriter {
+public:
+  TraceWriter() = default;
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  bool open(const std::string &path,
+            uint32_t indexInterval = TRACE_DEFAULT_INDEX_INTERVAL);
+
+  /*! Write the seek index, update the header and close the file.
+   *
+   * @return false if an IO error occurs
+   */
+  bool close();
+
+  bool isOpen() const { return file != nullptr; }
+
+  /*! Append an executed instruction */
+  void writeInst(uint64_t pc);
+
+  /*! Append a memory access of the last written instruction */
+  void writeMemoryAccess(uint64_t address, uint16_t size,
+                         TraceAccessType type, uint64_t value);
+
+  uint64_t getRecordCount() const { return recordCount; }
+
+private:
+  void beginRecord();
+  void flush();
+
+  FILE *file = nullptr;
+  bool error = false;
+  std::vector<uint8_t> buffer;
+  uint64_t offset = 0;
+
+  uint32_t indexInterval = TRACE_DEFAULT_INDEX_INTERVAL;
+  uint64_t recordCount = 0;
+  uint64_t instCount = 0;
+  uint64_t pc = 0;
+  uint64_t address = 0;
+  std::vector<TraceIndexEntry> index;
+};
+
+} // namespace Trace
+} // namespace QBDI
+
+#endif // QBDI_TRACEWRITER_H
@@ -0,0 +1,357 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "TraceReader.h"
+#include "Varint.h"
+
+namespace QBDI {
+namespace Trace {
+
+TraceReader::~TraceReader() { close(); }
+
+bool TraceReader::open(const std::string &path, uint32_t interval) {
+  close();
+
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) ||
+      static_cast<uint64_t>(fileSize.QuadPart) < sizeof(TraceFileHeader)) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return false;
+  }
+  void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (addr == nullptr) {
+    CloseHandle(mapping);
+    return false;
+  }
+  mapHandle = mapping;
+  size = static_cast<size_t>(fileSize.QuadPart);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(TraceFileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+#if defined(MADV_SEQUENTIAL)
+  // traces are mostly decoded forward
+  madvise(addr, st.st_size, MADV_SEQUENTIAL);
+#endif
+  size = static_cast<size_t>(st.st_size);
+#endif
+  base = static_cast<const uint8_t *>(addr);
+
+  TraceFileHeader header;
+  memcpy(&header, base, sizeof(header));
+  if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != TRACE_VERSION) {
+    close();
+    return false;
+  }
+
+  indexInterval = header.indexInterval;
+  if (header.indexOffset >= sizeof(TraceFileHeader) &&
+      header.indexOffset <= size && indexInterval != 0) {
+    dataEnd = base + header.indexOffset;
+    recordCount = header.recordCount;
+    if (loadIndex()) {
+      return true;
+    }
+    // invalid index: the records still end at the index
+  } else {
+    // no index (the trace wasn't closed): scan the whole trace
+    dataEnd = base + size;
+  }
+  if (interval == 0) {
+    interval = (indexInterval == 0) ? TRACE_DEFAULT_INDEX_INTERVAL
+                                    : indexInterval;
+  }
+  if (!buildIndex(interval)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void TraceReader::close() {
+  if (base != nullptr) {
+#if defined(_WIN32)
+    UnmapViewOfFile(base);
+    CloseHandle(static_cast<HANDLE>(mapHandle));
+#else
+    munmap(const_cast<uint8_t *>(base), size);
+#endif
+  }
+  base = nullptr;
+  size = 0;
+  dataEnd = nullptr;
+  mapHandle = nullptr;
+  recordCount = 0;
+  instCount = 0;
+  indexInterval = 0;
+  index.clear();
+}
+
+bool TraceReader::loadIndex() {
+  const uint8_t *p = dataEnd;
+  const uint8_t *fileEnd = base + size;
+  if (static_cast<size_t>(fileEnd - p) < sizeof(TraceIndexHeader)) {
+    return false;
+  }
+  TraceIndexHeader indexHeader;
+  memcpy(&indexHeader, p, sizeof(indexHeader));
+  p += sizeof(indexHeader);
+  if (indexHeader.entryCount >
+      static_cast<size_t>(fileEnd - p) / sizeof(TraceIndexEntry)) {
+    return false;
+  }
+  uint64_t expectedEntries =
+      (recordCount + indexInterval - 1) / indexInterval;
+  if (indexHeader.entryCount != expectedEntries) {
+    return false;
+  }
+  index.resize(indexHeader.entryCount);
+  if (!index.empty()) {
+    memcpy(index.data(), p, index.size() * sizeof(TraceIndexEntry));
+  }
+  for (const TraceIndexEntry &entry : index) {
+    if (entry.offset < sizeof(TraceFileHeader) ||
+        entry.offset > static_cast<uint64_t>(dataEnd - base)) {
+      index.clear();
+      return false;
+    }
+  }
+
+  // the number of instructions isn't stored: decode the last interval
+  if (index.empty()) {
+    instCount = 0;
+    return true;
+  }
+  TraceCursor cursor = cursorAt(index.back());
+  TraceRecord record;
+  while (next(cursor, record)) {
+  }
+  if (!cursor.atEnd() || cursor.recordIndex != recordCount) {
+    index.clear();
+    return false;
+  }
+  instCount = cursor.instCount;
+  return true;
+}
+
+bool TraceReader::buildIndex(uint32_t interval) {
+  indexInterval = interval;
+  index.clear();
+
+  TraceCursor cursor = begin();
+  TraceRecord record;
+  while (!cursor.atEnd()) {
+    if (cursor.recordIndex % indexInterval == 0) {
+      index.push_back({static_cast<uint64_t>(cursor.pos - base),
+                       cursor.recordIndex, cursor.instCount, cursor.pc,
+                       cursor.address, UINT64_MAX, 0});
+    }
+    const uint8_t *recordStart = cursor.pos;
+    if (!next(cursor, record)) {
+      // truncated trace: ignore the partial record
+      dataEnd = recordStart;
+      if (index.back().recordIndex == cursor.recordIndex) {
+        index.pop_back();
+      }
+      break;
+    }
+    if (record.type == TRACE_RECORD_INST) {
+      TraceIndexEntry &entry = index.back();
+      entry.pcMin = std::min(entry.pcMin, record.address);
+      entry.pcMax = std::max(entry.pcMax, record.address);
+    }
+  }
+  recordCount = cursor.recordIndex;
+  instCount = cursor.instCount;
+  return true;
+}
+
+TraceCursor TraceReader::cursorAt(const TraceIndexEntry &entry) const {
+  TraceCursor cursor;
+  cursor.pos = base + entry.offset;
+  cursor.end = dataEnd;
+  cursor.recordIndex = entry.recordIndex;
+  cursor.instCount = entry.instCount;
+  cursor.pc = entry.pc;
+  cursor.address = entry.address;
+  return cursor;
+}
+
+TraceCursor TraceReader::begin() const {
+  TraceCursor cursor;
+  if (base != nullptr) {
+    cursor.pos = base + sizeof(TraceFileHeader);
+    cursor.end = dataEnd;
+  }
+  return cursor;
+}
+
+bool TraceReader::next(TraceCursor &cursor, TraceRecord &record) const {
+  const uint8_t *p = cursor.pos;
+  const uint8_t *end = cursor.end;
+  if (p >= end) {
+    return false;
+  }
+  uint8_t tag = *p++;
+  uint64_t v;
+
+  switch (tag & 0xf) {
+    case TRACE_RECORD_INST:
+      p = decodeVarint(p, end, v);
+      if (p == nullptr) {
+        return false;
+      }
+      cursor.pc += static_cast<uint64_t>(zigzagDecode(v));
+      record.type = TRACE_RECORD_INST;
+      record.accessType = 0;
+      record.size = 0;
+      record.instCount = cursor.instCount++;
+      record.address = cursor.pc;
+      record.value = 0;
+      break;
+    case TRACE_RECORD_MEMORY:
+      p = decodeVarint(p, end, v);
+      if (p == nullptr) {
+        return false;
+      }
+      cursor.address += static_cast<uint64_t>(zigzagDecode(v));
+      record.type = TRACE_RECORD_MEMORY;
+      record.accessType = tag >> 4;
+      p = decodeVarint(p, end, v);
+      if (p == nullptr) {
+        return false;
+      }
+      record.size = static_cast<uint16_t>(v);
+      p = decodeVarint(p, end, record.value);
+      if (p == nullptr) {
+        return false;
+      }
+      record.instCount = (cursor.instCount == 0) ? 0 : cursor.instCount - 1;
+      record.address = cursor.address;
+      break;
+    default:
+      return false;
+  }
+  cursor.pos = p;
+  cursor.recordIndex++;
+  return true;
+}
+
+size_t TraceReader::read(TraceCursor &cursor, TraceRecord *records,
+                         size_t count) const {
+  size_t n = 0;
+  while (n < count && next(cursor, records[n])) {
+    n++;
+  }
+  return n;
+}
+
+bool TraceReader::seekToInstCount(uint64_t target, TraceCursor &cursor) const {
+  if (target >= instCount || index.empty()) {
+    return false;
+  }
+  // last entry with entry.instCount <= target
+  auto it = std::upper_bound(
+      index.begin(), index.end(), target,
+      [](uint64_t v, const TraceIndexEntry &e) { return v < e.instCount; });
+  if (it == index.begin()) {
+    return false;
+  }
+  TraceCursor c = cursorAt(*(it - 1));
+  TraceRecord record;
+  while (true) {
+    TraceCursor prev = c;
+    if (!next(c, record)) {
+      return false;
+    }
+    if (record.type == TRACE_RECORD_INST && record.instCount == target) {
+      cursor = prev;
+      return true;
+    }
+  }
+}
+
+bool TraceReader::seekToPC(uint64_t pc, TraceCursor &cursor) const {
+  if (cursor.pos == nullptr || indexInterval == 0) {
+    return false;
+  }
+  TraceCursor c = cursor;
+  TraceRecord record;
+  while (!c.atEnd()) {
+    // at the start of an interval, skip it if it cannot contain the address
+    if (c.recordIndex % indexInterval == 0) {
+      size_t i = c.recordIndex / indexInterval;
+      if (i < index.size() && (pc < index[i].pcMin || pc > index[i].pcMax)) {
+        if (i + 1 < index.size()) {
+          c = cursorAt(index[i + 1]);
+          continue;
+        }
+        break;
+      }
+    }
+    TraceCursor prev = c;
+    if (!next(c, record)) {
+      break;
+    }
+    if (record.type == TRACE_RECORD_INST && record.address == pc) {
+      cursor = prev;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace Trace
+} // namespace QBDI
@@ -0,0 +1,162 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+
+#include "TraceWriter.h"
+#include "Varint.h"
+
+namespace QBDI {
+namespace Trace {
+
+static const size_t WRITE_BUFFER_SIZE = 1 << 16;
+
+TraceWriter::~TraceWriter() { close(); }
+
+bool TraceWriter::open(const std::string &path, uint32_t indexInterval_) {
+  close();
+  file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  error = false;
+  indexInterval = (indexInterval_ == 0) ? TRACE_DEFAULT_INDEX_INTERVAL
+                                        : indexInterval_;
+  recordCount = 0;
+  instCount = 0;
+  pc = 0;
+  address = 0;
+  index.clear();
+  buffer.clear();
+  buffer.reserve(WRITE_BUFFER_SIZE + 2 * VARINT_MAX_SIZE + 1);
+
+  // the header is rewritten when the trace is closed
+  TraceFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.indexInterval = indexInterval;
+  buffer.insert(buffer.end(), reinterpret_cast<const uint8_t *>(&header),
+                reinterpret_cast<const uint8_t *>(&header) + sizeof(header));
+  offset = sizeof(header);
+  return true;
+}
+
+void TraceWriter::flush() {
+  if (file != nullptr && !buffer.empty()) {
+    if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+      error = true;
+    }
+  }
+  buffer.clear();
+}
+
+void TraceWriter::beginRecord() {
+  if (recordCount % indexInterval == 0) {
+    index.push_back({offset, recordCount, instCount, pc, address, UINT64_MAX,
+                     0});
+  }
+  recordCount++;
+}
+
+void TraceWriter::writeInst(uint64_t newPC) {
+  if (file == nullptr) {
+    return;
+  }
+  beginRecord();
+  TraceIndexEntry &entry = index.back();
+  if (newPC < entry.pcMin) {
+    entry.pcMin = newPC;
+  }
+  if (newPC > entry.pcMax) {
+    entry.pcMax = newPC;
+  }
+
+  uint8_t rec[1 + VARINT_MAX_SIZE];
+  rec[0] = TRACE_RECORD_INST;
+  size_t len = 1 + encodeVarint(zigzagEncode(newPC - pc), &rec[1]);
+  buffer.insert(buffer.end(), rec, rec + len);
+  offset += len;
+  pc = newPC;
+  instCount++;
+
+  if (buffer.size() >= WRITE_BUFFER_SIZE) {
+    flush();
+  }
+}
+
+void TraceWriter::writeMemoryAccess(uint64_t newAddress, uint16_t size,
+                                    TraceAccessType type, uint64_t value) {
+  if (file == nullptr) {
+    return;
+  }
+  beginRecord();
+
+  uint8_t rec[1 + 3 * VARINT_MAX_SIZE];
+  rec[0] = TRACE_RECORD_MEMORY | (type << 4);
+  size_t len = 1;
+  len += encodeVarint(zigzagEncode(newAddress - address), &rec[len]);
+  len += encodeVarint(size, &rec[len]);
+  len += encodeVarint(value, &rec[len]);
+  buffer.insert(buffer.end(), rec, rec + len);
+  offset += len;
+  address = newAddress;
+
+  if (buffer.size() >= WRITE_BUFFER_SIZE) {
+    flush();
+  }
+}
+
+bool TraceWriter::close() {
+  if (file == nullptr) {
+    return true;
+  }
+  flush();
+
+  TraceIndexHeader indexHeader;
+  indexHeader.entryCount = index.size();
+  indexHeader.reserved = 0;
+  if (fwrite(&indexHeader, sizeof(indexHeader), 1, file) != 1) {
+    error = true;
+  }
+  if (!index.empty() && fwrite(index.data(), sizeof(TraceIndexEntry),
+                               index.size(), file) != index.size()) {
+    error = true;
+  }
+
+  TraceFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.indexInterval = indexInterval;
+  header.recordCount = recordCount;
+  header.indexOffset = offset;
+  if (fseek(file, 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, file) != 1) {
+    error = true;
+  }
+
+  if (fclose(file) != 0) {
+    error = true;
+  }
+  file = nullptr;
+  index.clear();
+  return !error;
+}
+
+} // namespace Trace
+} // namespace QBDI
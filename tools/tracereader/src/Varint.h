@@ -0,0 +1,109 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef QBDI_TRACE_VARINT_H
+#define QBDI_TRACE_VARINT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace QBDI {
+namespace Trace {
+
+static const size_t VARINT_MAX_SIZE = 10;
+
+static inline unsigned countTrailingZero64(uint64_t v) {
+#if defined(_MSC_VER)
+  unsigned long r;
+  _BitScanForward64(&r, v);
+  return r;
+#else
+  return __builtin_ctzll(v);
+#endif
+}
+
+static inline uint64_t zigzagEncode(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+static inline int64_t zigzagDecode(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+// Write v as LEB128 in buf (at least VARINT_MAX_SIZE bytes).
+// Return the number of bytes written.
+static inline size_t encodeVarint(uint64_t v, uint8_t *buf) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    buf[n++] = static_cast<uint8_t>(v) | 0x80;
+    v >>= 7;
+  }
+  buf[n++] = static_cast<uint8_t>(v);
+  return n;
+}
+
+// Byte per byte decoding. Return nullptr on a truncated or overlong varint.
+static inline const uint8_t *decodeVarintSlow(const uint8_t *p,
+                                              const uint8_t *end,
+                                              uint64_t &value) {
+  uint64_t result = 0;
+  for (unsigned shift = 0; shift < 64 && p < end; shift += 7) {
+    uint8_t b = *p++;
+    result |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      value = result;
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+// Decode a LEB128 varint. When at least 8 bytes are readable, the varint is
+// decoded without a per-byte loop: the terminating byte is found with the
+// continuation bits of a 64-bit load, then the 7-bit groups are packed
+// together with three shift/mask steps. Only used on little endian hosts
+// (all architectures supported by QBDI).
+static inline const uint8_t *decodeVarint(const uint8_t *p, const uint8_t *end,
+                                          uint64_t &value) {
+  if (end - p >= 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    uint64_t stop = ~word & 0x8080808080808080ULL;
+    if (stop != 0) {
+      unsigned len = (countTrailingZero64(stop) >> 3) + 1;
+      uint64_t x = word & 0x7f7f7f7f7f7f7f7fULL;
+      if (len < 8) {
+        x &= (1ULL << (len * 8)) - 1;
+      }
+      x = ((x & 0x7f007f007f007f00ULL) >> 1) | (x & 0x007f007f007f007fULL);
+      x = ((x & 0x3fff00003fff0000ULL) >> 2) | (x & 0x00003fff00003fffULL);
+      x = ((x & 0x0fffffff00000000ULL) >> 4) | (x & 0x000000000fffffffULL);
+      value = x;
+      return p + len;
+    }
+  }
+  return decodeVarintSlow(p, end, value);
+}
+
+} // namespace Trace
+} // namespace QBDI
+
+#endif // QBDI_TRACE_VARINT_H
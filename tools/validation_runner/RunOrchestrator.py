@@ -20,7 +20,7 @@ import time
 import multiprocessing
 import subprocess
 
-from TestResult import TestResult
+from TestResult import TestResult, hash_file, get_binary_hash, get_cache_key
 from RunResult import RunResult
 
 def run_test(test, env, idx):
@@ -31,6 +31,7 @@ def run_test(test, env, idx):
 
     env['VALIDATOR_COVERAGE'] = coverage_file
     # Execute
+    start = time.monotonic()
     try:
         process = subprocess.run([test.command] + test.arguments, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, env=env)
         retcode = process.returncode
@@ -40,6 +41,7 @@ def run_test(test, env, idx):
         retcode = 255
         error = True
         result = ""
+    duration = time.monotonic() - start
 
     # Parse test results and remove test files
     if os.path.isfile(coverage_file):
@@ -50,6 +52,7 @@ def run_test(test, env, idx):
         coverage = ""
 
     test_result = TestResult(test, retcode, result, coverage, error)
+    test_result.duration = duration
 
     if test_result.retcode == 0 and test_result.same_output == 1:
         print('[{}] Validated {}'.format(idx, test.command_line()))
@@ -58,20 +61,56 @@ def run_test(test, env, idx):
 
     return test_result
 
+def run_job(job):
+    idx, test, env, cache_key = job
+    test_result = run_test(test, env, idx)
+    test_result.cache_key = cache_key
+    return idx, test_result
+
 class RunOrchestrator:
-    def __init__(self, run_cfg):
+    def __init__(self, run_cfg, db=None, use_cache=True):
         self.run_cfg = run_cfg
+        self.db = db
+        self.use_cache = use_cache and db != None
+
+    def schedule(self, jobs):
+        # Longest tests first: a long test started at the end of the run
+        # would keep the other workers idle
+        if self.db == None:
+            return jobs
+        durations = self.db.get_test_durations()
+        def expected_duration(job):
+            test = job[1]
+            return durations.get((test.command, str(test.arguments)), float('inf'))
+        return sorted(jobs, key=expected_duration, reverse=True)
 
     def run(self):
-        pool = multiprocessing.Pool(processes=self.run_cfg.thread)
         tests = self.run_cfg.tests
-        async_res = []
-        # Schedule validation on multiple process
+        validator_hash = hash_file(self.run_cfg.validator_path).hexdigest()
+        run_result = RunResult([])
+        results = [None] * len(tests)
+        jobs = []
         for idx in range(len(tests)):
+            cache_key = get_cache_key(tests[idx], validator_hash, get_binary_hash(tests[idx].command))
+            if self.use_cache and cache_key != None:
+                cached = self.db.get_cached_test(cache_key)
+                if cached != None:
+                    print('[{}] Cached {}'.format(idx, tests[idx].command_line()))
+                    cached.cfg = tests[idx]
+                    results[idx] = cached
+                    run_result.add_test_result(cached)
+                    continue
             env = dict(os.environ, LD_PRELOAD=self.run_cfg.validator_path, VALIDATOR_VERBOSITY='Detail', LD_BIND_NOW='1')
-            async_res.append(pool.apply_async(run_test, (tests[idx], env, idx)))
-        test_results = []
-        for idx in range(len(tests)):
-            test_results.append(async_res[idx].get())
-        run_result = RunResult(test_results)
+            jobs.append((idx, tests[idx], env, cache_key))
+
+        # Each idle worker takes the next test: the workers never wait for a
+        # precomputed share of the tests
+        with multiprocessing.Pool(processes=self.run_cfg.thread) as pool:
+            for idx, test_result in pool.imap_unordered(run_job, self.schedule(jobs), chunksize=1):
+                results[idx] = test_result
+                run_result.add_test_result(test_result)
+
+        # Keep the order of the configuration in the database
+        run_result.test_results = results
+        run_result.finalize()
         return run_result
@@ -25,7 +25,7 @@ class RunResult:
             return
         # Init run info
         self.get_branch_commit()
-        self.test_results = test_results
+        self.test_results = []
         self.coverage = {}
         self.memaccess_unique = {}
         self.total_instr       = 0
@@ -41,25 +41,33 @@ class RunResult:
         self.memaccess_error   = 0
         # Compute aggregated statistics
         for t in test_results:
-            # Only count successfull tests
-            if t.retcode == 0 and t.same_output == 1:
-                self.total_instr       += t.total_instr
-                self.errors            += t.errors
-                self.no_impact_err     += t.no_impact_err
-                self.non_critical_err  += t.non_critical_err
-                self.critical_err      += t.critical_err
-                self.cascades          += t.cascades
-                self.no_impact_casc    += t.no_impact_casc
-                self.non_critical_casc += t.non_critical_casc
-                self.critical_casc     += t.critical_casc
-                self.memaccess_error   += t.memaccess_error
-                self.passed_tests   += 1
-                # Aggregate coverage
-                for instr, count in t.coverage.items():
-                    self.coverage[instr] = self.coverage.get(instr, 0) + count
-                for instr, count in t.memaccess_unique.items():
-                    self.memaccess_unique[instr] = self.memaccess_unique.get(instr, 0) + count
-        self.total_tests = len(test_results)
+            self.add_test_result(t)
+        self.finalize()
+
+    def add_test_result(self, t):
+        # Merge the statistics and the coverage of a test as soon as it ends
+        self.test_results.append(t)
+        # Only count successfull tests
+        if t.retcode == 0 and t.same_output == 1:
+            self.total_instr       += t.total_instr
+            self.errors            += t.errors
+            self.no_impact_err     += t.no_impact_err
+            self.non_critical_err  += t.non_critical_err
+            self.critical_err      += t.critical_err
+            self.cascades          += t.cascades
+            self.no_impact_casc    += t.no_impact_casc
+            self.non_critical_casc += t.non_critical_casc
+            self.critical_casc     += t.critical_casc
+            self.memaccess_error   += t.memaccess_error
+            self.passed_tests   += 1
+            # Aggregate coverage
+            for instr, count in t.coverage.items():
+                self.coverage[instr] = self.coverage.get(instr, 0) + count
+            for instr, count in t.memaccess_unique.items():
+                self.memaccess_unique[instr] = self.memaccess_unique.get(instr, 0) + count
+
+    def finalize(self):
+        self.total_tests = len(self.test_results)
         self.unique_instr = len(self.coverage)
         self.coverage_log = coverage_to_log(self.coverage.items())
         self.memaccess_unique_log = coverage_to_log(self.memaccess_unique.items())
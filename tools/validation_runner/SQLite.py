@@ -75,7 +75,9 @@ class SQLiteDBAdapter:
                             same_output INTEGER,
                             cascades_log TEXT,
                             coverage_log TEXT,
-                            memaccess_unique_log TEXT);''')
+                            memaccess_unique_log TEXT,
+                            duration REAL,
+                            cache_key TEXT);''')
         cursor.execute('''CREATE INDEX IF NOT EXISTS RunIdx on Tests (run_id);''')
         self.connection.commit()
 
@@ -102,7 +104,22 @@ class SQLiteDBAdapter:
                 cursor.execute('DROP TABLE Runs;')
                 self.connection.commit()
                 self.setup_db()
+                return
 
+        # columns added without losing the previous runs
+        added_column = [
+            # table, column_name, type
+            ("Tests", "duration", "REAL"),
+            ("Tests", "cache_key", "TEXT"),
+        ]
+        for table, column_name, column_type in added_column:
+            cursor.execute("SELECT COUNT(*) AS CNTREC FROM pragma_table_info(?) WHERE name=?", (table, column_name))
+            row = cursor.fetchone()
+            cursor.fetchall()
+            if row[0] == 0:
+                cursor.execute('ALTER TABLE {} ADD COLUMN {} {};'.format(table, column_name, column_type))
+        cursor.execute('''CREATE INDEX IF NOT EXISTS CacheIdx on Tests (cache_key);''')
+        self.connection.commit()
 
 
     def insert_run_result(self, run_result):
@@ -128,8 +145,9 @@ class SQLiteDBAdapter:
                           total_instr, unique_instr, diff_map, errors, no_impact_err, non_critical_err,
                           critical_err, cascades, no_impact_casc, non_critical_casc, critical_casc,
                           memaccess_error, memaccess_unique_error, memaccess_log, output_len_dbg, output_len_dbi,
-                          same_output, cascades_log, coverage_log, memaccess_unique_log) VALUES
-                          (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?);''',
+                          same_output, cascades_log, coverage_log, memaccess_unique_log, duration,
+                          cache_key) VALUES
+                          (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?);''',
                           (run_id, test_result.cfg.command, str(test_result.cfg.arguments),
                               test_result.binary_hash, test_result.retcode, test_result.total_instr,
                               test_result.unique_instr, test_result.diff_map, test_result.errors,
@@ -138,11 +156,29 @@ class SQLiteDBAdapter:
                               test_result.critical_casc, test_result.memaccess_error, test_result.memaccess_unique_error,
                               test_result.memaccess_log, test_result.output_len_dbg, test_result.output_len_dbi,
                               test_result.same_output, test_result.cascades_log,
-                              test_result.coverage_log, test_result.memaccess_unique_log))
+                              test_result.coverage_log, test_result.memaccess_unique_log,
+                              test_result.duration, test_result.cache_key))
         run_id = cursor.lastrowid
         self.connection.commit()
         return run_id
 
+    def get_test_durations(self):
+        # Last known duration of each test (command, arguments)
+        cursor = self.connection.cursor()
+        durations = {}
+        for row in cursor.execute('''select command, arguments, duration from Tests
+                                     where duration is not null order by test_id;'''):
+            durations[(row['command'], row['arguments'])] = row['duration']
+        return durations
+
+    def get_cached_test(self, cache_key):
+        cursor = self.connection.cursor()
+        cursor.execute('select * from Tests where cache_key=? order by test_id desc;', (cache_key,))
+        row = cursor.fetchone()
+        if row == None:
+            return None
+        return TestResult.from_dict({k: row[k] for k in row.keys()})
+
     def get_last_run(self, branch):
         cursor = self.connection.cursor()
         # Find run result
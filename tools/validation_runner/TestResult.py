@@ -37,6 +37,43 @@ def scan_for_multipattern(data, pattern):
         r[m.groups()[0]] = r.get(m.groups()[0], 0) + 1
     return r
 
+def hash_file(path, h=None):
+    if h == None:
+        h = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(1 << 20), b''):
+            h.update(chunk)
+    return h
+
+def find_binary(command):
+    if os.path.isfile(command):
+        return command
+    for path in os.environ["PATH"].split(os.pathsep):
+        realpath = os.path.join(path.strip('"'), command)
+        if os.path.isfile(realpath):
+            return realpath
+    return None
+
+def get_binary_hash(command):
+    realpath = find_binary(command)
+    if realpath == None:
+        return 'UNKNOWN'
+    return hash_file(realpath).hexdigest()
+
+def get_cache_key(cfg, validator_hash, binary_hash):
+    # A test is only run again if the validator, the binary, the command line
+    # or the content of a file argument changed
+    if binary_hash == 'UNKNOWN':
+        return None
+    h = hashlib.sha256()
+    h.update(validator_hash.encode('utf8'))
+    h.update(binary_hash.encode('utf8'))
+    h.update(cfg.command_line().encode('utf8'))
+    for arg in cfg.arguments:
+        if os.path.isfile(arg):
+            hash_file(arg, h)
+    return h.hexdigest()
+
 def coverage_to_log(coverage):
     coverage = list(coverage)
     coverage.sort(key=itemgetter(1), reverse=True)
@@ -49,7 +86,9 @@ class TestResult:
         self.cfg = cfg
         self.retcode = retcode
         self.exec_error = error
-        self.binary_hash = self.get_binary_hash()
+        self.binary_hash = get_binary_hash(cfg.command)
+        self.duration = 0
+        self.cache_key = None
         # Process coverage file, rebuilding a dictionnary from it
         self.coverage = {}
         self.memaccess_unique = {}
@@ -141,6 +180,8 @@ class TestResult:
         self.output_len_dbg = d['output_len_dbg']
         self.output_len_dbi = d['output_len_dbi']
         self.same_output = d['same_output']
+        self.duration = d['duration'] or 0
+        self.cache_key = d['cache_key']
         #Rebuild coverage
         self.coverage = {}
         self.memaccess_unique = {}
@@ -155,13 +196,3 @@ class TestResult:
         #Rebuild config
         self.cfg = TestConfig.from_dict(d)
         return self
-
-    def get_binary_hash(self):
-        for path in os.environ["PATH"].split(os.pathsep):
-            realpath = os.path.join(path.strip('"'), self.cfg.command)
-            if os.path.isfile(realpath):
-                h = hashlib.sha256()
-                with open(realpath, 'rb') as f:
-                    h.update(f.read())
-                return h.hexdigest()
-        return 'UNKNOWN'
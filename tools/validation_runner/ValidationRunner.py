@@ -28,13 +28,14 @@ if __name__ == '__main__':
 
     parser.add_argument("-l", "--lib", type=str, default=None, help="Override preload lib location")
     parser.add_argument("-t", "--thread", type=int, default=0, help="Number of thread")
+    parser.add_argument("--no-cache", action="store_true", help="Run the tests whose result is cached")
     parser.add_argument("configFile", type=str, default=None)
 
     args = parser.parse_args()
 
-    run_cfg = RunConfig(args.configFile, args.lib)
+    run_cfg = RunConfig(args.configFile, args.lib, args.thread)
     db  = SQLiteDBAdapter(run_cfg.database)
-    orchestrator = RunOrchestrator(run_cfg)
+    orchestrator = RunOrchestrator(run_cfg, db, not args.no_cache)
     run_result = orchestrator.run()
     run_result.print_stats()
     reg = run_result.compartive_analysis(db)
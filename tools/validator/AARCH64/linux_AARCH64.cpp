@@ -17,6 +17,7 @@
  */
 
 #include "linux_AARCH64.h"
+#include "linux_process.h"
 #include <stdlib.h>
 #include "validator.h"
 
@@ -96,26 +97,22 @@ void userToFPRState(const FPR_STRUCT *user, QBDI::FPRState *fprState) {
   fprState->fpcr = user->fpcr & 0x07f79f00;
 }
 
-void LinuxProcess::getProcessGPR(QBDI::GPRState *gprState) {
-  GPR_STRUCT user;
-  struct iovec iovec = {&user, sizeof(user)};
+void LinuxProcess::readGPR(GPR_STRUCT *user) {
+  struct iovec iovec = {user, sizeof(*user)};
 
   if (ptrace(PTRACE_GETREGSET, this->pid, ((void *)NT_PRSTATUS), &iovec) ==
       -1) {
     QBDI_ERROR("Failed to get GPR state: {}", strerror(errno));
     exit(VALIDATOR_ERR_UNEXPECTED_API_FAILURE);
   }
-  userToGPRState(&user, gprState);
 }
 
-void LinuxProcess::getProcessFPR(QBDI::FPRState *fprState) {
-  FPR_STRUCT user;
-  struct iovec iovec = {&user, sizeof(user)};
+void LinuxProcess::readFPR(FPR_STRUCT *user) {
+  struct iovec iovec = {user, sizeof(*user)};
 
   if (ptrace(PTRACE_GETREGSET, this->pid, ((void *)NT_FPREGSET), &iovec) ==
       -1) {
     QBDI_ERROR("Failed to get FPR state: {}", strerror(errno));
     exit(VALIDATOR_ERR_UNEXPECTED_API_FAILURE);
   }
-  userToFPRState(&user, fprState);
 }
@@ -25,7 +25,6 @@
 #include <sys/ptrace.h>
 #include <sys/uio.h>
 #include <sys/user.h>
-#include "linux_process.h"
 
 #define SIGBRK SIGTRAP
 static const long BRK_MASK = 0xFFFFFFFF;
@@ -17,6 +17,7 @@
  */
 
 #include "linux_ARM.h"
+#include "linux_process.h"
 #include "validator.h"
 
 #include <errno.h>
@@ -83,20 +84,16 @@ void userToFPRState(const FPR_STRUCT *user, QBDI::FPRState *fprState) {
   fprState->fpscr = user->FPSCR;
 }
 
-void LinuxProcess::getProcessGPR(QBDI::GPRState *gprState) {
-  GPR_STRUCT user;
-  int ret = ptrace(PTRACE_GETREGS, this->pid, NULL, &user);
+void LinuxProcess::readGPR(GPR_STRUCT *user) {
+  int ret = ptrace(PTRACE_GETREGS, this->pid, NULL, user);
   if (ret < 0) {
     perror("Fail to get GPR");
   }
-  userToGPRState(&user, gprState);
 }
 
-void LinuxProcess::getProcessFPR(QBDI::FPRState *fprState) {
-  FPR_STRUCT user;
-  int ret = ptrace(PTRACE_GETVFPREGS, this->pid, NULL, &user);
+void LinuxProcess::readFPR(FPR_STRUCT *user) {
+  int ret = ptrace(PTRACE_GETVFPREGS, this->pid, NULL, user);
   if (ret < 0) {
     perror("Fail to get FPR");
   }
-  userToFPRState(&user, fprState);
 }
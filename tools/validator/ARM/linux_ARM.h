@@ -24,7 +24,6 @@
 #include <QBDI.h>
 #include <sys/ptrace.h>
 #include <sys/user.h>
-#include "linux_process.h"
 
 // Let's have fun with undocumented ptrace interfaces!
 // From gdb/arm-linux-nat.c
@@ -23,7 +23,6 @@
 #include <QBDI.h>
 #include <sys/ptrace.h>
 #include <sys/user.h>
-#include "linux_process.h"
 
 #define SIGBRK SIGTRAP
 static const long BRK_MASK = 0xFF;
@@ -35,6 +34,10 @@ typedef struct user_fpxregs_struct FPR_STRUCT;
 void userToGPRState(const GPR_STRUCT *user, QBDI::GPRState *gprState);
 void userToFPRState(const FPR_STRUCT *user, QBDI::FPRState *fprState);
 
+static inline bool is_brk_hit(const GPR_STRUCT *user, void *address) {
+  return (QBDI::rword)user->eip == (QBDI::rword)address + 1;
+}
+
 static inline void fix_GPR_STRUCT(GPR_STRUCT *user) { user->eip -= 1; }
 
 #endif // LINUX_X86_H
@@ -17,6 +17,7 @@
  */
 
 #include "linux_X86_64.h"
+#include "linux_process.h"
 #include <stdlib.h>
 #include <sys/ptrace.h>
 #include "validator.h"
@@ -77,20 +78,32 @@ void userToFPRState(const FPR_STRUCT *user, QBDI::FPRState *fprState) {
   fprState->mxcsr = user->mxcsr;
 }
 
-void LinuxProcess::getProcessGPR(QBDI::GPRState *gprState) {
-  GPR_STRUCT user;
-  if (ptrace(PTRACE_GETREGS, this->pid, NULL, &user) == -1) {
+void LinuxProcess::readGPR(GPR_STRUCT *user) {
+  struct iovec iovec = {user, sizeof(*user)};
+
+  if (ptrace(PTRACE_GETREGSET, this->pid, ((void *)NT_PRSTATUS), &iovec) ==
+      -1) {
     QBDI_ERROR("Failed to get GPR state: {}", strerror(errno));
     exit(VALIDATOR_ERR_UNEXPECTED_API_FAILURE);
   }
-  userToGPRState(&user, gprState);
 }
 
-void LinuxProcess::getProcessFPR(QBDI::FPRState *fprState) {
-  FPR_STRUCT user;
-  if (ptrace(PTRACE_GETFPREGS, this->pid, NULL, &user) == -1) {
+void LinuxProcess::writeGPR(const GPR_STRUCT *user) {
+  struct iovec iovec = {(void *)user, sizeof(*user)};
+
+  if (ptrace(PTRACE_SETREGSET, this->pid, ((void *)NT_PRSTATUS), &iovec) ==
+      -1) {
+    QBDI_ERROR("Failed to set GPR state: {}", strerror(errno));
+    exit(VALIDATOR_ERR_UNEXPECTED_API_FAILURE);
+  }
+}
+
+void LinuxProcess::readFPR(FPR_STRUCT *user) {
+  struct iovec iovec = {user, sizeof(*user)};
+
+  if (ptrace(PTRACE_GETREGSET, this->pid, ((void *)NT_PRFPREG), &iovec) ==
+      -1) {
     QBDI_ERROR("Failed to get FPR state: {}", strerror(errno));
     exit(VALIDATOR_ERR_UNEXPECTED_API_FAILURE);
   }
-  userToFPRState(&user, fprState);
 }
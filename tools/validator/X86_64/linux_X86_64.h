@@ -21,9 +21,10 @@
 #include <unistd.h>
 
 #include <QBDI.h>
+#include <elf.h>
 #include <sys/ptrace.h>
+#include <sys/uio.h>
 #include <sys/user.h>
-#include "linux_process.h"
 
 #define SIGBRK SIGTRAP
 static const long BRK_MASK = 0xFF;
@@ -35,6 +36,10 @@ typedef struct user_fpregs_struct FPR_STRUCT;
 void userToGPRState(const GPR_STRUCT *user, QBDI::GPRState *gprState);
 void userToFPRState(const FPR_STRUCT *user, QBDI::FPRState *fprState);
 
+static inline bool is_brk_hit(const GPR_STRUCT *user, void *address) {
+  return user->rip == (QBDI::rword)address + 1;
+}
+
 static inline void fix_GPR_STRUCT(GPR_STRUCT *user) { user->rip -= 1; }
 
 #endif // LINUX_X86_64_H
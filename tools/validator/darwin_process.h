@@ -90,6 +90,9 @@ public:
 
   void continueExecution();
 
+  // not implemented, the master uses a breakpoint for each instruction
+  bool stepExecution() { return false; }
+
   int waitForStatus();
 
   void getProcessGPR(QBDI::GPRState *gprState);
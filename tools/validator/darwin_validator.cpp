@@ -18,6 +18,7 @@
 #include "darwin_process.h"
 #include "instrumented.h"
 #include "master.h"
+#include "ring.h"
 #include "QBDIPreload.h"
 
 #include <mach/mach.h>
@@ -34,6 +35,7 @@ static QBDI::GPRState ENTRY_GPR;
 static QBDI::FPRState ENTRY_FPR;
 static pid_t DEBUGGED, INSTRUMENTED;
 int ctrlfd, datafd, outputDBIfd, outputDBGfd;
+EventRing *ring;
 
 enum Role { Master, Instrumented, Debugged } ROLE;
 
@@ -44,7 +46,7 @@ int QBDI::qbdipreload_on_main(int argc, char **argv) {
 
   if (ROLE == Role::Master) {
     DarwinProcess *debuggedProcess = new DarwinProcess(DEBUGGED);
-    start_master(debuggedProcess, INSTRUMENTED, ctrlfd, datafd, outputDBGfd,
+    start_master(debuggedProcess, INSTRUMENTED, ring, datafd, outputDBGfd,
                  outputDBIfd);
     delete debuggedProcess;
   } else if (ROLE == Role::Instrumented) {
@@ -69,7 +71,7 @@ int QBDI::qbdipreload_on_main(int argc, char **argv) {
     QBDI::rword start = QBDI_GPR_GET(vm->getGPRState(), QBDI::REG_PC);
     QBDI::rword stop =
         *((QBDI::rword *)QBDI_GPR_GET(vm->getGPRState(), QBDI::REG_SP));
-    start_instrumented(vm, start, stop, ctrlfd, datafd);
+    start_instrumented(vm, start, stop, ring, ctrlfd, datafd);
   }
   exit(0);
 }
@@ -137,6 +139,13 @@ int QBDI::qbdipreload_on_start(void *main) {
             "!\n\n");
     exit(0);
   }
+  // The ring is mapped before the fork to be at the same address in the three
+  // processes
+  ring = createEventRing();
+  if (ring == nullptr) {
+    fprintf(stderr, "validator: fatal error, fail to map the event ring !\n\n");
+    exit(0);
+  }
 
   INSTRUMENTED = fork();
   if (INSTRUMENTED == 0) {
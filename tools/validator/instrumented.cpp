@@ -25,38 +25,39 @@
 #include <unistd.h>
 
 #include "instrumented.h"
-#include "pipes.h"
+#include "ring.h"
 
 #include <QBDI.h>
 #include "Utility/LogSys.h"
 
 int SAVED_ERRNO = 0;
 
-struct Pipes {
-  FILE *ctrlPipe;
-  FILE *dataPipe;
-};
-
 struct CBData {
-  Pipes p;
+  RingWriter *writer;
   unsigned countIgnoreInst;
+  bool skipStraightLine;
 };
 
 static QBDI::VMAction step(QBDI::VMInstanceRef vm, QBDI::GPRState *gprState,
                            QBDI::FPRState *fprState, void *data) {
-  COMMAND cmd;
   SAVED_ERRNO = errno;
   CBData *cbdata = (CBData *)data;
 
   const QBDI::InstAnalysis *instAnalysis = vm->getInstAnalysis(
       QBDI::ANALYSIS_INSTRUCTION | QBDI::ANALYSIS_DISASSEMBLY);
+  bool debuggerSkip = cbdata->countIgnoreInst != 0;
+  // Only compare the state before the instructions that may diverge, the
+  // debugged process runs the straight-line instructions without stopping
+  if (cbdata->skipStraightLine and not instAnalysis->affectControlFlow and
+      not instAnalysis->mayLoad and not instAnalysis->mayStore) {
+    debuggerSkip = true;
+  }
   // Write a new instruction event
-  if (writeInstructionEvent(instAnalysis->address, instAnalysis->mnemonic,
-                            instAnalysis->disassembly, gprState, fprState,
-                            cbdata->countIgnoreInst != 0,
-                            cbdata->p.dataPipe) != 1) {
-    // DATA pipe failure, we exit
-    QBDI_ERROR("Lost the data pipe, exiting!");
+  if (cbdata->writer->writeInstructionEvent(
+          instAnalysis->address, instAnalysis->mnemonic,
+          instAnalysis->disassembly, gprState, fprState, debuggerSkip) != 1) {
+    // The master doesn't read the events anymore, we exit
+    QBDI_ERROR("Lost the master, exiting!");
     return QBDI::VMAction::STOP;
   }
   if (cbdata->countIgnoreInst > 0) {
@@ -88,24 +89,12 @@ static QBDI::VMAction step(QBDI::VMInstanceRef vm, QBDI::GPRState *gprState,
     }
   }
 #endif
-  // Read next command
-  if (readCommand(&cmd, cbdata->p.ctrlPipe) != 1) {
-    // CTRL pipe failure, we exit
-    QBDI_ERROR("Lost the control pipe, exiting!");
-    return QBDI::VMAction::STOP;
-  }
-
   errno = SAVED_ERRNO;
-  if (cmd == COMMAND::CONTINUE) {
-    // Signaling the VM to continue the execution
-    return QBDI::VMAction::CONTINUE;
-  } else if (cmd == COMMAND::STOP) {
-    // Signaling the VM to stop the execution
+  // The master doesn't wait for each instruction and only asks to stop
+  if (cbdata->writer->stopRequested()) {
     return QBDI::VMAction::STOP;
   }
-  // FATAL
-  QBDI_ERROR("Did not recognize command from the control pipe, exiting!");
-  return QBDI::VMAction::STOP;
+  return QBDI::VMAction::CONTINUE;
 }
 
 static QBDI::VMAction verifyMemoryAccess(QBDI::VMInstanceRef vm,
@@ -242,11 +231,11 @@ static QBDI::VMAction verifyMemoryAccess(QBDI::VMInstanceRef vm,
   }
 
   // Write a new instruction event
-  if (writeMismatchMemAccessEvent(
+  if (cbdata->writer->writeMismatchMemAccessEvent(
           instAnalysis->address, doRead, instAnalysis->mayLoad, doWrite,
-          instAnalysis->mayStore, accesses, cbdata->p.dataPipe) != 1) {
-    // DATA pipe failure, we exit
-    QBDI_ERROR("Lost the data pipe, exiting!");
+          instAnalysis->mayStore, accesses) != 1) {
+    // The master doesn't read the events anymore, we exit
+    QBDI_ERROR("Lost the master, exiting!");
     return QBDI::VMAction::STOP;
   }
   errno = SAVED_ERRNO;
@@ -260,7 +249,7 @@ static QBDI::VMAction logSyscall(QBDI::VMInstanceRef vm,
                                  QBDI::FPRState *fprState, void *data) {
   CBData *cbdata = (CBData *)data;
   // We don't have the address, it just need to be different from 0
-  writeExecTransferEvent(1, cbdata->p.dataPipe);
+  cbdata->writer->writeExecTransferEvent(1);
   return QBDI::VMAction::CONTINUE;
 }
 #endif
@@ -270,7 +259,7 @@ static QBDI::VMAction logTransfer(QBDI::VMInstanceRef vm,
                                   QBDI::GPRState *gprState,
                                   QBDI::FPRState *fprState, void *data) {
   CBData *cbdata = (CBData *)data;
-  writeExecTransferEvent(state->basicBlockStart, cbdata->p.dataPipe);
+  cbdata->writer->writeExecTransferEvent(state->basicBlockStart);
   return QBDI::VMAction::CONTINUE;
 }
 
@@ -291,21 +280,28 @@ static QBDI::VMAction restoreErrno(QBDI::VMInstanceRef vm,
 }
 
 QBDI::VM *VM;
-CBData CBDATA = {{NULL, NULL}, 0};
+CBData CBDATA = {nullptr, 0, false};
+int CTRLFD = -1, DATAFD = -1;
 
 void cleanup_instrumentation() {
   static bool cleaned_up = false;
   if (cleaned_up == false) {
-    writeEvent(EVENT::EXIT, CBDATA.p.dataPipe);
-    fclose(CBDATA.p.ctrlPipe);
-    fclose(CBDATA.p.dataPipe);
+    if (CBDATA.writer != nullptr) {
+      CBDATA.writer->writeExitEvent();
+      delete CBDATA.writer;
+      CBDATA.writer = nullptr;
+    }
+    if (CTRLFD != -1) {
+      close(CTRLFD);
+      close(DATAFD);
+    }
     delete VM;
     cleaned_up = true;
   }
 }
 
 void start_instrumented(QBDI::VM *vm, QBDI::rword start, QBDI::rword stop,
-                        int ctrlfd, int datafd) {
+                        EventRing *ring, int ctrlfd, int datafd) {
 
   VM = vm;
   if (getenv("QBDI_DEBUG") != NULL) {
@@ -313,13 +309,12 @@ void start_instrumented(QBDI::VM *vm, QBDI::rword start, QBDI::rword stop,
   } else {
     QBDI::setLogPriority(QBDI::LogPriority::ERROR);
   }
-  // Opening communication FIFO
-  CBDATA.p.ctrlPipe = fdopen(ctrlfd, "rb");
-  CBDATA.p.dataPipe = fdopen(datafd, "wb");
-  if (CBDATA.p.ctrlPipe == nullptr || CBDATA.p.dataPipe == nullptr) {
-    QBDI_ERROR("Could not open communication pipes with master, exiting!");
-    return;
-  }
+  // The events are sent in the shared ring. The master closes the control
+  // pipe when it exits, the data pipe is closed when we exit.
+  CTRLFD = ctrlfd;
+  DATAFD = datafd;
+  CBDATA.writer = new RingWriter(ring, ctrlfd);
+  CBDATA.skipStraightLine = getenv("VALIDATOR_SKIP_STRAIGHT_LINE") != NULL;
 
   vm->addCodeCB(QBDI::PREINST, step, (void *)&CBDATA);
 #if defined(QBDI_ARCH_X86_64) || defined(QBDI_ARCH_X86) || \
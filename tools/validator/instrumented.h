@@ -20,8 +20,10 @@
 
 #include <QBDI/VM.h>
 
+#include "ring.h"
+
 void start_instrumented(QBDI::VM *vm, QBDI::rword start, QBDI::rword stop,
-                        int ctrlfd, int datafd);
+                        EventRing *ring, int ctrlfd, int datafd);
 
 void cleanup_instrumentation();
 
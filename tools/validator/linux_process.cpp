@@ -44,26 +44,58 @@ void LinuxProcess::unsetBreakpoint() {
     QBDI_ERROR("Failed to unset breakpoint: {}", strerror(errno));
     exit(VALIDATOR_ERR_UNEXPECTED_API_FAILURE);
   }
+  this->brk_address = nullptr;
 }
 
 void LinuxProcess::continueExecution() {
   ptrace(PTRACE_CONT, this->pid, NULL, NULL);
 }
 
+bool LinuxProcess::stepExecution() {
+#if defined(QBDI_ARCH_ARM)
+  // PTRACE_SINGLESTEP isn't supported on ARM
+  return false;
+#else
+  return ptrace(PTRACE_SINGLESTEP, this->pid, NULL, NULL) != -1;
+#endif
+}
+
 int LinuxProcess::waitForStatus() {
   int status = 0;
   waitpid(this->pid, &status, 0);
+  this->gprCached = false;
+  this->fprCached = false;
 #if defined(QBDI_ARCH_X86_64) || defined(QBDI_ARCH_X86)
-  if (WSTOPSIG(status) == SIGBRK) {
-    GPR_STRUCT user;
-    ptrace(PTRACE_GETREGS, this->pid, NULL, &user);
-    fix_GPR_STRUCT(&user);
-    ptrace(PTRACE_SETREGS, this->pid, NULL, &user);
+  // A single step also stops with SIGTRAP: only fix the PC after the int3
+  if (WIFSTOPPED(status) && WSTOPSIG(status) == SIGBRK &&
+      this->brk_address != nullptr) {
+    readGPR(&this->gprCache);
+    this->gprCached = true;
+    if (is_brk_hit(&this->gprCache, this->brk_address)) {
+      fix_GPR_STRUCT(&this->gprCache);
+      writeGPR(&this->gprCache);
+    }
   }
 #endif
   return status;
 }
 
+void LinuxProcess::getProcessGPR(QBDI::GPRState *gprState) {
+  if (not this->gprCached) {
+    readGPR(&this->gprCache);
+    this->gprCached = true;
+  }
+  userToGPRState(&this->gprCache, gprState);
+}
+
+void LinuxProcess::getProcessFPR(QBDI::FPRState *fprState) {
+  if (not this->fprCached) {
+    readFPR(&this->fprCache);
+    this->fprCached = true;
+  }
+  userToFPRState(&this->fprCache, fprState);
+}
+
 bool hasExited(int status) { return WIFEXITED(status) > 0; }
 
 bool hasStopped(int status) {
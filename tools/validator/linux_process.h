@@ -36,10 +36,22 @@ private:
   pid_t pid;
   void *brk_address;
   long brk_value;
+  // The registers are read at most once per stop of the process
+  GPR_STRUCT gprCache;
+  FPR_STRUCT fprCache;
+  bool gprCached;
+  bool fprCached;
+
+  void readGPR(GPR_STRUCT *user);
+
+  void writeGPR(const GPR_STRUCT *user);
+
+  void readFPR(FPR_STRUCT *user);
 
 public:
   LinuxProcess(pid_t process)
-      : pid(process), brk_address(nullptr), brk_value(0) {}
+      : pid(process), brk_address(nullptr), brk_value(0), gprCached(false),
+        fprCached(false) {}
 
   pid_t getPID() { return pid; }
 
@@ -49,6 +61,8 @@ public:
 
   void continueExecution();
 
+  bool stepExecution();
+
   int waitForStatus();
 
   void getProcessGPR(QBDI::GPRState *gprState);
@@ -18,6 +18,7 @@
 #include "instrumented.h"
 #include "linux_process.h"
 #include "master.h"
+#include "ring.h"
 #include "validator.h"
 #include "QBDIPreload.h"
 
@@ -38,6 +39,7 @@ static bool INSTRUMENTED = false;
 static bool MASTER = false;
 static pid_t debugged, instrumented;
 int ctrlfd, datafd, outputDBIfd, outputDBGfd;
+EventRing *ring;
 
 QBDIPRELOAD_INIT;
 
@@ -53,7 +55,7 @@ int QBDI::qbdipreload_on_main(int argc, char **argv) {
   } else {
     LinuxProcess *debuggedProcess = nullptr;
     debuggedProcess = new LinuxProcess(debugged);
-    start_master(debuggedProcess, instrumented, ctrlfd, datafd, outputDBGfd,
+    start_master(debuggedProcess, instrumented, ring, datafd, outputDBGfd,
                  outputDBIfd);
     delete debuggedProcess;
     return QBDIPRELOAD_NO_ERROR;
@@ -68,7 +70,7 @@ int QBDI::qbdipreload_on_premain(void *gprCtx, void *fpuCtx) {
 
 int QBDI::qbdipreload_on_run(QBDI::VMInstanceRef vm, QBDI::rword start,
                              QBDI::rword stop) {
-  start_instrumented(vm, start, stop, ctrlfd, datafd);
+  start_instrumented(vm, start, stop, ring, ctrlfd, datafd);
   return QBDIPRELOAD_NOT_HANDLED;
 }
 
@@ -103,6 +105,13 @@ int QBDI::qbdipreload_on_start(void *main) {
             "!\n\n");
     exit(0);
   }
+  // The ring is mapped before the fork to be at the same address in the three
+  // processes
+  ring = createEventRing();
+  if (ring == nullptr) {
+    fprintf(stderr, "validator: fatal error, fail to map the event ring !\n\n");
+    exit(0);
+  }
 
   instrumented = fork();
   if (instrumented == 0) {
@@ -16,7 +16,7 @@
  * limitations under the License.
  */
 #include "master.h"
-#include "pipes.h"
+#include "ring.h"
 #include "validator.h"
 #include "validatorengine.h"
 
@@ -27,32 +27,22 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <vector>
 
-void start_master(Process *debugged, pid_t instrumented, int ctrlfd, int datafd,
-                  int stdoutDbg, int stdoutDbi) {
-  const size_t BUFFER_SIZE = 128;
-  char mnemonic[BUFFER_SIZE], disassembly[BUFFER_SIZE];
+void start_master(Process *debugged, pid_t instrumented, EventRing *ring,
+                  int datafd, int stdoutDbg, int stdoutDbi) {
   char *env = nullptr;
   int status;
-  FILE *ctrlPipe, *dataPipe;
-  QBDI::GPRState gprStateInstr, gprStateDbg;
-  QBDI::FPRState fprStateInstr, fprStateDbg;
-  QBDI::rword address;
-  EVENT event;
-  bool skipDebugger = false;
+  QBDI::GPRState gprStateDbg;
+  QBDI::FPRState fprStateDbg;
   bool running = true;
   int error = 0;
 
   QBDI::setLogPriority(QBDI::LogPriority::ERROR);
 
-  // Create communication fifo
-  ctrlPipe = fdopen(ctrlfd, "wb");
-  dataPipe = fdopen(datafd, "rb");
-  if (ctrlPipe == nullptr || dataPipe == nullptr) {
-    QBDI_ERROR(
-        "Could not open communication pipes with instrumented, exiting!");
-    exit(VALIDATOR_ERR_PIPE_CREATION_FAIL);
-  }
+  // The events are read from the shared ring. The instrumented process closes
+  // the data pipe when it exits, the control pipe is closed when we exit.
+  RingReader reader(ring, datafd);
 
   // Handling verbosity
   LogVerbosity verbosity = LogVerbosity::Stat;
@@ -74,51 +64,38 @@ void start_master(Process *debugged, pid_t instrumented, int ctrlfd, int datafd,
 
   running = true;
   while (running) {
-    if (readEvent(&event, dataPipe) != 1) {
-      QBDI_ERROR("Lost the data pipe, exiting!");
+    const EventRecord *record = reader.readEvent();
+    if (record == nullptr) {
+      QBDI_ERROR("Lost the instrumented process, exiting!");
       debugged->continueExecution();
       error = VALIDATOR_ERR_DATA_PIPE_LOST;
       break;
     }
-    if (event == EVENT::EXIT) {
+    if (record->event == EVENT::EXIT) {
       debugged->continueExecution();
       running = false;
       break;
-    } else if (event == EVENT::EXEC_TRANSFER) {
-      QBDI::rword transferAddress;
-      if (readExecTransferEvent(&transferAddress, dataPipe) != 1) {
-        QBDI_ERROR("Lost the data pipe, exiting!");
-        debugged->continueExecution();
-        error = VALIDATOR_ERR_DATA_PIPE_LOST;
-        break;
-      }
-      validator.signalExecTransfer(transferAddress);
-    } else if (event == EVENT::INSTRUCTION) {
-      if (writeCommand(COMMAND::CONTINUE, ctrlPipe) != 1) {
-        QBDI_ERROR("Lost the control pipe, exiting!");
-        debugged->continueExecution();
-        error = VALIDATOR_ERR_CTRL_PIPE_LOST;
-        break;
-      }
-      if (readInstructionEvent(&address, mnemonic, BUFFER_SIZE, disassembly,
-                               BUFFER_SIZE, &gprStateInstr, &fprStateInstr,
-                               &skipDebugger, dataPipe) != 1) {
-        QBDI_ERROR("Lost the data pipe, exiting!");
-        debugged->continueExecution();
-        error = VALIDATOR_ERR_DATA_PIPE_LOST;
-        break;
-      }
-      if (not skipDebugger) {
-        debugged->setBreakpoint(
-            (void *)QBDI_GPR_GET(&gprStateInstr, QBDI::REG_PC));
-        do {
+    } else if (record->event == EVENT::EXEC_TRANSFER) {
+      validator.signalExecTransfer(record->transferAddress);
+    } else if (record->event == EVENT::INSTRUCTION) {
+      const InstructionRecord &inst = record->instruction;
+      bool breakpoint = false;
+      if (not inst.debuggerSkip) {
+        QBDI::rword target = QBDI_GPR_GET(&inst.gprState, QBDI::REG_PC);
+        // The target is usually the next instruction: try a single step
+        // before the breakpoint, which needs more syscalls
+        if (not debugged->stepExecution()) {
+          debugged->setBreakpoint((void *)target);
           debugged->continueExecution();
+          breakpoint = true;
+        }
+        while (true) {
           status = debugged->waitForStatus();
           if (hasExited(status)) {
             QBDI_ERROR("Execution diverged, debugged process exited!");
             validator.signalCriticalState();
             running = false;
-            writeCommand(COMMAND::STOP, ctrlPipe);
+            reader.requestStop();
             error = VALIDATOR_ERR_DBG_EXITED;
             break;
           } else if (hasCrashed(status)) {
@@ -129,36 +106,38 @@ void start_master(Process *debugged, pid_t instrumented, int ctrlfd, int datafd,
                 WSTOPSIG(status));
             validator.signalCriticalState();
             running = false;
-            writeCommand(COMMAND::STOP, ctrlPipe);
+            reader.requestStop();
             error = VALIDATOR_ERR_DBG_CRASH;
             break;
           }
           debugged->getProcessGPR(&gprStateDbg);
-          debugged->getProcessFPR(&fprStateDbg);
-        } while (QBDI_GPR_GET(&gprStateDbg, QBDI::REG_PC) !=
-                 QBDI_GPR_GET(&gprStateInstr, QBDI::REG_PC));
+          if (QBDI_GPR_GET(&gprStateDbg, QBDI::REG_PC) == target) {
+            debugged->getProcessFPR(&fprStateDbg);
+            break;
+          }
+          if (not breakpoint) {
+            debugged->setBreakpoint((void *)target);
+            breakpoint = true;
+          }
+          debugged->continueExecution();
+        }
       }
-      validator.signalNewState(address, mnemonic, disassembly, skipDebugger,
-                               &gprStateDbg, &fprStateDbg, &gprStateInstr,
-                               &fprStateInstr);
-      if (running) {
+      validator.signalNewState(
+          inst.address, reader.getString(inst.mnemonicID),
+          reader.getString(inst.disassemblyID), inst.debuggerSkip,
+          &gprStateDbg, &fprStateDbg, &inst.gprState, &inst.fprState);
+      if (running and breakpoint) {
         debugged->unsetBreakpoint();
       }
-    } else if (event == EVENT::MISSMATCHMEMACCESS) {
-      bool doRead, mayRead, doWrite, mayWrite;
-      std::vector<QBDI::MemoryAccess> accesses;
-      if (readMismatchMemAccessEvent(&address, &doRead, &mayRead, &doWrite,
-                                     &mayWrite, accesses, dataPipe) != 1) {
-        QBDI_ERROR("Lost the data pipe, exiting!");
-        debugged->continueExecution();
-        writeCommand(COMMAND::STOP, ctrlPipe);
-        error = VALIDATOR_ERR_DATA_PIPE_LOST;
-        break;
-      }
-      validator.signalAccessError(address, doRead, mayRead, doWrite, mayWrite,
-                                  accesses);
+    } else if (record->event == EVENT::MISSMATCHMEMACCESS) {
+      const MismatchMemAccessRecord &mismatch = record->mismatch;
+      std::vector<QBDI::MemoryAccess> accesses(
+          mismatch.accesses, mismatch.accesses + mismatch.nbAccess);
+      validator.signalAccessError(mismatch.address, mismatch.doRead,
+                                  mismatch.mayRead, mismatch.doWrite,
+                                  mismatch.mayWrite, accesses);
     } else {
-      QBDI_ERROR("Unknown validator event {}", event);
+      QBDI_ERROR("Unknown validator event {}", record->event);
       debugged->continueExecution();
       error = VALIDATOR_ERR_UNEXPECTED_API_FAILURE;
       break;
@@ -21,8 +21,9 @@
 #include <unistd.h>
 
 #include "process.h"
+#include "ring.h"
 
-void start_master(Process *debugged, pid_t instrumented, int ctrlfd, int datafd,
-                  int stdoutDbg, int stdoutDbi);
+void start_master(Process *debugged, pid_t instrumented, EventRing *ring,
+                  int datafd, int stdoutDbg, int stdoutDbi);
 
 #endif // MASTER_H
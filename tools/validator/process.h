@@ -35,6 +35,9 @@ public:
 
   virtual void continueExecution() = 0;
 
+  // Execute a single instruction. Return false if not supported
+  virtual bool stepExecution() = 0;
+
   virtual int waitForStatus() = 0;
 
   virtual void getProcessGPR(QBDI::GPRState *gprState) = 0;
@@ -0,0 +1,231 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ring.h"
+
+#include <algorithm>
+#include <new>
+#include <poll.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Number of tries before sleeping on the pipe of the peer
+static const unsigned SPIN_COUNT = 1024;
+
+EventRing *createEventRing() {
+  void *mem = mmap(nullptr, sizeof(EventRing), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANON, -1, 0);
+  if (mem == MAP_FAILED) {
+    return nullptr;
+  }
+  EventRing *ring = static_cast<EventRing *>(mem);
+  new (&ring->header) RingHeader();
+  ring->header.head.store(0);
+  ring->header.tail.store(0);
+  ring->header.stop.store(false);
+  return ring;
+}
+
+// Wait a little for the peer. Return false if the peer has closed its pipe.
+static bool waitPeer(int peerfd, unsigned &spin) {
+  if (spin < SPIN_COUNT) {
+    spin++;
+    sched_yield();
+    return true;
+  }
+  // The pipe doesn't carry any data: any event is the end of the peer
+  struct pollfd pfd = {peerfd, POLLIN, 0};
+  return poll(&pfd, 1, 1) <= 0;
+}
+
+// RingWriter
+// ==========
+
+RingWriter::RingWriter(EventRing *ring, int peerfd)
+    : ring(ring), peerfd(peerfd), head(0), cachedTail(0) {}
+
+EventRecord *RingWriter::reserve(EVENT event) {
+  unsigned spin = 0;
+  while (head - cachedTail >= RING_SIZE) {
+    cachedTail = ring->header.tail.load(std::memory_order_acquire);
+    if (head - cachedTail < RING_SIZE) {
+      break;
+    }
+    // the master doesn't consume the events anymore
+    if (stopRequested() or not waitPeer(peerfd, spin)) {
+      return nullptr;
+    }
+  }
+  EventRecord *record = &ring->records[head % RING_SIZE];
+  record->event = event;
+  return record;
+}
+
+void RingWriter::commit() {
+  head++;
+  ring->header.head.store(head, std::memory_order_release);
+}
+
+int RingWriter::getStringID(const char *str, uint32_t *id) {
+  auto it = stringIDs.find(str);
+  if (it != stringIDs.end()) {
+    *id = it->second;
+    return 1;
+  }
+  EventRecord *record = reserve(EVENT::STRING);
+  if (record == nullptr) {
+    return 0;
+  }
+  *id = strings.size();
+  it = stringIDs.emplace(str, *id).first;
+  strings.push_back(&it->first);
+
+  record->string.id = *id;
+  strncpy(record->string.str, str, RING_STRING_LEN - 1);
+  record->string.str[RING_STRING_LEN - 1] = '\0';
+  commit();
+  return 1;
+}
+
+int RingWriter::writeInstructionEvent(QBDI::rword address,
+                                      const char *mnemonic,
+                                      const char *disassembly,
+                                      QBDI::GPRState *gprState,
+                                      QBDI::FPRState *fprState,
+                                      bool debuggerSkip) {
+  // Most instructions are executed more than once: avoid hashing the strings
+  CachedInst ids;
+  auto it = instCache.find(address);
+  if (it != instCache.end() and
+      strcmp(strings[it->second.mnemonicID]->c_str(), mnemonic) == 0 and
+      strcmp(strings[it->second.disassemblyID]->c_str(), disassembly) == 0) {
+    ids = it->second;
+  } else {
+    if (getStringID(mnemonic, &ids.mnemonicID) != 1 or
+        getStringID(disassembly, &ids.disassemblyID) != 1) {
+      return 0;
+    }
+    instCache[address] = ids;
+  }
+
+  EventRecord *record = reserve(EVENT::INSTRUCTION);
+  if (record == nullptr) {
+    return 0;
+  }
+  record->instruction.address = address;
+  record->instruction.mnemonicID = ids.mnemonicID;
+  record->instruction.disassemblyID = ids.disassemblyID;
+  record->instruction.debuggerSkip = debuggerSkip;
+  record->instruction.gprState = *gprState;
+  record->instruction.fprState = *fprState;
+  commit();
+  return 1;
+}
+
+int RingWriter::writeMismatchMemAccessEvent(
+    QBDI::rword address, bool doRead, bool mayRead, bool doWrite,
+    bool mayWrite, const std::vector<QBDI::MemoryAccess> &accesses) {
+  EventRecord *record = reserve(EVENT::MISSMATCHMEMACCESS);
+  if (record == nullptr) {
+    return 0;
+  }
+  record->mismatch.address = address;
+  record->mismatch.doRead = doRead;
+  record->mismatch.mayRead = mayRead;
+  record->mismatch.doWrite = doWrite;
+  record->mismatch.mayWrite = mayWrite;
+  record->mismatch.nbAccess = std::min(accesses.size(), RING_MAX_ACCESS);
+  std::copy_n(accesses.begin(), record->mismatch.nbAccess,
+              record->mismatch.accesses);
+  commit();
+  return 1;
+}
+
+int RingWriter::writeExecTransferEvent(QBDI::rword address) {
+  EventRecord *record = reserve(EVENT::EXEC_TRANSFER);
+  if (record == nullptr) {
+    return 0;
+  }
+  record->transferAddress = address;
+  commit();
+  return 1;
+}
+
+int RingWriter::writeExitEvent() {
+  if (reserve(EVENT::EXIT) == nullptr) {
+    return 0;
+  }
+  commit();
+  return 1;
+}
+
+// RingReader
+// ==========
+
+RingReader::RingReader(EventRing *ring, int peerfd)
+    : ring(ring), peerfd(peerfd), tail(0), cachedHead(0), pending(false) {}
+
+void RingReader::release(bool force) {
+  uint64_t released = ring->header.tail.load(std::memory_order_relaxed);
+  if (force or tail - released >= RING_ACK_BATCH) {
+    ring->header.tail.store(tail, std::memory_order_release);
+  }
+}
+
+const EventRecord *RingReader::readEvent() {
+  while (true) {
+    // the previous record isn't used anymore
+    if (pending) {
+      tail++;
+      pending = false;
+      release(false);
+    }
+    unsigned spin = 0;
+    while (tail == cachedHead) {
+      cachedHead = ring->header.head.load(std::memory_order_acquire);
+      if (tail != cachedHead) {
+        break;
+      }
+      // the instrumented process may wait for some free records
+      release(true);
+      if (not waitPeer(peerfd, spin)) {
+        // read the last records written before the end of the process
+        cachedHead = ring->header.head.load(std::memory_order_acquire);
+        if (tail == cachedHead) {
+          return nullptr;
+        }
+      }
+    }
+    const EventRecord *record = &ring->records[tail % RING_SIZE];
+    pending = true;
+    if (record->event != EVENT::STRING) {
+      return record;
+    }
+    if (strings.size() <= record->string.id) {
+      strings.resize(record->string.id + 1);
+    }
+    strings[record->string.id] = record->string.str;
+  }
+}
+
+const char *RingReader::getString(uint32_t id) const {
+  if (id < strings.size()) {
+    return strings[id].c_str();
+  }
+  return "";
+}
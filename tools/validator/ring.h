@@ -0,0 +1,180 @@
+/*
+ * This file is part of QBDI.
+ *
+ * Copyright 2017 - 2024 Quarkslab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef RING_H
+#define RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <QBDI/Callback.h>
+#include <QBDI/State.h>
+
+// The instrumented process sends its events to the master through a ring of
+// fixed-size records in a shared memory. The strings (mnemonic and
+// disassembly) are sent once in a STRING record and referenced by their ID.
+// The pipes between the two processes only carry the end of the peer.
+
+enum EVENT : uint32_t {
+  INSTRUCTION,
+  MISSMATCHMEMACCESS,
+  EXEC_TRANSFER,
+  STRING,
+  EXIT,
+};
+
+static constexpr size_t RING_SIZE = 512;
+// The master releases the consumed records by batch
+static constexpr size_t RING_ACK_BATCH = 64;
+static constexpr size_t RING_STRING_LEN = 128;
+// The accesses of a mismatch event after this limit are not sent
+static constexpr size_t RING_MAX_ACCESS = 16;
+
+struct InstructionRecord {
+  QBDI::rword address;
+  uint32_t mnemonicID;
+  uint32_t disassemblyID;
+  bool debuggerSkip;
+  QBDI::GPRState gprState;
+  QBDI::FPRState fprState;
+};
+
+struct MismatchMemAccessRecord {
+  QBDI::rword address;
+  bool doRead;
+  bool mayRead;
+  bool doWrite;
+  bool mayWrite;
+  uint32_t nbAccess;
+  QBDI::MemoryAccess accesses[RING_MAX_ACCESS];
+};
+
+struct StringRecord {
+  uint32_t id;
+  char str[RING_STRING_LEN];
+};
+
+struct EventRecord {
+  EVENT event;
+  union {
+    InstructionRecord instruction;
+    MismatchMemAccessRecord mismatch;
+    QBDI::rword transferAddress;
+    StringRecord string;
+  };
+};
+
+struct RingHeader {
+  // index of the next record written by the instrumented process
+  alignas(64) std::atomic<uint64_t> head;
+  // index of the first record not yet released by the master
+  alignas(64) std::atomic<uint64_t> tail;
+  // set by the master to stop the instrumented process
+  alignas(64) std::atomic<bool> stop;
+};
+
+struct EventRing {
+  RingHeader header;
+  EventRecord records[RING_SIZE];
+};
+
+// Map the ring in a shared memory. Must be called before the fork
+EventRing *createEventRing();
+
+class RingWriter {
+  struct CachedInst {
+    uint32_t mnemonicID;
+    uint32_t disassemblyID;
+  };
+
+  EventRing *ring;
+  int peerfd;
+  uint64_t head;
+  uint64_t cachedTail;
+  std::unordered_map<std::string, uint32_t> stringIDs;
+  std::vector<const std::string *> strings;
+  std::unordered_map<QBDI::rword, CachedInst> instCache;
+
+  EventRecord *reserve(EVENT event);
+
+  void commit();
+
+  int getStringID(const char *str, uint32_t *id);
+
+public:
+  /*! The writer of the instrumented process
+   *
+   * @param[in] ring    The shared ring
+   * @param[in] peerfd  A pipe closed when the master exits
+   */
+  RingWriter(EventRing *ring, int peerfd);
+
+  bool stopRequested() const {
+    return ring->header.stop.load(std::memory_order_relaxed);
+  }
+
+  int writeInstructionEvent(QBDI::rword address, const char *mnemonic,
+                            const char *disassembly, QBDI::GPRState *gprState,
+                            QBDI::FPRState *fprState, bool debuggerSkip);
+
+  int
+  writeMismatchMemAccessEvent(QBDI::rword address, bool doRead, bool mayRead,
+                              bool doWrite, bool mayWrite,
+                              const std::vector<QBDI::MemoryAccess> &accesses);
+
+  int writeExecTransferEvent(QBDI::rword address);
+
+  int writeExitEvent();
+};
+
+class RingReader {
+  EventRing *ring;
+  int peerfd;
+  uint64_t tail;
+  uint64_t cachedHead;
+  bool pending;
+  std::vector<std::string> strings;
+
+  void release(bool force);
+
+public:
+  /*! The reader of the master process
+   *
+   * @param[in] ring    The shared ring
+   * @param[in] peerfd  A pipe closed when the instrumented process exits
+   */
+  RingReader(EventRing *ring, int peerfd);
+
+  /*! Wait for the next event. The STRING records are consumed internally.
+   *
+   * @return The next record, valid until the next call, or nullptr if the
+   *         instrumented process has exited without an EXIT event.
+   */
+  const EventRecord *readEvent();
+
+  const char *getString(uint32_t id) const;
+
+  void requestStop() {
+    ring->header.stop.store(true, std::memory_order_relaxed);
+  }
+};
+
+#endif // RING_H